@@ -0,0 +1,296 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "Hash.h"
+
+// Checkpoint files of long runs
+// A checkpoint holds the magic "ATPGCKP1", the uint64 size of the payload, the payload and the 64 bit FNV-1a hash
+// of the payload, all in little endian byte order. The payload is built by the program, with the encoder below.
+// Checkpoints are written to a temporary file which is renamed over the previous one, so a crash leaves either
+// the old or the new checkpoint and never a partial one
+static const char CHECKPOINT_MAGIC[8] = {'A', 'T', 'P', 'G', 'C', 'K', 'P', '1'};
+
+// Appends little endian values to a payload
+class CheckpointEncoder
+{
+
+public:
+    std::string data;
+
+    void putU8(uint8_t value)
+    {
+        data.push_back(value);
+    }
+
+    void putU32(uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            data.push_back((value >> (8 * i)) & 0xFF);
+        }
+    }
+
+    void putU64(uint64_t value)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            data.push_back((value >> (8 * i)) & 0xFF);
+        }
+    }
+
+    // A string preceded by its length
+    void putString(const std::string &value)
+    {
+        putU32(value.size());
+        data += value;
+    }
+};
+
+// Reads the values of a payload in the order they were put, reading past the end sets failed
+class CheckpointDecoder
+{
+
+public:
+    bool failed;
+
+    CheckpointDecoder(const std::string &_data) : data(_data)
+    {
+        pos = 0;
+        failed = false;
+    }
+
+    uint8_t getU8()
+    {
+        return getU64Bytes(1);
+    }
+
+    uint32_t getU32()
+    {
+        return getU64Bytes(4);
+    }
+
+    uint64_t getU64()
+    {
+        return getU64Bytes(8);
+    }
+
+    std::string getString()
+    {
+        uint32_t size = getU32();
+        if (failed || size > data.size() - pos)
+        {
+            failed = true;
+            return "";
+        }
+
+        pos += size;
+        return data.substr(pos - size, size);
+    }
+
+    // True once every value has been read
+    bool atEnd() const
+    {
+        return pos == data.size();
+    }
+
+private:
+    const std::string &data;
+    size_t pos;
+
+    uint64_t getU64Bytes(int size)
+    {
+        if (failed || size > data.size() - pos)
+        {
+            failed = true;
+            return 0;
+        }
+
+        uint64_t value = 0;
+        for (int i = 0; i < size; ++i)
+        {
+            value |= (uint64_t)(unsigned char)data[pos + i] << (8 * i);
+        }
+        pos += size;
+
+        return value;
+    }
+};
+
+// Read the payload of a checkpoint file
+// Returns false if the file does not exist, and also sets error if it exists but is not a complete checkpoint
+inline bool readCheckpoint(const std::string &filename, std::string &payload, std::string &error)
+{
+    std::ifstream fin(filename, std::ios::binary);
+    if (!fin.is_open())
+    {
+        return false;
+    }
+
+    std::string file((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+
+    // Magic, payload size, payload and hash
+    if (file.size() < 24 || file.compare(0, sizeof(CHECKPOINT_MAGIC), CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0)
+    {
+        error = filename + " is not a checkpoint of this version";
+        return false;
+    }
+
+    std::string header = file.substr(8, 8);
+    uint64_t size = CheckpointDecoder(header).getU64();
+
+    if (size != file.size() - 24)
+    {
+        error = "the checkpoint " + filename + " is truncated";
+        return false;
+    }
+
+    payload = file.substr(16, size);
+
+    std::string trailer = file.substr(16 + size);
+    if (CheckpointDecoder(trailer).getU64() != fnv1a(payload))
+    {
+        error = "the checkpoint " + filename + " is corrupted";
+        return false;
+    }
+
+    return true;
+}
+
+// Writes checkpoints on a background thread, so the caller only pays for building the payload
+// A payload submitted while the previous one is still being written replaces any payload waiting behind it,
+// only the newest state matters
+class CheckpointWriter
+{
+
+public:
+    // Class constructor, starts the writer thread
+    CheckpointWriter(const std::string &_path) : path(_path)
+    {
+        pending = false;
+        writing = false;
+        stopping = false;
+        failed = false;
+
+        thread = std::thread([this]()
+                             { writerLoop(); });
+    }
+
+    // Class destructor, writes the payload still waiting and joins the thread
+    ~CheckpointWriter()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        thread.join();
+    }
+
+    CheckpointWriter(const CheckpointWriter &) = delete;
+    CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+
+    // Queue a payload and return at once
+    void submit(std::string payload)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            next.swap(payload);
+            pending = true;
+        }
+        wake.notify_all();
+    }
+
+    // Wait until every submitted payload is on disk, returns false if a write failed
+    bool flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]()
+                  { return !pending && !writing; });
+
+        return !failed;
+    }
+
+private:
+    std::string path;
+    std::thread thread;
+
+    // Payload waiting to be written and the state of the writer, guarded by the mutex
+    std::string next;
+    bool pending;
+    bool writing;
+    bool stopping;
+    bool failed;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+
+    void writerLoop()
+    {
+        std::string payload;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]()
+                          { return pending || stopping; });
+
+                if (!pending)
+                {
+                    return;
+                }
+
+                payload.swap(next);
+                pending = false;
+                writing = true;
+            }
+
+            bool written = write(payload);
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                writing = false;
+                failed = failed || !written;
+            }
+            idle.notify_all();
+        }
+    }
+
+    // Write a checkpoint to a temporary file, sync it and rename it over the previous one
+    bool write(const std::string &payload)
+    {
+        CheckpointEncoder header, trailer;
+        header.data.assign(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+        header.putU64(payload.size());
+        trailer.putU64(fnv1a(payload));
+
+        std::string temporary = path + ".tmp";
+        FILE *file = std::fopen(temporary.c_str(), "wb");
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        bool ok = std::fwrite(header.data.data(), 1, header.data.size(), file) == header.data.size();
+        ok = ok && std::fwrite(payload.data(), 1, payload.size(), file) == payload.size();
+        ok = ok && std::fwrite(trailer.data.data(), 1, trailer.data.size(), file) == trailer.data.size();
+        ok = ok && std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+        ok = std::fclose(file) == 0 && ok;
+
+        return ok && std::rename(temporary.c_str(), path.c_str()) == 0;
+    }
+};
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef COMPILEDCIRCUIT_H
+#define COMPILEDCIRCUIT_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Gate functions of the compiled circuit
+enum GateOp
+{
+    OP_BUF,
+    OP_INV,
+    OP_AND,
+    OP_OR,
+    OP_NAND,
+    OP_NOR
+};
+
+// Gate of the compiled circuit, the nets are stored as indices (net id - 1)
+class CompiledGate
+{
+
+public:
+    int op;
+    int in1;
+    int in2;
+    int out;
+};
+
+// Flat copy of a parsed circuit used by the word parallel simulators
+// The gates keep the order and the indices of the gate list, which has to be levelized
+class CompiledCircuit
+{
+
+public:
+    int num_nets;
+    std::vector<CompiledGate> gates;
+
+    // Net indices of the primary inputs and outputs
+    std::vector<int> inputs;
+    std::vector<int> outputs;
+
+    // Net indices of the data inputs and outputs of the flip-flops
+    std::vector<int> flop_d;
+    std::vector<int> flop_q;
+
+    CompiledCircuit()
+    {
+        num_nets = 0;
+    }
+
+    // The flip-flops are given as (D net, Q net) pairs
+    template <class GateT, class NetT>
+    CompiledCircuit(const std::vector<GateT> &gate_list, const std::vector<NetT> &net_list, const std::vector<int> &input_list, const std::vector<int> &output_list,
+                    const std::vector<std::pair<int, int>> &dff_list = std::vector<std::pair<int, int>>())
+    {
+        num_nets = net_list.size();
+
+        for (int j = 0; j < gate_list.size(); ++j)
+        {
+            const GateT &g = gate_list[j];
+            CompiledGate c;
+
+            c.op = gateOp(g.type);
+            c.in1 = g.input_nets[0].id - 1;
+            c.in2 = g.input_nets.size() > 1 ? g.input_nets[1].id - 1 : c.in1;
+            c.out = g.output_net.id - 1;
+
+            gates.push_back(c);
+        }
+
+        for (int i = 0; i < input_list.size(); ++i)
+        {
+            inputs.push_back(input_list[i] - 1);
+        }
+        for (int i = 0; i < output_list.size(); ++i)
+        {
+            outputs.push_back(output_list[i] - 1);
+        }
+        for (int i = 0; i < dff_list.size(); ++i)
+        {
+            flop_d.push_back(dff_list[i].first - 1);
+            flop_q.push_back(dff_list[i].second - 1);
+        }
+    }
+
+    static int gateOp(const std::string &type)
+    {
+        if (type == "INV")
+        {
+            return OP_INV;
+        }
+        else if (type == "AND")
+        {
+            return OP_AND;
+        }
+        else if (type == "OR")
+        {
+            return OP_OR;
+        }
+        else if (type == "NAND")
+        {
+            return OP_NAND;
+        }
+        else if (type == "NOR")
+        {
+            return OP_NOR;
+        }
+
+        return OP_BUF;
+    }
+};
+
+// Evaluate a gate on 64 machines or patterns at once
+inline uint64_t evaluateWord(int op, uint64_t a, uint64_t b)
+{
+    switch (op)
+    {
+    case OP_INV:
+        return ~a;
+    case OP_AND:
+        return a & b;
+    case OP_OR:
+        return a | b;
+    case OP_NAND:
+        return ~(a & b);
+    case OP_NOR:
+        return ~(a | b);
+    default:
+        return a;
+    }
+}
+
+#endif
@@ -0,0 +1,298 @@
+#ifndef COMPILEDKERNEL_H
+#define COMPILEDKERNEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "CompiledCircuit.h"
+#include "Hash.h"
+#include "Instrumentation.h"
+
+// Gates per generated function, short functions keep the compile time of large netlists low
+const int KERNEL_GATES_PER_FUNCTION = 128;
+
+// Compiled code simulation of the good machine
+// The levelized circuit is written as straight line C++ over 64 bit words, one statement per gate with the net
+// indices as constants, compiled into a shared object with the system compiler (CXX, or c++) and loaded with dlopen.
+// The shared objects are cached in a directory under the hash of their source, so every netlist is compiled once
+class CompiledKernel
+{
+
+public:
+    CompiledKernel()
+    {
+        handle = nullptr;
+        function = nullptr;
+        num_gates = 0;
+        cached = false;
+    }
+
+    ~CompiledKernel()
+    {
+        if (handle != nullptr)
+        {
+            dlclose(handle);
+        }
+    }
+
+    CompiledKernel(const CompiledKernel &) = delete;
+    CompiledKernel &operator=(const CompiledKernel &) = delete;
+
+    // Generate, compile and load the kernel of a circuit, reusing the shared object cached in dir
+    // Returns false with the reason in error if the circuit is not supported or the kernel cannot be built
+    bool load(const CompiledCircuit &circuit, const std::string &dir, std::string &error)
+    {
+        if (!supports(circuit))
+        {
+            error = "the circuit has nets which are neither inputs nor driven by an earlier gate";
+            return false;
+        }
+
+        std::string compiler = std::getenv("CXX") != nullptr ? std::getenv("CXX") : "c++";
+        // -Og runs as fast as -O1 on this code and compiles in about half the time
+        std::vector<std::string> command = {compiler, "-Og", "-shared", "-fPIC", "-w"};
+
+        // The command is part of the source, so a change of compiler or flags gives a new hash
+        std::string code = source(circuit, command);
+        char name[32];
+        std::snprintf(name, sizeof(name), "kernel_%016llx", (unsigned long long)fnv1a(code));
+
+        std::string base = dir + "/" + name;
+        library = base + ".so";
+
+        mkdir(dir.c_str(), 0755);
+
+        cached = access(library.c_str(), R_OK) == 0;
+
+        if (!cached)
+        {
+            // Build under a private name and rename, so concurrent jobs never load a partial file
+            static std::atomic<int> counter(0);
+            std::string suffix = "." + std::to_string(getpid()) + "." + std::to_string(counter++);
+            std::string source_path = base + suffix + ".cpp";
+            std::string temporary = base + suffix + ".so";
+            std::string log_path = base + suffix + ".log";
+
+            std::ofstream fsource(source_path);
+            fsource << code;
+            fsource.close();
+
+            if (!fsource)
+            {
+                error = "unable to write " + source_path;
+                return false;
+            }
+
+            command.push_back("-o");
+            command.push_back(temporary);
+            command.push_back(source_path);
+
+            bool compiled;
+            {
+                INSTRUMENT_PHASE(PHASE_COMPILE);
+                compiled = run(command, log_path);
+            }
+
+            if (!compiled || std::rename(temporary.c_str(), library.c_str()) != 0)
+            {
+                error = "compilation failed, see " + log_path;
+                std::remove(temporary.c_str());
+                return false;
+            }
+
+            std::remove(source_path.c_str());
+            std::remove(log_path.c_str());
+        }
+
+        handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (handle == nullptr)
+        {
+            error = dlerror();
+            return false;
+        }
+
+        function = (void (*)(uint64_t *))dlsym(handle, "simulate_kernel");
+        if (function == nullptr)
+        {
+            error = "no kernel in " + library;
+            return false;
+        }
+
+        num_gates = circuit.gates.size();
+
+        return true;
+    }
+
+    bool isLoaded() const
+    {
+        return function != nullptr;
+    }
+
+    // True when the shared object was found in the cache instead of being compiled
+    bool wasCached() const
+    {
+        return cached;
+    }
+
+    const std::string &path() const
+    {
+        return library;
+    }
+
+    // Simulate 64 patterns, values holds one word per net with the input words already set
+    void evaluate(uint64_t *values) const
+    {
+        function(values);
+        INSTRUMENT_COUNT(COUNTER_GATE_EVALS, num_gates);
+    }
+
+    // Check that every net is a primary input, a flip-flop output or the output of a gate placed before its readers
+    static bool supports(const CompiledCircuit &circuit)
+    {
+        std::vector<char> defined(circuit.num_nets, 0);
+
+        for (int i = 0; i < circuit.inputs.size(); ++i)
+        {
+            defined[circuit.inputs[i]] = 1;
+        }
+        for (int i = 0; i < circuit.flop_q.size(); ++i)
+        {
+            defined[circuit.flop_q[i]] = 1;
+        }
+
+        for (int j = 0; j < circuit.gates.size(); ++j)
+        {
+            const CompiledGate &g = circuit.gates[j];
+            if (!defined[g.in1] || !defined[g.in2])
+            {
+                return false;
+            }
+            defined[g.out] = 1;
+        }
+
+        return std::find(defined.begin(), defined.end(), 0) == defined.end();
+    }
+
+    // Source of the kernel, void simulate_kernel(uint64_t *v) evaluates the gates in order on the net words v
+    static std::string source(const CompiledCircuit &circuit, const std::vector<std::string> &command)
+    {
+        std::ostringstream out;
+
+        out << "//";
+        for (int i = 0; i < command.size(); ++i)
+        {
+            out << " " << command[i];
+        }
+        out << "\n";
+        out << "typedef unsigned long long word;\n";
+
+        int num_functions = (circuit.gates.size() + KERNEL_GATES_PER_FUNCTION - 1) / KERNEL_GATES_PER_FUNCTION;
+
+        for (int f = 0; f < num_functions; ++f)
+        {
+            out << "static void part" << f << "(word *v)\n{\n";
+
+            int end = std::min<int>(circuit.gates.size(), (f + 1) * KERNEL_GATES_PER_FUNCTION);
+            for (int j = f * KERNEL_GATES_PER_FUNCTION; j < end; ++j)
+            {
+                const CompiledGate &g = circuit.gates[j];
+                out << "    v[" << g.out << "] = ";
+
+                switch (g.op)
+                {
+                case OP_INV:
+                    out << "~v[" << g.in1 << "]";
+                    break;
+                case OP_AND:
+                    out << "v[" << g.in1 << "] & v[" << g.in2 << "]";
+                    break;
+                case OP_OR:
+                    out << "v[" << g.in1 << "] | v[" << g.in2 << "]";
+                    break;
+                case OP_NAND:
+                    out << "~(v[" << g.in1 << "] & v[" << g.in2 << "])";
+                    break;
+                case OP_NOR:
+                    out << "~(v[" << g.in1 << "] | v[" << g.in2 << "])";
+                    break;
+                default:
+                    out << "v[" << g.in1 << "]";
+                    break;
+                }
+
+                out << ";\n";
+            }
+
+            out << "}\n";
+        }
+
+        out << "extern \"C\" void simulate_kernel(word *v)\n{\n";
+        for (int f = 0; f < num_functions; ++f)
+        {
+            out << "    part" << f << "(v);\n";
+        }
+        out << "}\n";
+
+        return out.str();
+    }
+
+private:
+    void *handle;
+    void (*function)(uint64_t *);
+    int num_gates;
+    bool cached;
+    std::string library;
+
+    // Run a command with its output sent to a log file, returns true if it exits with status 0
+    static bool run(const std::vector<std::string> &command, const std::string &log_path)
+    {
+        std::vector<char *> argv;
+        for (int i = 0; i < command.size(); ++i)
+        {
+            argv.push_back((char *)command[i].c_str());
+        }
+        argv.push_back(nullptr);
+
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            return false;
+        }
+
+        if (pid == 0)
+        {
+            int fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd >= 0)
+            {
+                dup2(fd, 1);
+                dup2(fd, 2);
+                close(fd);
+            }
+            execvp(argv[0], argv.data());
+            _exit(127);
+        }
+
+        int status = 0;
+        if (waitpid(pid, &status, 0) != pid)
+        {
+            return false;
+        }
+
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+};
+
+#endif
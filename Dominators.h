@@ -0,0 +1,191 @@
+#ifndef DOMINATORS_H
+#define DOMINATORS_H
+
+#include <algorithm>
+#include <climits>
+#include <utility>
+#include <vector>
+
+#include "CompiledCircuit.h"
+
+// Unique sensitization of a fault site
+// Every path from the site to an output passes through the gates driving the post dominators of the site. The
+// immediate post dominators are found over the fanout cone of the site from the outputs back, with a virtual sink
+// num_nets following every output. The side inputs of the dominating gates outside the cone have to be at the non
+// controlling value in every test of the fault
+class SiteDominators
+{
+
+public:
+    // Class constructor, the circuit has to outlive the analysis
+    SiteDominators(const CompiledCircuit &_circuit) : circuit(_circuit)
+    {
+        fanout.resize(circuit.num_nets);
+        driver.assign(circuit.num_nets, -1);
+        is_output.assign(circuit.num_nets, 0);
+        in_cone.assign(circuit.num_nets, 0);
+        ipdom.assign(circuit.num_nets + 1, -1);
+
+        for (int j = 0; j < circuit.gates.size(); ++j)
+        {
+            const CompiledGate &g = circuit.gates[j];
+
+            fanout[g.in1].push_back(j);
+            if (g.in2 != g.in1)
+            {
+                fanout[g.in2].push_back(j);
+            }
+            driver[g.out] = j;
+        }
+
+        for (int i = 0; i < circuit.outputs.size(); ++i)
+        {
+            is_output[circuit.outputs[i]] = 1;
+        }
+    }
+
+    // Analyze the site of a fault on net n, or on its branch into gate fault_gate unless that is -1, and append the
+    // side inputs of the dominators as (net index, non controlling value) pairs
+    // Returns false, appending nothing, if the fault reaches no output
+    bool analyze(int n, int fault_gate, std::vector<std::pair<int, int>> &side_inputs)
+    {
+        clear();
+
+        // Fanout cone of the fault site, a branch fault starts at the output of its gate
+        int start = fault_gate == -1 ? n : circuit.gates[fault_gate].out;
+
+        cone.assign(1, start);
+        in_cone[start] = 1;
+
+        for (int i = 0; i < cone.size(); ++i)
+        {
+            const std::vector<int> &fed = fanout[cone[i]];
+            for (int k = 0; k < fed.size(); ++k)
+            {
+                int out = circuit.gates[fed[k]].out;
+                if (!in_cone[out])
+                {
+                    in_cone[out] = 1;
+                    cone.push_back(out);
+                }
+            }
+        }
+
+        // Immediate post dominators of the cone lines, a line comes after all its successors
+        std::sort(cone.begin(), cone.end(), [this](int a, int b) { return order(a) > order(b); });
+
+        int sink = circuit.num_nets;
+        ipdom[sink] = sink;
+
+        for (int i = 0; i < cone.size(); ++i)
+        {
+            int k = cone[i];
+            int d = is_output[k] ? sink : -1;
+
+            for (int m = 0; m < fanout[k].size(); ++m)
+            {
+                int succ = circuit.gates[fanout[k][m]].out;
+                if (ipdom[succ] == -1)
+                {
+                    continue;
+                }
+
+                if (d == -1)
+                {
+                    d = succ;
+                    continue;
+                }
+
+                // Walk up the post dominator tree to the first common line, in topological order
+                while (d != succ)
+                {
+                    while (order(d) < order(succ))
+                    {
+                        d = ipdom[d];
+                    }
+                    while (order(succ) < order(d))
+                    {
+                        succ = ipdom[succ];
+                    }
+                }
+            }
+
+            ipdom[k] = d;
+        }
+
+        if (ipdom[start] == -1)
+        {
+            return false;
+        }
+
+        // The gate of a branch fault dominates it, followed by the drivers of the post dominators of its output
+        std::vector<int> dominators;
+        if (fault_gate != -1)
+        {
+            dominators.push_back(fault_gate);
+        }
+        for (int d = ipdom[start]; d != sink; d = ipdom[d])
+        {
+            dominators.push_back(driver[d]);
+        }
+
+        for (int i = 0; i < dominators.size(); ++i)
+        {
+            const CompiledGate &g = circuit.gates[dominators[i]];
+
+            if (g.op == OP_BUF || g.op == OP_INV)
+            {
+                continue;
+            }
+
+            int c = (g.op == OP_AND || g.op == OP_NAND) ? 0 : 1;
+            int pins[2] = {g.in1, g.in2};
+
+            for (int k = 0; k < 2; ++k)
+            {
+                if (!in_cone[pins[k]] && !(dominators[i] == fault_gate && pins[k] == n))
+                {
+                    side_inputs.push_back(std::make_pair(pins[k], !c));
+                }
+            }
+        }
+
+        return true;
+    }
+
+    // Check if a net (an index) is in the fanout cone of the last analyzed site
+    bool inCone(int m) const
+    {
+        return in_cone[m];
+    }
+
+private:
+    const CompiledCircuit &circuit;
+
+    std::vector<std::vector<int>> fanout;
+    std::vector<int> driver;
+    std::vector<char> is_output;
+
+    // State of the last analyzed site, cleared line by line
+    std::vector<int> cone;
+    std::vector<char> in_cone;
+    std::vector<int> ipdom;
+
+    void clear()
+    {
+        for (int i = 0; i < cone.size(); ++i)
+        {
+            in_cone[cone[i]] = 0;
+            ipdom[cone[i]] = -1;
+        }
+        cone.clear();
+    }
+
+    // Position of a line in the topological order, the virtual sink comes last
+    int order(int k) const
+    {
+        return k == circuit.num_nets ? INT_MAX : driver[k];
+    }
+};
+
+#endif
@@ -0,0 +1,1051 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <map>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "Fault.h"
+#include "PatternIO.h"
+#include "CompiledCircuit.h"
+#include "ParallelFaultSim.h"
+#include "SatAtpg.h"
+#include "CompiledKernel.h"
+#include "LevelParallel.h"
+#include "Session.h"
+
+// Time over which the logic simulation is repeated
+const double MIN_SECONDS = 0.1;
+
+// Parameters of a generated netlist
+class GeneratorOptions
+{
+
+public:
+    // Number of gates, of primary inputs (0 to derive it from the width of a level) and of logic levels
+    int gates;
+    int inputs;
+    int depth;
+
+    // Fanout above which a net is only picked again when no other net is found
+    int max_fanout;
+
+    // Percentage of second gate inputs taken next to the first one, these create reconvergent fanout
+    int reconvergence;
+
+    uint64_t seed;
+
+    GeneratorOptions()
+    {
+        gates = 10000;
+        inputs = 0;
+        depth = 32;
+        max_fanout = 8;
+        reconvergence = 30;
+        seed = 1;
+    }
+};
+
+// Generate a random levelized netlist
+// The gates are spread evenly over the levels and every gate takes its first input from the previous level, so the
+// circuit has the requested depth. The nets of a level are all used before any of them is picked twice, which keeps
+// every primary input connected. The second input is either a net close to the first one, whose fanin overlaps and
+// reconverges, or any net of an earlier level. The nets without fanout are the primary outputs
+CompiledCircuit generateNetlist(const GeneratorOptions &options)
+{
+    CompiledCircuit circuit;
+    std::mt19937_64 rng(options.seed);
+
+    int depth = std::max(1, std::min(options.depth, options.gates));
+    int width = (options.gates + depth - 1) / depth;
+
+    // Every input has to be picked by the first level, two inputs per gate at most
+    int inputs = options.inputs > 0 ? options.inputs : std::max(2, width);
+    inputs = std::min(inputs, 2 * width);
+
+    circuit.num_nets = inputs + options.gates;
+    for (int i = 0; i < inputs; ++i)
+    {
+        circuit.inputs.push_back(i);
+    }
+
+    std::vector<int> fanout(circuit.num_nets, 0);
+
+    // Nets of the previous level, the next unused one is at cursor
+    int level_first = 0, level_end = inputs, cursor = 0;
+
+    for (int j = 0; j < options.gates; ++j)
+    {
+        // Start a new level
+        if (j > 0 && j % width == 0)
+        {
+            level_first = level_end;
+            level_end = inputs + j;
+            cursor = level_first;
+        }
+
+        CompiledGate g;
+        g.out = inputs + j;
+
+        // The first level only holds two input gates so that it can use up all the inputs
+        int r = rng() % 100;
+        if (j >= width && r < 15)
+        {
+            g.op = OP_INV;
+        }
+        else if (j >= width && r < 20)
+        {
+            g.op = OP_BUF;
+        }
+        else
+        {
+            g.op = OP_AND + rng() % 4;
+        }
+
+        // First input, from the previous level
+        if (cursor < level_end)
+        {
+            g.in1 = cursor++;
+        }
+        else
+        {
+            g.in1 = level_first + rng() % (level_end - level_first);
+        }
+
+        g.in2 = g.in1;
+
+        if (g.op != OP_INV && g.op != OP_BUF)
+        {
+            // The first level takes both inputs from the unused primary inputs while there are some
+            if (j < width && cursor < level_end)
+            {
+                g.in2 = cursor++;
+            }
+            else
+            {
+                for (int attempt = 0; attempt < 8; ++attempt)
+                {
+                    int candidate;
+                    if ((int)(rng() % 100) < options.reconvergence)
+                    {
+                        int low = std::max(0, g.in1 - 8);
+                        int high = std::min(level_end - 1, g.in1 + 8);
+                        candidate = low + rng() % (high - low + 1);
+                    }
+                    else
+                    {
+                        candidate = rng() % level_end;
+                    }
+
+                    if (candidate != g.in1)
+                    {
+                        g.in2 = candidate;
+                        if (fanout[candidate] < options.max_fanout)
+                        {
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        fanout[g.in1]++;
+        if (g.in2 != g.in1)
+        {
+            fanout[g.in2]++;
+        }
+
+        circuit.gates.push_back(g);
+    }
+
+    for (int n = inputs; n < circuit.num_nets; ++n)
+    {
+        if (fanout[n] == 0)
+        {
+            circuit.outputs.push_back(n);
+        }
+    }
+
+    return circuit;
+}
+
+// Write a circuit in the netlist format read by part 2 and part 3, returns false if the file cannot be written
+bool writeNetlist(const CompiledCircuit &circuit, const std::string &filename)
+{
+    static const char *names[] = {"BUF", "INV", "AND", "OR", "NAND", "NOR"};
+
+    BufferedWriter fout(filename);
+    if (!fout.isOpen())
+    {
+        std::cerr << "Unable to write the netlist " << filename << std::endl;
+        return false;
+    }
+
+    for (int j = 0; j < circuit.gates.size(); ++j)
+    {
+        const CompiledGate &g = circuit.gates[j];
+
+        fout.write(names[g.op]);
+        fout.writeChar(' ');
+        fout.writeInt(g.in1 + 1);
+        if (g.op != OP_BUF && g.op != OP_INV)
+        {
+            fout.writeChar(' ');
+            fout.writeInt(g.in2 + 1);
+        }
+        fout.writeChar(' ');
+        fout.writeInt(g.out + 1);
+        fout.writeChar('\n');
+    }
+
+    fout.write("INPUT");
+    for (int i = 0; i < circuit.inputs.size(); ++i)
+    {
+        fout.writeChar(' ');
+        fout.writeInt(circuit.inputs[i] + 1);
+    }
+    fout.write(" -1\nOUTPUT");
+    for (int i = 0; i < circuit.outputs.size(); ++i)
+    {
+        fout.writeChar(' ');
+        fout.writeInt(circuit.outputs[i] + 1);
+    }
+    fout.write(" -1\n");
+
+    return true;
+}
+
+// Run a program and wait for it, its standard output is returned in output
+// Returns false if the program can not be started or exits with an error
+bool runProgram(const std::vector<std::string> &args, std::string &output, double &seconds, long &peak_rss)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if (pid == 0)
+    {
+        std::vector<char *> argv;
+        for (int i = 0; i < args.size(); ++i)
+        {
+            argv.push_back(const_cast<char *>(args[i].c_str()));
+        }
+        argv.push_back(nullptr);
+
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    close(fds[1]);
+
+    output.clear();
+    char buffer[4096];
+    ssize_t count;
+    while ((count = read(fds[0], buffer, sizeof(buffer))) > 0)
+    {
+        output.append(buffer, count);
+    }
+    close(fds[0]);
+
+    int status;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    peak_rss = usage.ru_maxrss;
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        std::cerr << "The command " << args[0] << " failed" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Number following a label in the output of a program, eg. the backtracks in "made 10 decisions and 3 backtracks"
+// Returns 0 if the label is not found
+double numberBefore(const std::string &output, const std::string &label)
+{
+    size_t end = output.rfind(" " + label);
+    if (end == std::string::npos)
+    {
+        return 0;
+    }
+
+    size_t start = output.find_last_of(" \n", end - 1);
+    start = start == std::string::npos ? 0 : start + 1;
+
+    return std::atof(output.substr(start, end - start).c_str());
+}
+
+// Measurements of one benchmark, written as one JSON object
+class BenchmarkResult
+{
+
+public:
+    std::string name;
+    std::vector<std::pair<std::string, double>> metrics;
+
+    BenchmarkResult(const std::string &_name)
+    {
+        name = _name;
+    }
+
+    void add(const std::string &metric, double value)
+    {
+        metrics.push_back(std::make_pair(metric, value));
+    }
+};
+
+// Write the results as JSON, one benchmark per line so that the baseline can be read back line by line
+void writeResults(const std::vector<BenchmarkResult> &results, std::ostream &out)
+{
+    out << "{\"benchmarks\": [" << std::endl;
+
+    for (int i = 0; i < results.size(); ++i)
+    {
+        out << "  {\"name\": \"" << results[i].name << "\"";
+        for (int k = 0; k < results[i].metrics.size(); ++k)
+        {
+            out << ", \"" << results[i].metrics[k].first << "\": " << std::setprecision(6) << results[i].metrics[k].second;
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+
+    out << "]}" << std::endl;
+}
+
+// Read the metrics of a results file written by writeResults, indexed by benchmark and metric name
+bool readResults(const std::string &filename, std::map<std::string, std::map<std::string, double>> &results)
+{
+    std::ifstream fin(filename);
+    if (!fin.is_open())
+    {
+        std::cerr << "Unable to open the baseline " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (getline(fin, line))
+    {
+        // Every benchmark line is a flat list of "key": value pairs, the name being the only string value
+        std::string name;
+        std::map<std::string, double> metrics;
+        size_t pos = 0;
+
+        while ((pos = line.find('"', pos)) != std::string::npos)
+        {
+            size_t end = line.find('"', pos + 1);
+            size_t colon = line.find(':', end);
+            if (end == std::string::npos || colon == std::string::npos)
+            {
+                break;
+            }
+
+            std::string key = line.substr(pos + 1, end - pos - 1);
+            size_t value = line.find_first_not_of(' ', colon + 1);
+
+            if (key == "name")
+            {
+                size_t close = line.find('"', value + 1);
+                name = line.substr(value + 1, close - value - 1);
+                pos = close + 1;
+            }
+            else
+            {
+                metrics[key] = std::atof(line.c_str() + value);
+                pos = line.find_first_of(",}", value);
+            }
+        }
+
+        if (!name.empty())
+        {
+            results[name] = metrics;
+        }
+    }
+
+    return true;
+}
+
+// Compare the results with a baseline, the throughputs (*_per_sec) may not drop and the peak memory and the
+// backtracks may not grow by more than the tolerance. Returns the number of regressions
+int compareResults(const std::vector<BenchmarkResult> &results, const std::map<std::string, std::map<std::string, double>> &baseline, double tolerance)
+{
+    int regressions = 0;
+
+    for (int i = 0; i < results.size(); ++i)
+    {
+        auto base = baseline.find(results[i].name);
+        if (base == baseline.end())
+        {
+            std::cerr << "No baseline for " << results[i].name << std::endl;
+            continue;
+        }
+
+        for (int k = 0; k < results[i].metrics.size(); ++k)
+        {
+            const std::string &metric = results[i].metrics[k].first;
+            double value = results[i].metrics[k].second;
+
+            auto it = base->second.find(metric);
+            if (it == base->second.end())
+            {
+                continue;
+            }
+
+            bool throughput = metric.size() > 8 && metric.compare(metric.size() - 8, 8, "_per_sec") == 0;
+            bool cost = metric == "peak_rss_kb" || metric == "backtracks";
+
+            if ((throughput && value < it->second * (1 - tolerance)) || (cost && value > it->second * (1 + tolerance)))
+            {
+                std::cerr << "Regression in " << results[i].name << ": " << metric << " " << it->second << " -> " << value << std::endl;
+                regressions++;
+            }
+        }
+    }
+
+    return regressions;
+}
+
+// Options of a benchmark run
+class BenchmarkOptions
+{
+
+public:
+    // Sizes of the generated netlists and the shape shared by all of them
+    std::vector<int> sizes;
+    GeneratorOptions generator;
+
+    // Patterns simulated in process, patterns written for part 2, faults sampled for fault simulation and ATPG
+    int patterns;
+    int file_patterns;
+    int faults;
+    int atpg_faults;
+
+    // Backtrack limit given to part 3 and conflict limit of the SAT engine
+    int backtracks;
+    long conflicts;
+
+    // Programs to benchmark, skipped when empty, and the part 2 engines to run
+    std::string part2;
+    std::string part3;
+    std::vector<std::string> engines;
+
+    // Directory caching the compiled simulation kernels, the compiled benchmark is skipped when empty
+    std::string kernel_cache;
+
+    // Threads of the level parallel logic simulation, the benchmark is skipped for 1
+    int level_threads;
+
+    // Directory of the generated files, results file (empty for the standard output), baseline to compare with
+    std::string dir;
+    std::string output;
+    std::string baseline;
+    double tolerance;
+
+    BenchmarkOptions()
+    {
+        sizes = {1000, 10000, 100000};
+        patterns = 4096;
+        file_patterns = 256;
+        faults = 1000;
+        atpg_faults = 100;
+        backtracks = 100;
+        conflicts = 10000;
+        engines = {"parallel"};
+        level_threads = 1;
+        dir = ".";
+        tolerance = 0.2;
+    }
+};
+
+// Faults drawn at random from the stuck at faults of the nets and the fanout branches
+std::vector<Fault> sampleFaults(const FaultSites &sites, int count, std::mt19937_64 &rng)
+{
+    std::vector<Fault> faults;
+
+    for (int i = 0; i < count; ++i)
+    {
+        int site = rng() % sites.num_sites;
+        int value = rng() % 2;
+
+        if (site < sites.num_nets)
+        {
+            faults.push_back(Fault(site + 1, value));
+        }
+        else
+        {
+            faults.push_back(Fault(sites.branch_net[site - sites.num_nets], value, sites.branch_gate[site - sites.num_nets]));
+        }
+    }
+
+    return faults;
+}
+
+// Run every benchmark on one generated netlist
+bool benchmarkNetlist(const BenchmarkOptions &options, int size, std::vector<BenchmarkResult> &results)
+{
+    GeneratorOptions generator = options.generator;
+    generator.gates = size;
+
+    std::string tag = std::to_string(size);
+    std::mt19937_64 rng(generator.seed);
+
+    auto start = std::chrono::steady_clock::now();
+    CompiledCircuit circuit = generateNetlist(generator);
+    FaultSites sites = compiledSites(circuit);
+    double generate_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int num_gates = circuit.gates.size();
+    int num_inputs = circuit.inputs.size();
+
+    std::cerr << "Netlist of " << num_gates << " gates, " << num_inputs << " inputs and " << circuit.outputs.size() << " outputs generated in " << generate_seconds << " s" << std::endl;
+
+    BenchmarkResult generated("generate/" + tag);
+    generated.add("gates", num_gates);
+    generated.add("seconds", generate_seconds);
+    results.push_back(generated);
+
+    // Random input words, 64 patterns per word
+    int words = std::max(1, options.patterns / 64);
+    std::vector<std::vector<uint64_t>> chunks(words, std::vector<uint64_t>(num_inputs));
+    for (int w = 0; w < words; ++w)
+    {
+        for (int i = 0; i < num_inputs; ++i)
+        {
+            chunks[w][i] = rng();
+        }
+    }
+
+    // Logic simulation, 64 patterns per gate evaluation
+    // The patterns are simulated again until MIN_SECONDS have passed and the fastest pass is kept, which filters
+    // out the noise of short runs
+    PatternParallelFaultSimulator pattern_simulator(circuit, sites);
+    double seconds = 0, total_seconds = 0;
+
+    while (total_seconds < MIN_SECONDS)
+    {
+        start = std::chrono::steady_clock::now();
+        for (int w = 0; w < words; ++w)
+        {
+            pattern_simulator.simulateGood(chunks[w]);
+        }
+        double pass = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        seconds = total_seconds == 0 ? pass : std::min(seconds, pass);
+        total_seconds += pass;
+    }
+
+    BenchmarkResult logic("logic/" + tag);
+    logic.add("seconds", seconds);
+    logic.add("patterns_per_sec", 64.0 * words / seconds);
+    logic.add("gate_evals_per_sec", 64.0 * words * num_gates / seconds);
+    results.push_back(logic);
+
+    // Level parallel logic simulation of the same patterns
+    if (options.level_threads > 1)
+    {
+        LevelParallelExecutor executor(circuit, options.level_threads);
+        pattern_simulator.useExecutor(&executor);
+
+        seconds = 0;
+        total_seconds = 0;
+
+        while (total_seconds < MIN_SECONDS)
+        {
+            start = std::chrono::steady_clock::now();
+            for (int w = 0; w < words; ++w)
+            {
+                pattern_simulator.simulateGood(chunks[w]);
+            }
+            double pass = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            seconds = total_seconds == 0 ? pass : std::min(seconds, pass);
+            total_seconds += pass;
+        }
+
+        pattern_simulator.useExecutor(nullptr);
+
+        BenchmarkResult levels("logic_levels/" + tag);
+        levels.add("seconds", seconds);
+        levels.add("threads", executor.numThreads());
+        levels.add("stages", executor.stage_parallel.size());
+        levels.add("patterns_per_sec", 64.0 * words / seconds);
+        levels.add("gate_evals_per_sec", 64.0 * words * num_gates / seconds);
+        results.push_back(levels);
+    }
+
+    // Compiled code logic simulation of the same patterns, the first use of a netlist includes its compilation
+    if (!options.kernel_cache.empty())
+    {
+        CompiledKernel kernel;
+        std::string error;
+        std::vector<uint64_t> values(circuit.num_nets, 0);
+
+        start = std::chrono::steady_clock::now();
+        if (!kernel.load(circuit, options.kernel_cache, error))
+        {
+            std::cerr << "Compiled kernel unavailable, " << error << std::endl;
+            return false;
+        }
+        double load_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        seconds = 0;
+        total_seconds = 0;
+
+        while (total_seconds < MIN_SECONDS)
+        {
+            start = std::chrono::steady_clock::now();
+            for (int w = 0; w < words; ++w)
+            {
+                for (int i = 0; i < num_inputs; ++i)
+                {
+                    values[circuit.inputs[i]] = chunks[w][i];
+                }
+                kernel.evaluate(values.data());
+            }
+            double pass = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            seconds = total_seconds == 0 ? pass : std::min(seconds, pass);
+            total_seconds += pass;
+        }
+
+        BenchmarkResult compiled("logic_compiled/" + tag);
+        compiled.add("seconds", seconds);
+        compiled.add("load_seconds", load_seconds);
+        compiled.add("cached", kernel.wasCached());
+        compiled.add("patterns_per_sec", 64.0 * words / seconds);
+        compiled.add("gate_evals_per_sec", 64.0 * words * num_gates / seconds);
+        results.push_back(compiled);
+    }
+
+    // Pattern parallel fault simulation of a fault sample
+    std::vector<Fault> faults = sampleFaults(sites, options.faults, rng);
+    long detections = 0;
+
+    start = std::chrono::steady_clock::now();
+    for (int w = 0; w < words; ++w)
+    {
+        pattern_simulator.simulateGood(chunks[w]);
+        for (int f = 0; f < faults.size(); ++f)
+        {
+            detections += pattern_simulator.detect(faults[f], ~0ULL) != 0;
+        }
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    BenchmarkResult pattern_parallel("pattern_parallel/" + tag);
+    pattern_parallel.add("seconds", seconds);
+    pattern_parallel.add("patterns_per_sec", 64.0 * words / seconds);
+    pattern_parallel.add("faults_per_sec", 64.0 * words * faults.size() / seconds);
+    pattern_parallel.add("detections", detections);
+    results.push_back(pattern_parallel);
+
+    // Parallel fault simulation of the sample, one pattern at a time against 63 faults per word
+    ParallelFaultSimulator fault_simulator(circuit, sites);
+    std::vector<int> pattern(num_inputs), targets, detected;
+    for (int f = 0; f < faults.size(); ++f)
+    {
+        targets.push_back(f);
+    }
+
+    int single_patterns = std::min(64, options.patterns);
+    detections = 0;
+
+    start = std::chrono::steady_clock::now();
+    for (int p = 0; p < single_patterns; ++p)
+    {
+        for (int i = 0; i < num_inputs; ++i)
+        {
+            pattern[i] = (chunks[0][i] >> p) & 1;
+        }
+        fault_simulator.simulate(pattern, faults, targets, detected);
+        detections += detected.size();
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    BenchmarkResult fault_parallel("fault_parallel/" + tag);
+    fault_parallel.add("seconds", seconds);
+    fault_parallel.add("patterns_per_sec", single_patterns / seconds);
+    fault_parallel.add("faults_per_sec", (double)single_patterns * faults.size() / seconds);
+    fault_parallel.add("detections", detections);
+    results.push_back(fault_parallel);
+
+    // SAT test generation for a smaller sample
+    std::vector<Fault> atpg_faults = sampleFaults(sites, options.atpg_faults, rng);
+    SatTestGenerator sat(circuit, sites);
+    std::string test;
+    long conflicts = 0;
+    int tests = 0, untestable = 0;
+
+    start = std::chrono::steady_clock::now();
+    for (int f = 0; f < atpg_faults.size(); ++f)
+    {
+        SatStatus status = sat.generate(atpg_faults[f], options.conflicts, test);
+        conflicts += sat.lastConflicts();
+        tests += status == SAT_SATISFIABLE;
+        untestable += status == SAT_UNSATISFIABLE;
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    BenchmarkResult sat_atpg("sat_atpg/" + tag);
+    sat_atpg.add("seconds", seconds);
+    sat_atpg.add("faults_per_sec", atpg_faults.size() / seconds);
+    sat_atpg.add("tests", tests);
+    sat_atpg.add("untestable", untestable);
+    sat_atpg.add("conflicts", conflicts);
+    results.push_back(sat_atpg);
+
+    if (options.part2.empty() && options.part3.empty())
+    {
+        return true;
+    }
+
+    // Files for the programs
+    std::string netlist = options.dir + "/bench_" + tag + ".txt";
+    if (!writeNetlist(circuit, netlist))
+    {
+        return false;
+    }
+
+    std::string output;
+    long peak_rss;
+
+    if (!options.part2.empty())
+    {
+        std::string patterns = options.dir + "/i_bench_" + tag + ".txt";
+        BufferedWriter fpatterns(patterns);
+
+        for (int p = 0; p < options.file_patterns; ++p)
+        {
+            for (int i = 0; i < num_inputs; ++i)
+            {
+                fpatterns.writeChar('0' + ((chunks[(p / 64) % words][i] >> (p % 64)) & 1));
+            }
+            fpatterns.writeChar('\n');
+        }
+        fpatterns.close();
+
+        for (int e = 0; e < options.engines.size(); ++e)
+        {
+            std::vector<std::string> args = {options.part2, "-e", options.engines[e], "-i", patterns, "-o", options.dir + "/o_bench_" + tag + ".txt", "-d", options.dir + "/d_bench_" + tag + ".txt", netlist};
+
+            if (!runProgram(args, output, seconds, peak_rss))
+            {
+                return false;
+            }
+
+            // Simulated P patterns, D of F faults detected.
+            double patterns_run = numberBefore(output, "patterns,");
+            double total = numberBefore(output, "faults detected.");
+
+            BenchmarkResult part2("part2_" + options.engines[e] + "/" + tag);
+            part2.add("seconds", seconds);
+            part2.add("patterns_per_sec", patterns_run / seconds);
+            part2.add("faults_per_sec", patterns_run * total / seconds);
+            part2.add("peak_rss_kb", peak_rss);
+            results.push_back(part2);
+        }
+    }
+
+    if (!options.part3.empty())
+    {
+        std::string fault_file = options.dir + "/f_bench_" + tag + ".txt";
+        std::ofstream ffaults(fault_file);
+
+        for (int f = 0; f < atpg_faults.size(); ++f)
+        {
+            if (atpg_faults[f].gate == -1)
+            {
+                ffaults << atpg_faults[f].net_id << " " << atpg_faults[f].value << std::endl;
+            }
+            else
+            {
+                ffaults << atpg_faults[f].net_id << ">" << circuit.gates[atpg_faults[f].gate].out + 1 << " " << atpg_faults[f].value << std::endl;
+            }
+        }
+        ffaults.close();
+
+        std::vector<std::string> args = {options.part3, "-B", std::to_string(options.backtracks), "-f", fault_file, "-o", options.dir + "/o_bench_" + tag + ".txt", netlist};
+
+        if (!runProgram(args, output, seconds, peak_rss))
+        {
+            return false;
+        }
+
+        // PODEM made N decisions and M backtracks.
+        BenchmarkResult part3("part3/" + tag);
+        part3.add("seconds", seconds);
+        part3.add("faults_per_sec", atpg_faults.size() / seconds);
+        part3.add("decisions", numberBefore(output, "decisions and"));
+        part3.add("backtracks", numberBefore(output, "backtracks."));
+        part3.add("aborted", numberBefore(output, "faults."));
+        part3.add("peak_rss_kb", peak_rss);
+        results.push_back(part3);
+    }
+
+    return true;
+}
+
+// Split a comma separated list
+std::vector<std::string> splitList(const std::string &text)
+{
+    std::vector<std::string> items;
+    std::stringstream ss(text);
+    std::string item;
+
+    while (getline(ss, item, ','))
+    {
+        if (!item.empty())
+        {
+            items.push_back(item);
+        }
+    }
+
+    return items;
+}
+
+void printUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " [options]" << std::endl;
+    std::cout << "       " << program << " [options] --generate <netlist>" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Netlist options:" << std::endl;
+    std::cout << "  --sizes <list>         gate counts of the generated netlists (default 1000,10000,100000)" << std::endl;
+    std::cout << "  --gates <n>            gate count of the netlist written by --generate (default 10000)" << std::endl;
+    std::cout << "  --inputs <n>           primary inputs (default the width of a level)" << std::endl;
+    std::cout << "  --depth <n>            logic levels (default 32)" << std::endl;
+    std::cout << "  --fanout <n>           fanout above which a net is avoided (default 8)" << std::endl;
+    std::cout << "  --reconvergence <pct>  share of gate inputs taken next to the other input (default 30)" << std::endl;
+    std::cout << "  --seed <n>             seed of the generator (default 1)" << std::endl;
+    std::cout << "  -g, --generate <file>  only write one generated netlist" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Benchmark options:" << std::endl;
+    std::cout << "  --patterns <n>         patterns simulated in process (default 4096)" << std::endl;
+    std::cout << "  --file-patterns <n>    patterns written for part 2 (default 256)" << std::endl;
+    std::cout << "  --faults <n>           faults sampled for fault simulation (default 1000)" << std::endl;
+    std::cout << "  --atpg-faults <n>      faults sampled for test generation (default 100)" << std::endl;
+    std::cout << "  --backtracks <n>       backtrack limit of part 3 (default 100)" << std::endl;
+    std::cout << "  --conflicts <n>        conflict limit of the SAT engine (default 10000)" << std::endl;
+    std::cout << "  --part2 <program>      part 2 executable to benchmark" << std::endl;
+    std::cout << "  --part3 <program>      part 3 executable to benchmark" << std::endl;
+    std::cout << "  --engines <list>       part 2 fault simulation engines (default parallel)" << std::endl;
+    std::cout << "  --compiled <dir>       also time the compiled code logic simulation, kernels cached in dir" << std::endl;
+    std::cout << "  --level-threads <n>    also time the level parallel logic simulation on n threads" << std::endl;
+    std::cout << "  --dir <path>           directory of the generated files (default .)" << std::endl;
+    std::cout << "  -o, --output <file>    JSON results (default the standard output)" << std::endl;
+    std::cout << "  --baseline <file>      JSON results to compare with, regressions make the run fail" << std::endl;
+    std::cout << "  --tolerance <pct>      allowed change against the baseline (default 20)" << std::endl;
+    std::cout << "  -h, --help             print this message" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    BenchmarkOptions options;
+    std::string generate;
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        std::string arg = args[i];
+
+        if (arg == "-h" || arg == "--help" || i + 1 >= args.size())
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        std::string value = args[++i];
+
+        if (arg == "--sizes")
+        {
+            std::vector<std::string> items = splitList(value);
+            options.sizes.clear();
+            for (int k = 0; k < items.size(); ++k)
+            {
+                options.sizes.push_back(std::atoi(items[k].c_str()));
+            }
+        }
+        else if (arg == "--gates")
+        {
+            options.generator.gates = std::atoi(value.c_str());
+        }
+        else if (arg == "--inputs")
+        {
+            options.generator.inputs = std::atoi(value.c_str());
+        }
+        else if (arg == "--depth")
+        {
+            options.generator.depth = std::atoi(value.c_str());
+        }
+        else if (arg == "--fanout")
+        {
+            options.generator.max_fanout = std::atoi(value.c_str());
+        }
+        else if (arg == "--reconvergence")
+        {
+            options.generator.reconvergence = std::atoi(value.c_str());
+        }
+        else if (arg == "--seed")
+        {
+            options.generator.seed = std::strtoull(value.c_str(), nullptr, 10);
+        }
+        else if (arg == "-g" || arg == "--generate")
+        {
+            generate = value;
+        }
+        else if (arg == "--patterns")
+        {
+            options.patterns = std::atoi(value.c_str());
+        }
+        else if (arg == "--file-patterns")
+        {
+            options.file_patterns = std::atoi(value.c_str());
+        }
+        else if (arg == "--faults")
+        {
+            options.faults = std::atoi(value.c_str());
+        }
+        else if (arg == "--atpg-faults")
+        {
+            options.atpg_faults = std::atoi(value.c_str());
+        }
+        else if (arg == "--backtracks")
+        {
+            options.backtracks = std::atoi(value.c_str());
+        }
+        else if (arg == "--conflicts")
+        {
+            options.conflicts = std::atol(value.c_str());
+        }
+        else if (arg == "--part2")
+        {
+            options.part2 = value;
+        }
+        else if (arg == "--part3")
+        {
+            options.part3 = value;
+        }
+        else if (arg == "--compiled")
+        {
+            options.kernel_cache = value;
+        }
+        else if (arg == "--level-threads")
+        {
+            options.level_threads = std::atoi(value.c_str());
+        }
+        else if (arg == "--engines")
+        {
+            options.engines = splitList(value);
+        }
+        else if (arg == "--dir")
+        {
+            options.dir = value;
+        }
+        else if (arg == "-o" || arg == "--output")
+        {
+            options.output = value;
+        }
+        else if (arg == "--baseline")
+        {
+            options.baseline = value;
+        }
+        else if (arg == "--tolerance")
+        {
+            options.tolerance = std::atof(value.c_str()) / 100;
+        }
+        else
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < options.sizes.size(); ++i)
+    {
+        if (options.sizes[i] < 1)
+        {
+            std::cerr << "Invalid netlist size " << options.sizes[i] << std::endl;
+            return 1;
+        }
+    }
+
+    if (options.generator.gates < 1 || options.generator.depth < 1 || options.patterns < 1 || options.faults < 1 || options.atpg_faults < 1)
+    {
+        std::cerr << "The gates, depth, patterns and fault counts have to be positive" << std::endl;
+        return 1;
+    }
+
+    // Generator only
+    if (!generate.empty())
+    {
+        return writeNetlist(generateNetlist(options.generator), generate) ? 0 : 1;
+    }
+
+    std::vector<BenchmarkResult> results;
+    for (int i = 0; i < options.sizes.size(); ++i)
+    {
+        if (!benchmarkNetlist(options, options.sizes[i], results))
+        {
+            return 1;
+        }
+    }
+
+    if (options.output.empty())
+    {
+        writeResults(results, std::cout);
+    }
+    else
+    {
+        std::ofstream fout(options.output);
+        writeResults(results, fout);
+    }
+
+    if (!options.baseline.empty())
+    {
+        std::map<std::string, std::map<std::string, double>> baseline;
+        if (!readResults(options.baseline, baseline))
+        {
+            return 1;
+        }
+
+        int regressions = compareResults(results, baseline, options.tolerance);
+        if (regressions > 0)
+        {
+            std::cerr << regressions << " regressions against " << options.baseline << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <limits.h>
+
+#include "JobServer.h"
+
+// Send the standard input to the server until its end
+bool streamInput(int fd)
+{
+    std::vector<char> buffer(1 << 16);
+
+    while (true)
+    {
+        ssize_t n = read(0, buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            return false;
+        }
+        if (n == 0)
+        {
+            return true;
+        }
+        if (!sendAll(fd, std::string(buffer.data(), n)))
+        {
+            return false;
+        }
+    }
+}
+
+void printUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " <socket> <job arguments>" << std::endl;
+    std::cout << "       " << program << " <socket> " << SERVER_SHUTDOWN << std::endl;
+    std::cout << std::endl;
+    std::cout << "Sends one job to a part2 or part3 server started with --serve <socket> and prints its report." << std::endl;
+    std::cout << "The job takes the arguments of a batch manifest line, relative paths are resolved against the" << std::endl;
+    std::cout << "current directory and a file given as - is streamed from the standard input, eg. part2 -i -." << std::endl;
+    std::cout << "The exit status is the one of the job." << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::string path = argv[1];
+    std::string line;
+    bool stream = false;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        line += (i > 2 ? " " : "") + std::string(argv[i]);
+        stream = stream || std::string(argv[i]) == "-";
+    }
+
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == nullptr)
+    {
+        std::cerr << "Unable to get the current directory" << std::endl;
+        return 1;
+    }
+
+    // Connect to the server
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "The socket path " << path << " is too long" << std::endl;
+        return 1;
+    }
+    std::strcpy(address.sun_path, path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr *)&address, sizeof(address)) != 0)
+    {
+        std::cerr << "Unable to connect to the server on " << path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    // Send the request, then the streamed input, and close the sending side so the server sees its end
+    if (!sendAll(fd, std::string(cwd) + "\n" + line + "\n") || (stream && !streamInput(fd)))
+    {
+        std::cerr << "The server closed the connection" << std::endl;
+        close(fd);
+        return 1;
+    }
+    shutdown(fd, SHUT_WR);
+
+    // Read the report, the last line holds the exit status of the job
+    std::string response;
+    std::vector<char> buffer(1 << 16);
+    ssize_t n;
+
+    while ((n = read(fd, buffer.data(), buffer.size())) > 0 || (n < 0 && errno == EINTR))
+    {
+        if (n > 0)
+        {
+            response.append(buffer.data(), n);
+        }
+    }
+    close(fd);
+
+    size_t last = response.rfind("exit ");
+    if (last == std::string::npos || (last > 0 && response[last - 1] != '\n'))
+    {
+        std::cout << response;
+        std::cerr << "Incomplete response from the server" << std::endl;
+        return 1;
+    }
+
+    std::cout << response.substr(0, last);
+
+    return std::atoi(response.c_str() + last + 5);
+}
@@ -0,0 +1,168 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <chrono>
+#include <cstdlib>
+
+#include "FaultDictionary.h"
+
+// Read a failure log, one failing pattern per line followed by its failing output nets, eg. "12 22 23"
+// The patterns are numbered from 0 in the order they were simulated, lines starting with # are comments
+bool readFailures(const std::string &filename, const FaultDictionary &dictionary, std::vector<std::pair<int, int>> &failures)
+{
+    std::ifstream fin(filename);
+
+    if (!fin.is_open())
+    {
+        std::cerr << "Unable to open the failure log " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int line_number = 0;
+
+    while (getline(fin, line))
+    {
+        line_number++;
+        std::stringstream ss(line);
+        int pattern, net;
+
+        if (!(ss >> pattern) || line[0] == '#')
+        {
+            continue;
+        }
+
+        if (pattern < 0 || pattern >= dictionary.numPatterns())
+        {
+            std::cerr << "Pattern " << pattern << " on line " << line_number << " is not in the dictionary" << std::endl;
+            return false;
+        }
+
+        while (ss >> net)
+        {
+            int output = dictionary.outputIndex(net);
+            if (output == -1)
+            {
+                std::cerr << "Net " << net << " on line " << line_number << " is not a primary output" << std::endl;
+                return false;
+            }
+
+            failures.push_back(std::make_pair(pattern, output));
+        }
+    }
+
+    return true;
+}
+
+void printUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " [options] <dictionary> <failure log>" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Ranks the faults of a dictionary built by part2 --dictionary against an observed response." << std::endl;
+    std::cout << "Every line of the failure log holds a failing pattern, numbered from 0, and its failing output nets." << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -n, --candidates <n>   number of fault classes reported (default 10)" << std::endl;
+    std::cout << "  -h, --help             print this message" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> files;
+    int max_candidates = 10;
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        std::string arg = args[i];
+
+        if (arg == "-h" || arg == "--help")
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        if (arg.empty() || arg[0] != '-')
+        {
+            files.push_back(arg);
+            continue;
+        }
+
+        if (i + 1 >= args.size())
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 1;
+        }
+
+        std::string value = args[++i];
+
+        if (arg == "-n" || arg == "--candidates")
+        {
+            max_candidates = std::atoi(value.c_str());
+            if (max_candidates < 1)
+            {
+                std::cerr << "Invalid candidate count " << value << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (files.size() != 2)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    FaultDictionary dictionary;
+    std::string error;
+
+    if (!dictionary.open(files[0], error))
+    {
+        std::cerr << "Unable to load the dictionary: " << error << std::endl;
+        return 1;
+    }
+
+    std::vector<std::pair<int, int>> failures;
+    if (!readFailures(files[1], dictionary, failures))
+    {
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<DiagnosisCandidate> candidates = dictionary.diagnose(failures, max_candidates);
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Dictionary " << files[0] << ": " << dictionary.numFaults() << " faults in " << dictionary.numEntries() << " classes, " << dictionary.numPatterns() << " patterns, " << dictionary.numOutputs() << " outputs." << std::endl;
+    std::cout << "Ranked " << candidates.size() << " candidates in " << elapsed << " ms." << std::endl;
+
+    // Faults of every class
+    std::vector<std::vector<int>> members(dictionary.numEntries());
+    for (int i = 0; i < dictionary.numFaults(); ++i)
+    {
+        members[dictionary.fault(i).entry].push_back(i);
+    }
+
+    for (int r = 0; r < candidates.size(); ++r)
+    {
+        const DiagnosisCandidate &c = candidates[r];
+
+        std::cout << r + 1 << ". " << c.mismatches << " mismatching patterns (" << c.matched << " matched, " << c.missing << " missing, " << c.extra << " extra):";
+
+        for (int i : members[c.entry])
+        {
+            const DictionaryFault &f = dictionary.fault(i);
+            std::cout << " " << f.net << (f.branch != 0 ? ">" + std::to_string(f.branch) : "") << " " << f.value;
+        }
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
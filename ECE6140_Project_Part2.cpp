@@ -5,110 +5,33 @@
 #include <sstream>
 #include <fstream>
 #include <algorithm>
-
-class Net
-{
-
-public:
-    // Information about the Net
-    int id;
-
-    // Information about connected Gates
-    std::vector<int> gates_into;
-    int input;
-
-    // Value that the net carries
-    int value;
-
-    // Class constructor
-    Net(int value, int _id, int _input)
-    {
-        value = value;
-        id = _id;
-        input = _input;
-    }
-
-    // Default constructor
-    Net()
-    {
-        value = -1;
-        id = -1;
-        input = -1;
-    }
-};
-
-class Fault
-{
-public:
-    int net_id;
-    int value;
-
-    Fault(int _net_id, int _value)
-    {
-        net_id = _net_id;
-        value = _value;
-    }
-
-    Fault()
-    {
-        net_id = -1;
-        value = -1;
-    }
-
-    bool operator<(const Fault &struct2) const
-    {
-        return std::tie(net_id, value) < std::tie(struct2.net_id, struct2.value);
-    }
-
-    bool operator==(const Fault &struct2) const
-    {
-        return std::tie(net_id, value) == std::tie(struct2.net_id, struct2.value);
-    }
-};
-
-class Gate
-{
-
-public:
-    // Information about the gate
-    std::string type;
-    int id;
-
-    // Net information
-    std::vector<Net> input_nets;
-    Net output_net;
-
-    // Class constructor for two input gates
-    Gate(std::string _type, int _id, Net in1, Net in2, Net out)
-    {
-        type = _type;
-        id = _id;
-
-        input_nets.push_back(in1);
-        input_nets.push_back(in2);
-        output_net = out;
-    }
-
-    // Class constructor for one input gates
-    Gate(std::string _type, int _id, Net in1, Net out)
-    {
-        type = _type;
-        id = _id;
-
-        input_nets.push_back(in1);
-        output_net = out;
-    }
-};
-
-// Function to compare two nets based on their ID
-// Used for inserting net into the list of nets in order of the ID
-bool compareById(const Net &net1, const Net &net2)
-{
-    return net1.id < net2.id;
-}
+#include <set>
+#include <tuple>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <functional>
+
+#include "ThreadPool.h"
+#include "Netlist.h"
+#include "Fault.h"
+#include "FaultCollapse.h"
+#include "PatternIO.h"
+#include "CompiledCircuit.h"
+#include "ParallelFaultSim.h"
+#include "TransitionFaultSim.h"
+#include "SequentialFaultSim.h"
+#include "Instrumentation.h"
+#include "CompiledKernel.h"
+#include "LevelParallel.h"
+#include "JobServer.h"
+#include "FaultDictionary.h"
 
 void evaluateGate(Gate &g, std::vector<Net> &net_list, std::vector<Gate> &gate_list)
 {
+    INSTRUMENT_COUNT(COUNTER_GATE_EVALS, 1);
+
     // Temporary variables for calculation
     int inval1, inval2, outval;
 
@@ -150,36 +73,71 @@ void evaluateGate(Gate &g, std::vector<Net> &net_list, std::vector<Gate> &gate_l
     }
 
     // Update the value in the gate list
-    net_list[g.output_net.id - 1].value = outval;
+    Net &out = net_list[g.output_net.id - 1];
+    out.value = outval;
 
-    // Find all gates which have the net as an input
-    for (int j = 0; j < gate_list.size(); ++j)
+    // Update the value of the net in the gates which have it as an input
+    for (int j = 0; j < out.gates_into.size(); ++j)
     {
-        // For all the inputs of a given gate
-        for (int k = 0; k < gate_list[j].input_nets.size(); ++k)
+        Gate &fed = gate_list[out.gates_into[j]];
+        for (int k = 0; k < fed.input_nets.size(); ++k)
         {
-            // For all the input which is the current net
-            if (gate_list[j].input_nets[k].id == net_list[g.output_net.id - 1].id)
+            if (fed.input_nets[k].id == out.id)
             {
-                // Update the value of the net in the gate object list
-                gate_list[j].input_nets[k].value = net_list[g.output_net.id - 1].value;
+                fed.input_nets[k].value = out.value;
             }
         }
     }
 }
 
-void calculateFaultList(Gate &g, std::vector<Net> &net_list, int c, int inval1, int inval2, int correct_val, std::vector<Fault> *&fault_lists, std::vector<Fault> &global_fault_list, int *added_to_fault)
+// Fault on input pin k of a gate stuck at the opposite of the value of its net, when the pin is a fanout branch whose
+// fault is simulated. The simulated faults are flagged by site, at 2 * site + value. Returns false if there is none
+bool pinFault(const Gate &g, int k, const std::vector<Net> &net_list, const FaultSites &sites, const std::vector<char> &simulated, Fault &fault)
+{
+    int site = sites.branch_site[2 * g.id + k];
+    if (site == -1)
+    {
+        return false;
+    }
+
+    int id = g.input_nets[k].id;
+    int value = !net_list[id - 1].value;
+
+    if (!simulated[2 * site + value])
+    {
+        return false;
+    }
+
+    fault = Fault(id, value, g.id);
+    return true;
+}
+
+// Insert a fault into a sorted fault list, returns false if the list already holds it
+bool insertFault(std::vector<Fault> &list, const Fault &fault)
+{
+    auto it = std::lower_bound(list.begin(), list.end(), fault);
+    if (it != list.end() && *it == fault)
+    {
+        return false;
+    }
+
+    list.insert(it, fault);
+    return true;
+}
+
+void calculateFaultList(Gate &g, std::vector<Net> &net_list, int c, int inval1, int inval2, int correct_val, std::vector<Fault> *&fault_lists, std::vector<Fault> &global_fault_list, int *added_to_fault, const FaultSites &sites, const std::vector<char> &simulated)
 {
     // Create a list to store the result of the union
     std::vector<Fault> result;
 
-    // Fetch the fault lists of the input nets
-    std::vector<Fault> list1 = fault_lists[g.input_nets[0].id - 1];
-    std::vector<Fault> list2 = fault_lists[g.input_nets[1].id - 1];
+    // Fetch the sorted fault lists of the input nets, the fault of a fanout branch pin is inserted into the list of its
+    // net only while the gate is evaluated, the other branches share the list
+    std::vector<Fault> &list1 = fault_lists[g.input_nets[0].id - 1];
+    std::vector<Fault> &list2 = fault_lists[g.input_nets[1].id - 1];
 
-    // Sort the fault lists
-    std::sort(list1.begin(), list1.end());
-    std::sort(list2.begin(), list2.end());
+    Fault pin1, pin2;
+    bool added1 = pinFault(g, 0, net_list, sites, simulated, pin1) && insertFault(list1, pin1);
+    bool added2 = pinFault(g, 1, net_list, sites, simulated, pin2) && insertFault(list2, pin2);
 
     // If both inputs are controlling values
     if (inval1 == c && inval2 == c)
@@ -205,6 +163,16 @@ void calculateFaultList(Gate &g, std::vector<Net> &net_list, int c, int inval1,
         std::set_union(list1.begin(), list1.end(), list2.begin(), list2.end(), std::back_inserter(result));
     }
 
+    // Take the pin faults out of the lists of the nets again
+    if (added1)
+    {
+        list1.erase(std::lower_bound(list1.begin(), list1.end(), pin1));
+    }
+    if (added2)
+    {
+        list2.erase(std::lower_bound(list2.begin(), list2.end(), pin2));
+    }
+
     // Check for the fault on the output line
     // Fetch the input value of the gate
     correct_val = net_list[g.output_net.id - 1].value;
@@ -248,7 +216,7 @@ void calculateFaultList(Gate &g, std::vector<Net> &net_list, int c, int inval1,
     added_to_fault[g.output_net.id - 1] = 1;
 }
 
-void evaluateFaultList(Gate &g, std::vector<Net> &net_list, std::vector<Gate> &gate_list, std::vector<Fault> *fault_lists, std::vector<Fault> &global_fault_list, int *added_to_fault)
+void evaluateFaultList(Gate &g, std::vector<Net> &net_list, std::vector<Gate> &gate_list, std::vector<Fault> *fault_lists, std::vector<Fault> &global_fault_list, int *added_to_fault, const FaultSites &sites, const std::vector<char> &simulated)
 {
     // Temporary variables for calculation
     int correct_val;
@@ -270,6 +238,15 @@ void evaluateFaultList(Gate &g, std::vector<Net> &net_list, std::vector<Gate> &g
                                [id, val](const Fault &f)
                                { return f.net_id == id && f.value == val; });
 
+        // The output inherits the fault list of the input net
+        std::vector<Fault> result = fault_lists[g.input_nets[0].id - 1];
+
+        Fault pin;
+        if (pinFault(g, 0, net_list, sites, simulated, pin))
+        {
+            insertFault(result, pin);
+        }
+
         // If the fault was found
         if (it != global_fault_list.end())
         {
@@ -278,9 +255,9 @@ void evaluateFaultList(Gate &g, std::vector<Net> &net_list, std::vector<Gate> &g
 
             // Union with the fault list of the input net
             std::vector<Fault> list1 = {f};
-            std::vector<Fault> list2 = fault_lists[g.input_nets[0].id - 1];
+            std::vector<Fault> list2 = result;
 
-            std::vector<Fault> result;
+            result.clear();
 
             // Sort the vectors
             std::sort(list1.begin(), list1.end());
@@ -288,13 +265,13 @@ void evaluateFaultList(Gate &g, std::vector<Net> &net_list, std::vector<Gate> &g
 
             // Perform the union
             std::set_union(list1.begin(), list1.end(), list2.begin(), list2.end(), std::back_inserter(result));
+        }
 
-            // Add to the fault list of the respective net
-            fault_lists[g.output_net.id - 1] = result;
+        // Add to the fault list of the respective net
+        fault_lists[g.output_net.id - 1] = result;
 
-            // Update the appropriate flag
-            added_to_fault[g.output_net.id - 1] = 1;
-        }
+        // Update the appropriate flag
+        added_to_fault[g.output_net.id - 1] = 1;
     }
     else if (g.type == "INV")
     {
@@ -310,6 +287,15 @@ void evaluateFaultList(Gate &g, std::vector<Net> &net_list, std::vector<Gate> &g
                                [id, val](const Fault &f)
                                { return f.net_id == id && f.value == val; });
 
+        // The output inherits the fault list of the input net
+        std::vector<Fault> result = fault_lists[g.input_nets[0].id - 1];
+
+        Fault pin;
+        if (pinFault(g, 0, net_list, sites, simulated, pin))
+        {
+            insertFault(result, pin);
+        }
+
         // If the fault was found
         if (it != global_fault_list.end())
         {
@@ -318,9 +304,9 @@ void evaluateFaultList(Gate &g, std::vector<Net> &net_list, std::vector<Gate> &g
 
             // Union with the fault list of the input net
             std::vector<Fault> list1 = {f};
-            std::vector<Fault> list2 = fault_lists[g.input_nets[0].id - 1];
+            std::vector<Fault> list2 = result;
 
-            std::vector<Fault> result;
+            result.clear();
 
             // Sort the vectors
             std::sort(list1.begin(), list1.end());
@@ -328,13 +314,13 @@ void evaluateFaultList(Gate &g, std::vector<Net> &net_list, std::vector<Gate> &g
 
             // Perform the union
             std::set_union(list1.begin(), list1.end(), list2.begin(), list2.end(), std::back_inserter(result));
+        }
 
-            // Add to the fault list of the respective net
-            fault_lists[g.output_net.id - 1] = result;
+        // Add to the fault list of the respective net
+        fault_lists[g.output_net.id - 1] = result;
 
-            // Update the appropriate flag
-            added_to_fault[g.output_net.id - 1] = 1;
-        }
+        // Update the appropriate flag
+        added_to_fault[g.output_net.id - 1] = 1;
     }
     else if (g.type == "AND")
     {
@@ -348,7 +334,7 @@ void evaluateFaultList(Gate &g, std::vector<Net> &net_list, std::vector<Gate> &g
         i = 0;
 
         // Call the function to calculate the fault list
-        calculateFaultList(g, net_list, c, inval1, inval2, correct_val, fault_lists, global_fault_list, added_to_fault);
+        calculateFaultList(g, net_list, c, inval1, inval2, correct_val, fault_lists, global_fault_list, added_to_fault, sites, simulated);
     }
     else if (g.type == "OR")
     {
@@ -362,7 +348,7 @@ void evaluateFaultList(Gate &g, std::vector<Net> &net_list, std::vector<Gate> &g
         i = 0;
 
         // Call the function to calculate the fault list
-        calculateFaultList(g, net_list, c, inval1, inval2, correct_val, fault_lists, global_fault_list, added_to_fault);
+        calculateFaultList(g, net_list, c, inval1, inval2, correct_val, fault_lists, global_fault_list, added_to_fault, sites, simulated);
     }
     else if (g.type == "NAND")
     {
@@ -376,7 +362,7 @@ void evaluateFaultList(Gate &g, std::vector<Net> &net_list, std::vector<Gate> &g
         i = 1;
 
         // Call the function to calculate the fault list
-        calculateFaultList(g, net_list, c, inval1, inval2, correct_val, fault_lists, global_fault_list, added_to_fault);
+        calculateFaultList(g, net_list, c, inval1, inval2, correct_val, fault_lists, global_fault_list, added_to_fault, sites, simulated);
     }
     else if (g.type == "NOR")
     {
@@ -390,816 +376,1934 @@ void evaluateFaultList(Gate &g, std::vector<Net> &net_list, std::vector<Gate> &g
         i = 1;
 
         // Call the function to calculate the fault list
-        calculateFaultList(g, net_list, c, inval1, inval2, correct_val, fault_lists, global_fault_list, added_to_fault);
+        calculateFaultList(g, net_list, c, inval1, inval2, correct_val, fault_lists, global_fault_list, added_to_fault, sites, simulated);
     }
 }
 
-int main()
+// Output of a gate for the given input values, in2 is ignored by single input gates
+int gateOutput(const std::string &type, int in1, int in2)
 {
-    // Create the vectors to store the list of Gates and Nets
-    std::vector<Gate> gate_list;
-    std::vector<Net> net_list;
+    if (type == "BUF")
+    {
+        return in1;
+    }
+    else if (type == "INV")
+    {
+        return !in1;
+    }
+    else if (type == "AND")
+    {
+        return in1 & in2;
+    }
+    else if (type == "OR")
+    {
+        return in1 | in2;
+    }
+    else if (type == "NAND")
+    {
+        return !(in1 & in2);
+    }
 
-    // Create a vector to store the inputs and outputs of the circuit
-    std::vector<int> input_list;
-    std::vector<int> output_list;
+    return !(in1 | in2);
+}
 
-    // Initialise file pointers for the input, output and netlist files
-    std::ifstream fin;
-    std::ifstream finput;
-    std::ifstream ffault;
-    std::ofstream foutput;
-
-    // Select which file to open
-    int file_set = 0;
-    std::string filename;
-
-    // Get the input from the user
-    std::cout << "Enter the index of the file to use: ";
-    std::cin >> file_set;
-
-    // Open the set of input, output and netlist files according to the variable above
-    switch (file_set)
-    {
-    case 0:
-        filename = "s27.txt";
-        fin.open("s27.txt");
-        finput.open("i_s27.txt");
-        foutput.open("o_s27.txt");
-        ffault.open("f_s27.txt");
-        break;
-
-    case 1:
-        filename = "s298f_2.txt";
-        fin.open("s298f_2.txt");
-        finput.open("i_s298f_2.txt");
-        foutput.open("o_s298f_2.txt");
-        ffault.open("f_s298f_2.txt");
-        break;
-
-    case 2:
-        filename = "s344f_2.txt";
-        fin.open("s344f_2.txt");
-        finput.open("i_s344f_2.txt");
-        foutput.open("o_s344f_2.txt");
-        ffault.open("f_s344f_2.txt");
-        break;
-
-    case 3:
-        filename = "s349f_2.txt";
-        fin.open("s349f_2.txt");
-        finput.open("i_s349f_2.txt");
-        foutput.open("o_s349f_2.txt");
-        ffault.open("f_s349f_2.txt");
-        break;
-
-    case 4:
-        filename = "s344ff_2.txt";
-        fin.open("s344ff_2.txt");
-        finput.open("i_s344ff_2.txt");
-        foutput.open("o_s344ff_2.txt");
-        ffault.open("f_s344ff_2.txt");
-        break;
-
-    default:
-        filename = "test.txt";
-        fin.open("test.txt");
-        finput.open("i_test.txt");
-        foutput.open("o_test.txt");
-        ffault.open("f_test.txt");
-        break;
-    }
-
-    // Parsing the Netlist
-
-    // Strings to store the input characters
-    std::string line;
-    std::string str1, str2, str3, str4;
+// Fault simulation engines
+enum FaultEngine
+{
+    // Propagate the full fault list of every net through the circuit
+    ENGINE_DEDUCTIVE,
 
-    // Variables to store the net IDs
-    int net_val1, net_val2, out_val;
+    // Trace the critical lines back from the primary outputs
+    ENGINE_CPT,
 
-    // Variable to store the count of the gates (and to give an id)
-    int id = 0;
+    // Keep the diverging faulty machines at every gate and update them event driven
+    ENGINE_CONCURRENT,
 
-    // Till the end of file
-    while (getline(fin, line))
-    {
-        std::stringstream ss(line);
-        ss >> str1;
+    // Simulate 63 faulty machines next to the good machine in every word
+    ENGINE_PARALLEL
+};
 
-        // If GATE
-        if (str1 == "INV" || str1 == "BUF")
-        {
-            // Get the rest of the parameters as input
-            ss >> str2 >> str3;
+// Critical path tracing over the fault free values of one pattern
+// A line is critical if flipping its value changes a primary output, so the line stuck at the
+// opposite of its value is detected. Inside a fanout free region criticality is traced back
+// through the sensitive gate inputs, the stems are checked by simulating the flipped value
+// until it reaches an output, dies out or funnels into a single net whose criticality is known
+class CriticalPathTracer
+{
 
-            net_val1 = std::stoi(str2);
-            out_val = std::stoi(str3);
+public:
+    // Criticality of every net and of every gate input pin, indexed 2 * gate + pin
+    std::vector<char> critical_net;
+    std::vector<char> critical_pin;
 
-            // Flag to mark if the net already exists
-            bool exists = false;
+    // Class constructor, the gates have to be in topological order
+    CriticalPathTracer(const std::vector<Gate> &gate_list, const std::vector<Net> &net_list, const std::vector<int> &output_list)
+    {
+        is_output.assign(net_list.size(), 0);
+        for (int i = 0; i < output_list.size(); ++i)
+        {
+            is_output[output_list[i] - 1] = 1;
+        }
 
-            // Net object to pass to the gate constructor
-            Net in1;
+        critical_net.assign(net_list.size(), 0);
+        critical_pin.assign(2 * gate_list.size(), 0);
 
-            // Check if the net already exists
-            for (int i = 0; i < net_list.size(); ++i)
-            {
-                if (net_list[i].id == net_val1)
-                {
-                    // Update the gates_into list
-                    net_list[i].gates_into.push_back(id);
+        flipped.assign(net_list.size(), -1);
+        unprocessed.assign(net_list.size(), 0);
+        scheduled.assign(gate_list.size(), 0);
+    }
 
-                    // Make a copy of the existing net to pass to the gate constructor
-                    in1 = net_list[i];
+    // Mark the critical lines of the pattern held in the values of the nets
+    void trace(const std::vector<Gate> &gate_list, const std::vector<Net> &net_list)
+    {
+        std::fill(critical_net.begin(), critical_net.end(), 0);
+        std::fill(critical_pin.begin(), critical_pin.end(), 0);
 
-                    exists = true;
-                    break; // Found a Net with the target id, no need to continue searching
-                }
-            }
+        // Walk the gates backwards, the output of a gate is resolved before its inputs
+        for (int j = gate_list.size() - 1; j >= 0; --j)
+        {
+            resolveNet(gate_list[j].output_net.id, gate_list, net_list);
+            markPins(gate_list[j], net_list);
+        }
 
-            // If the net does not exist
-            if (exists == false)
+        // Nets without a driver, the primary inputs
+        for (int i = 0; i < net_list.size(); ++i)
+        {
+            if (net_list[i].input == -1)
             {
-                // If net doesn't exist, create a new object and insert into the array in a sorted format
-                in1.gates_into.push_back(id);
-                in1.id = net_val1;
-                in1.input = -1;
-                in1.value = -1;
-
-                // If the vector is empty
-                if (net_list.empty())
-                {
-                    net_list.push_back(in1);
-                }
-                // Else
-                else
-                {
-                    auto it = std::lower_bound(net_list.begin(), net_list.end(), in1, compareById);
-                    net_list.insert(it, in1);
-                }
+                resolveNet(i + 1, gate_list, net_list);
             }
+        }
+    }
 
-            exists = false;
-
-            // Net object to pass to the gate constructor
-            Net out;
+    // Check if the current pattern detects a fault
+    bool detects(const Fault &fault, const FaultSites &sites, const std::vector<Net> &net_list) const
+    {
+        int site = sites.siteOf(fault);
 
-            // Check if the net already exists
-            for (int i = 0; i < net_list.size(); ++i)
-            {
-                if (net_list[i].id == out_val)
-                {
-                    // Update the input variable of the gate
-                    net_list[i].input = id;
+        if (site == -1 || net_list[fault.net_id - 1].value == fault.value)
+        {
+            return false;
+        }
 
-                    // Make a copy of the existing net to pass to the gate constructor
-                    out = net_list[i];
+        if (site < sites.num_nets)
+        {
+            return critical_net[site];
+        }
 
-                    exists = true;
-                    break; // Found a Net with the target id, no need to continue searching
-                }
-            }
+        // Fanout branch, find the pin of the gate
+        int g = sites.branch_gate[site - sites.num_nets];
+        return critical_pin[2 * g + (sites.branch_site[2 * g] == site ? 0 : 1)];
+    }
 
-            // If the net does not exist
-            if (exists == false)
-            {
-                // If net doesn't exist, create a new object and insert into the array in a sorted format
-                out.id = out_val;
-                out.input = id;
-                out.value = -1;
+private:
+    std::vector<char> is_output;
 
-                // If the vector is empty
-                if (net_list.empty())
-                {
-                    net_list.push_back(out);
-                }
-                // Else
-                else
-                {
-                    auto it = std::lower_bound(net_list.begin(), net_list.end(), out, compareById);
-                    net_list.insert(it, out);
-                }
-            }
+    // Scratch state of the stem check, the flipped value of every net or -1 if unchanged,
+    // the number of fanout gates of a changed net not evaluated yet and the gates in the queue
+    std::vector<int> flipped;
+    std::vector<int> unprocessed;
+    std::vector<char> scheduled;
 
-            // Create a gate object and instantiate with the above values
-            Gate g(str1, id, in1, out);
-            gate_list.push_back(g);
+    // Decide the criticality of a net, every gate it feeds has already been traced
+    void resolveNet(int id, const std::vector<Gate> &gate_list, const std::vector<Net> &net_list)
+    {
+        const Net &net = net_list[id - 1];
 
-            id++;
+        if (is_output[id - 1])
+        {
+            critical_net[id - 1] = 1;
         }
-        else if (str1 == "AND" || str1 == "OR" || str1 == "NOR" || str1 == "NAND")
+        else if (net.gates_into.size() == 1)
         {
-            // Get the rest of the parameters as input
-            ss >> str2 >> str3 >> str4;
-
-            net_val1 = std::stoi(str2);
-            net_val2 = std::stoi(str3);
-            out_val = std::stoi(str4);
-
-            // Flag to mark if the net already exists
-            bool exists = false;
+            // A fanout free net is critical if its only pin is
+            const Gate &g = gate_list[net.gates_into[0]];
+            int k = g.input_nets[0].id == id ? 0 : 1;
+            critical_net[id - 1] = critical_pin[2 * g.id + k];
+        }
+        else if (net.gates_into.size() > 1)
+        {
+            // A stem can be critical even if none of its branches is, when the change propagates along several paths
+            critical_net[id - 1] = checkStem(id, gate_list, net_list);
+        }
+    }
 
-            // Net object to pass to the gate constructor
-            Net in1;
+    // Mark the inputs of a gate to which its output is sensitive
+    void markPins(const Gate &g, const std::vector<Net> &net_list)
+    {
+        if (!critical_net[g.output_net.id - 1])
+        {
+            return;
+        }
 
-            // Check if the net already exists
-            for (int i = 0; i < net_list.size(); ++i)
-            {
-                if (net_list[i].id == net_val1)
-                {
-                    // Update the gates_into list
-                    net_list[i].gates_into.push_back(id);
+        if (g.input_nets.size() == 1)
+        {
+            critical_pin[2 * g.id] = 1;
+            return;
+        }
 
-                    // Make a copy of the existing net to pass to the gate constructor
-                    in1 = net_list[i];
+        // A gate reading one net on both pins follows it, the pins are flipped together
+        if (g.input_nets[0].id == g.input_nets[1].id)
+        {
+            critical_pin[2 * g.id] = 1;
+            critical_pin[2 * g.id + 1] = 1;
+            return;
+        }
 
-                    exists = true;
-                    break; // Found a Net with the target id, no need to continue searching
-                }
-            }
+        int c = (g.type == "AND" || g.type == "NAND") ? 0 : 1;
 
-            // If the net does not exist
-            if (exists == false)
+        // An input is sensitive when the other input is not at the controlling value
+        for (int k = 0; k < 2; ++k)
+        {
+            if (net_list[g.input_nets[1 - k].id - 1].value != c)
             {
-                // If net doesn't exist, create a new object and insert into the array in a sorted format
-                in1.gates_into.push_back(id);
-                in1.id = net_val1;
-                in1.input = -1;
-                in1.value = -1;
-
-                // If the vector is empty
-                if (net_list.empty())
-                {
-                    net_list.push_back(in1);
-                }
-                // Else
-                else
-                {
-                    auto it = std::lower_bound(net_list.begin(), net_list.end(), in1, compareById);
-                    net_list.insert(it, in1);
-                }
+                critical_pin[2 * g.id + k] = 1;
             }
+        }
+    }
 
-            exists = false;
+    // Value of a net in the circuit with the stem flipped
+    int flippedValue(int id, const std::vector<Net> &net_list) const
+    {
+        return flipped[id - 1] != -1 ? flipped[id - 1] : net_list[id - 1].value;
+    }
 
-            // Net object to pass to the gate constructor
-            Net in2;
+    // Simulate the stem at the opposite value and check if the change is observed
+    bool checkStem(int id, const std::vector<Gate> &gate_list, const std::vector<Net> &net_list)
+    {
+        // Changed nets and scheduled gates, so that the scratch state can be cleared
+        std::vector<int> changed;
+        std::vector<int> touched;
+        std::priority_queue<int, std::vector<int>, std::greater<int>> queue;
+        int live = 0;
+        int result = -1;
+
+        auto change = [&](int net, int value)
+        {
+            flipped[net - 1] = value;
+            changed.push_back(net);
 
-            // Check if the net already exists
-            for (int i = 0; i < net_list.size(); ++i)
+            if (is_output[net - 1])
             {
-                if (net_list[i].id == net_val2)
-                {
-                    // Update the gates_into list
-                    net_list[i].gates_into.push_back(id);
-
-                    // Make a copy of the existing net to pass to the gate constructor
-                    in2 = net_list[i];
-
-                    exists = true;
-                    break; // Found a Net with the target id, no need to continue searching
-                }
+                result = 1;
+                return;
             }
 
-            // If the net does not exist
-            if (exists == false)
+            unprocessed[net - 1] = net_list[net - 1].gates_into.size();
+            if (unprocessed[net - 1] > 0)
             {
-                // If net doesn't exist, create a new object and insert into the array in a sorted format
-                in2.gates_into.push_back(id);
-                in2.id = net_val2;
-                in2.input = -1;
-                in2.value = -1;
+                live++;
+            }
 
-                // If the vector is empty
-                if (net_list.empty())
-                {
-                    net_list.push_back(in2);
-                }
-                // Else
-                else
+            for (int k = 0; k < net_list[net - 1].gates_into.size(); ++k)
+            {
+                int g = net_list[net - 1].gates_into[k];
+                if (!scheduled[g])
                 {
-                    auto it = std::lower_bound(net_list.begin(), net_list.end(), in2, compareById);
-                    net_list.insert(it, in2);
+                    scheduled[g] = 1;
+                    touched.push_back(g);
+                    queue.push(g);
                 }
             }
+        };
 
-            exists = false;
+        change(id, !net_list[id - 1].value);
 
-            // Net object to pass to the gate constructor
-            Net out;
+        while (result == -1 && !queue.empty())
+        {
+            const Gate &g = gate_list[queue.top()];
+            queue.pop();
 
-            // Check if the net already exists
-            for (int i = 0; i < net_list.size(); ++i)
+            // The gate consumes the changes on its inputs
+            for (int k = 0; k < g.input_nets.size(); ++k)
             {
-                if (net_list[i].id == out_val)
+                int in = g.input_nets[k].id;
+                if (flipped[in - 1] != -1 && --unprocessed[in - 1] == 0)
                 {
-                    // Update the input variable of the net
-                    net_list[i].input = id;
-
-                    // Make a copy of the existing net to pass to the gate constructor
-                    out = net_list[i];
-
-                    exists = true;
-                    break; // Found a Net with the target id, no need to continue searching
+                    live--;
                 }
             }
 
-            // If the net does not exist
-            if (exists == false)
+            int in1 = flippedValue(g.input_nets[0].id, net_list);
+            int in2 = g.input_nets.size() > 1 ? flippedValue(g.input_nets[1].id, net_list) : 0;
+            int out = g.output_net.id;
+            int value = gateOutput(g.type, in1, in2);
+
+            if (value != net_list[out - 1].value)
             {
-                // If net doesn't exist, create a new object and insert into the array in a sorted format
-                out.id = out_val;
-                out.input = id;
-                out.value = -1;
+                change(out, value);
+            }
 
-                // If the vector is empty
-                if (net_list.empty())
-                {
-                    net_list.push_back(out);
-                }
-                // Else
-                else
-                {
-                    auto it = std::lower_bound(net_list.begin(), net_list.end(), out, compareById);
-                    net_list.insert(it, out);
-                }
+            if (result != -1)
+            {
+                break;
             }
 
-            // Create a gate object and instantiate with the above values
-            Gate g(str1, id, in1, in2, out);
-            gate_list.push_back(g);
+            // The change died out
+            if (live == 0)
+            {
+                result = 0;
+            }
+            // All the changes funnel into the output of the gate, which was traced already
+            else if (live == 1 && value != net_list[out - 1].value && unprocessed[out - 1] > 0)
+            {
+                result = critical_net[out - 1];
+            }
+        }
 
-            id++;
+        if (result == -1)
+        {
+            result = 0;
         }
-        // If INPUT
-        else if (str1 == "INPUT")
+
+        // Clear the scratch state
+        for (int i = 0; i < changed.size(); ++i)
         {
-            int num;
-            while (ss >> num && num != -1)
-            {
-                input_list.push_back(num);
-            }
+            flipped[changed[i] - 1] = -1;
         }
-        // If OUTPUT
-        else if (str1 == "OUTPUT")
+        while (!queue.empty())
         {
-            int num;
-            while (ss >> num && num != -1)
-            {
-                output_list.push_back(num);
-            }
+            queue.pop();
         }
-        // If Invalid character in netlist, do nothing
-        else
+        for (int i = 0; i < touched.size(); ++i)
         {
-            std ::cout << "Invalid Input, will be ignored" << std::endl;
+            scheduled[touched[i]] = 0;
         }
-    }
 
-    // Print some basic information about the circuit
-    std::cout << "Circuit Number " << file_set + 1 << ": " << std::endl;
-    std::cout << "The circuit has " << gate_list.size() << " gates." << std::endl;
-    std::cout << "The circuit has " << net_list.size() << " nets." << std::endl;
-    std::cout << "The circuit has " << input_list.size() << " inputs." << std::endl;
-    std::cout << "The circuit has " << output_list.size() << " outputs." << std::endl;
+        return result;
+    }
+};
 
-    // Start main logic loop
+// State of one faulty machine at a gate where it diverges from the good machine
+class BadGate
+{
 
-    // Create the vector to store the inputs
-    std::vector<int> inputs;
+public:
+    // Index of the fault in the simulated fault list
+    int fault;
 
-    // Create a global fault list
-    std::vector<Fault> fault_list;
+    // Input and output values of the gate in the faulty machine
+    char in[2];
+    char out;
+};
 
-    // Variable to decide the operating mode of the program
-    int mode = 1;
+// Concurrent fault simulation
+// Every gate keeps the list of faulty machines whose values at the gate differ from the good machine,
+// plus the machines of the faults located on the gate. The lists persist from one pattern to the next
+// and a gate is only evaluated again when the good value or a faulty value of one of its inputs changed
+class ConcurrentFaultSimulator
+{
 
-    if (mode == 0)
+public:
+    // Class constructor, the gates have to be in topological order
+    ConcurrentFaultSimulator(const std::vector<Gate> &gate_list, const std::vector<Net> &net_list, const std::vector<int> &output_list, const std::vector<Fault> &sim_fault_list, const FaultSites &sites)
     {
-        std::string fnet, fval;
-
-        // Parse the file containing the fault list
-        while (getline(ffault, line))
+        outputs = output_list;
+        bad_gates.resize(gate_list.size());
+        good.assign(net_list.size(), -1);
+        scheduled.assign(gate_list.size(), 0);
+        net_faults.resize(net_list.size());
+        pin_faults.resize(2 * gate_list.size());
+
+        // Attach every fault to its net or gate input pin
+        for (int f = 0; f < sim_fault_list.size(); ++f)
         {
-            std::stringstream ss(line);
-            ss >> fnet >> fval;
-
-            int _net_id = std::stoi(fnet);
-            int _value = std::stoi(fval);
+            int site = sites.siteOf(sim_fault_list[f]);
 
-            Fault temp(_net_id, _value);
-            fault_list.push_back(temp);
-        }
-    }
-    else
-    {
-        // Populate the fault list with all possible faults in the circuit
-        for (int i = 0; i < net_list.size(); i++)
-        {
-            for (int j = 0; j < 2; j++)
+            if (site == -1)
             {
-                int _net_id = net_list[i].id;
-                int _value = j;
+                continue;
+            }
 
-                Fault temp(_net_id, _value);
-                fault_list.push_back(temp);
+            if (site < sites.num_nets)
+            {
+                net_faults[site].push_back(std::make_pair(f, sim_fault_list[f].value));
+            }
+            else
+            {
+                // A branch fault is attached to every pin of the gate reading the net
+                int g = sites.branch_gate[site - sites.num_nets];
+                for (int k = 0; k < 2; ++k)
+                {
+                    if (sites.branch_site[2 * g + k] == site)
+                    {
+                        pin_faults[2 * g + k].push_back(std::make_pair(f, sim_fault_list[f].value));
+                    }
+                }
             }
         }
     }
 
-    // Variable to store the total number of faults
-    int total_faults = fault_list.size();
-
-    // Read input from the file
-    std::string in_line;
-    while (std::getline(finput, in_line))
+    // Simulate the pattern held in the values of the nets
+    // Returns the indices of the simulated faults observed at the primary outputs
+    std::vector<int> simulate(const std::vector<Gate> &gate_list, const std::vector<Net> &net_list)
     {
-        // For each character in the line
-        for (char c : in_line)
+        std::priority_queue<int, std::vector<int>, std::greater<int>> queue;
+
+        // Schedule the gates fed by the nets whose good value changed since the last pattern
+        for (int i = 0; i < net_list.size(); ++i)
         {
-            if (c == '0' || c == '1')
+            if (net_list[i].value != good[i])
             {
-                inputs.push_back(c - '0'); // Convert char '0' or '1' to int 0 or 1
+                good[i] = net_list[i].value;
+                schedule(net_list[i], queue);
             }
         }
 
-        // For every input in the file
-
-        // Assign logic to input nets
-        for (int i = 0; i < input_list.size(); ++i)
+        // Evaluate the gates in order, a gate whose output list changed schedules its fanout
+        while (!queue.empty())
         {
-            // Update the value of the net in the net list
-            net_list[input_list[i] - 1].value = inputs[i];
+            int g = queue.top();
+            queue.pop();
+            scheduled[g] = 0;
 
-            // Find all gates which have the net as an input
-            for (int j = 0; j < gate_list.size(); ++j)
+            if (evaluate(gate_list[g], net_list))
             {
-                // For all the inputs of a given gate
-                for (int k = 0; k < gate_list[j].input_nets.size(); ++k)
-                {
-                    // For all the input which is the current net
-                    if (gate_list[j].input_nets[k].id == net_list[input_list[i] - 1].id)
-                    {
-                        // Update the value of the net in the gate object list
-                        gate_list[j].input_nets[k].value = net_list[input_list[i] - 1].value;
-                    }
-                }
+                schedule(net_list[gate_list[g].output_net.id - 1], queue);
             }
         }
 
-        // Create a stack for logic simulation
-        std::stack<Gate> logic_stack;
-
-        // Create a list which stores the ids of gates already added to the stack
-        std::vector<int> added_to_stack;
+        // The faults whose machines differ at a primary output are detected
+        std::vector<int> detected;
+        std::vector<std::pair<int, int>> list;
 
-        // Push all the initial gates onto the stack
-        for (int i = 0; i < input_list.size(); ++i)
+        for (int i = 0; i < outputs.size(); ++i)
         {
-            int connected_gates = net_list[input_list[i] - 1].gates_into.size();
-            for (int j = 0; j < connected_gates; ++j)
+            divergence(outputs[i], net_list, list);
+            for (int k = 0; k < list.size(); ++k)
             {
-                // Temporary gate variable
-                int index = net_list[input_list[i] - 1].gates_into[j];
+                detected.push_back(list[k].first);
+            }
+        }
 
-                // Fetch the corresponding gate
-                Gate g = gate_list[index];
+        std::sort(detected.begin(), detected.end());
+        detected.erase(std::unique(detected.begin(), detected.end()), detected.end());
 
-                // Flag to mark if the gate has already been added to the stack
-                bool isAdded = false;
+        return detected;
+    }
 
-                // Flag to set if the gate is assigned
-                bool isAssigned = true;
+private:
+    std::vector<int> outputs;
 
-                // Fetch the number of inputs for the current gate
-                int ins = g.input_nets.size();
+    // Faulty machines of every gate, sorted by fault index
+    std::vector<std::vector<BadGate>> bad_gates;
 
-                // Check if the gate has both inputs assigned
-                for (int k = 0; k < ins; ++k)
-                {
-                    if (g.input_nets[k].value == -1)
-                    {
-                        isAssigned = false;
-                        break;
-                    }
-                }
+    // Good values of the nets for the last simulated pattern
+    std::vector<int> good;
+    std::vector<char> scheduled;
 
-                if (isAssigned == true)
-                {
-                    // Flag to mark if the gate has already been added to the stack
-                    bool isAdded = false;
+    // Faults on every net and on every gate input pin, as (fault index, stuck at value)
+    std::vector<std::vector<std::pair<int, int>>> net_faults;
+    std::vector<std::vector<std::pair<int, int>>> pin_faults;
 
-                    // Check if the gate is not already in the stack
-                    for (int k = 0; k < added_to_stack.size(); ++k)
-                    {
-                        if (added_to_stack[k] == g.id)
-                        {
-                            isAdded = true;
-                            break;
-                        }
-                    }
+    // Scratch lists reused by evaluate
+    std::vector<std::pair<int, int>> inputs[2];
+    std::vector<int> machines;
+    std::vector<BadGate> updated;
 
-                    // If the gate was not added previously
-                    if (isAdded == false)
-                    {
-                        // Push the gate onto the stack
-                        logic_stack.push(g);
-                        added_to_stack.push_back(g.id);
-                    }
+    void schedule(const Net &net, std::priority_queue<int, std::vector<int>, std::greater<int>> &queue)
+    {
+        for (int k = 0; k < net.gates_into.size(); ++k)
+        {
+            int g = net.gates_into[k];
+            if (!scheduled[g])
+            {
+                scheduled[g] = 1;
+                queue.push(g);
+            }
+        }
+    }
+
+    // Faulty machines in which a net differs from the good machine, as (fault index, value)
+    void divergence(int id, const std::vector<Net> &net_list, std::vector<std::pair<int, int>> &list) const
+    {
+        list.clear();
+        int driver = net_list[id - 1].input;
+
+        if (driver == -1)
+        {
+            // A primary input only differs in the machines of its own faults
+            for (int k = 0; k < net_faults[id - 1].size(); ++k)
+            {
+                if (net_faults[id - 1][k].second != good[id - 1])
+                {
+                    list.push_back(net_faults[id - 1][k]);
                 }
             }
+            return;
         }
 
-        // While the stack is not empty
-        while (!logic_stack.empty())
+        const std::vector<BadGate> &bad = bad_gates[driver];
+        for (int k = 0; k < bad.size(); ++k)
         {
-            // Fetch the top value from the stack
-            Gate g = logic_stack.top();
+            if (bad[k].out != good[id - 1])
+            {
+                list.push_back(std::make_pair(bad[k].fault, (int)bad[k].out));
+            }
+        }
+    }
 
-            // Pop the stack
-            logic_stack.pop();
+    // Value of a stuck at fault of the given machine in a list of local faults, -1 if there is none
+    static int localFault(const std::vector<std::pair<int, int>> &faults, int fault)
+    {
+        for (int k = 0; k < faults.size(); ++k)
+        {
+            if (faults[k].first == fault)
+            {
+                return faults[k].second;
+            }
+        }
+        return -1;
+    }
 
-            // Evaluate the output of the gate
-            evaluateGate(g, net_list, gate_list);
+    // Rebuild the faulty machines of a gate, returns true if its output changed in any machine
+    bool evaluate(const Gate &g, const std::vector<Net> &net_list)
+    {
+        int ins = g.input_nets.size();
+        int out_id = g.output_net.id;
+        int good_out = good[out_id - 1];
 
-            // Find gates with all assigned inputs not already in the stack
-            for (int i = 0; i < gate_list.size(); ++i)
+        // Machines which reach the gate through its inputs or are located on it
+        machines.clear();
+        for (int k = 0; k < ins; ++k)
+        {
+            divergence(g.input_nets[k].id, net_list, inputs[k]);
+            for (int m = 0; m < inputs[k].size(); ++m)
+            {
+                machines.push_back(inputs[k][m].first);
+            }
+            for (int m = 0; m < pin_faults[2 * g.id + k].size(); ++m)
             {
-                // Fetch the number of inputs for the current gate
-                int ins = gate_list[i].input_nets.size();
+                machines.push_back(pin_faults[2 * g.id + k][m].first);
+            }
+        }
+        for (int m = 0; m < net_faults[out_id - 1].size(); ++m)
+        {
+            machines.push_back(net_faults[out_id - 1][m].first);
+        }
+
+        std::sort(machines.begin(), machines.end());
+        machines.erase(std::unique(machines.begin(), machines.end()), machines.end());
 
-                // Flag to set if the gate is assigned
-                bool isAssigned = true;
+        // Evaluate every machine, walking the sorted input lists alongside
+        updated.clear();
+        int pos[2] = {0, 0};
 
-                // Check if the gate has both inputs assigned
-                for (int j = 0; j < ins; ++j)
+        for (int m = 0; m < machines.size(); ++m)
+        {
+            int fault = machines[m];
+            BadGate bad;
+            bad.fault = fault;
+            bool local = false;
+
+            for (int k = 0; k < 2; ++k)
+            {
+                bad.in[k] = 0;
+                if (k >= ins)
                 {
-                    if (gate_list[i].input_nets[j].value == -1)
-                    {
-                        isAssigned = false;
-                        break;
-                    }
+                    continue;
                 }
 
-                // Flag to mark if the gate has already been added to the stack
-                bool isAdded = false;
-
-                if (isAssigned == true)
+                bad.in[k] = good[g.input_nets[k].id - 1];
+                if (pos[k] < inputs[k].size() && inputs[k][pos[k]].first == fault)
                 {
-                    // Check if the gate is not already in the stack
-                    for (int k = 0; k < added_to_stack.size(); ++k)
-                    {
-                        if (added_to_stack[k] == gate_list[i].id)
-                        {
-                            isAdded = true;
-                            break;
-                        }
-                    }
+                    bad.in[k] = inputs[k][pos[k]++].second;
+                }
 
-                    // If the gate was not added previously
-                    if (isAdded == false)
-                    {
-                        // Push the gate onto the stack
-                        logic_stack.push(gate_list[i]);
-                        added_to_stack.push_back(gate_list[i].id);
-                    }
+                int stuck = localFault(pin_faults[2 * g.id + k], fault);
+                if (stuck != -1)
+                {
+                    bad.in[k] = stuck;
+                    local = true;
                 }
             }
-        }
 
-        // Create a vector to store the outputs of the circuit
-        std::vector<int> outputs;
+            bad.out = gateOutput(g.type, bad.in[0], bad.in[1]);
 
-        // Create a string to store the value to be printed
-        std::string output_string = "";
+            int stuck = localFault(net_faults[out_id - 1], fault);
+            if (stuck != -1)
+            {
+                bad.out = stuck;
+                local = true;
+            }
 
-        // Find the outputs of the circuit
-        for (int i = 0; i < output_list.size(); ++i)
+            // Keep the machine while it differs from the good gate or its fault is on the gate
+            bool differs = bad.out != good_out;
+            for (int k = 0; k < ins; ++k)
+            {
+                differs = differs || bad.in[k] != good[g.input_nets[k].id - 1];
+            }
+
+            if (differs || local)
+            {
+                updated.push_back(bad);
+            }
+        }
+
+        // Compare the output divergence before and after, the good value is compared by the caller
+        std::vector<BadGate> &bad = bad_gates[g.id];
+        bool changed = false;
+        int i = 0, j = 0;
+
+        while (!changed)
         {
-            outputs.push_back(net_list[output_list[i] - 1].value);
-            output_string += std::to_string(net_list[output_list[i] - 1].value);
+            // Skip the machines whose output agrees with the good machine
+            while (i < bad.size() && bad[i].out == good_out)
+            {
+                i++;
+            }
+            while (j < updated.size() && updated[j].out == good_out)
+            {
+                j++;
+            }
+
+            if (i == bad.size() || j == updated.size())
+            {
+                changed = i != bad.size() || j != updated.size();
+                break;
+            }
+
+            changed = bad[i].fault != updated[j].fault;
+            i++;
+            j++;
         }
 
-        // Write the binary string to the output file
-        foutput << output_string << std::endl;
+        bad.swap(updated);
+
+        return changed;
+    }
+};
 
-        // Clear the checklist for the gates added to the stack
-        added_to_stack.clear();
+// Formats of the detected fault report
+enum ReportFormat
+{
+    // Count of the detected faults followed by one "net value" line per fault, the value of a transition fault is R or F
+    REPORT_TEXT,
 
-        // Create a variable to store the fault lists
-        std::vector<Fault> fault_lists[net_list.size()];
+    // Fault table followed by the indices of the faults detected by every pattern
+    REPORT_BINARY,
 
-        // Create a stack for deductive fault simulation
-        std::stack<Gate> fault_stack;
+    // Fault table followed by one bit per fault for every pattern
+    REPORT_BITMAP
+};
 
-        // Create a list which stores the ids of gates already added to the stack
-        int added_to_fault_stack[gate_list.size()];
+// Writer for the faults detected by each pattern
+// The binary and bitmap formats start with the magic "DFR1" or "DFB1", the number of faults
+// and a table of (net, value, branch) triples, all stored as little endian 32 bit words
+// The value of a transition fault is stored as 2 (slow to rise) or 3 (slow to fall)
+// The branch is the output net of the gate for a fault on a fanout branch and 0 for a net fault
+class DetectionReport
+{
 
-        // Create a list which stores the ids of nets with fault lists
-        int added_to_fault[net_list.size()];
+public:
+    // Class constructor, the fault list defines the fault indices of the compact formats
+    DetectionReport(const std::string &filename, ReportFormat _format, const std::vector<Fault> &faults, const std::vector<Gate> &gate_list) : writer(filename)
+    {
+        format = _format;
+        num_faults = faults.size();
 
-        // Initially set all faults as unassigned
-        for (int i = 0; i < net_list.size(); ++i)
+        for (int i = 0; i < faults.size(); ++i)
         {
-            added_to_fault[i] = 0;
+            fault_index.insert(std::make_pair(faults[i], i));
+            sites.push_back(faultSite(faults[i], gate_list));
         }
 
-        // Initially set all gates as unpushed to the stack
-        for (int i = 0; i < gate_list.size(); ++i)
+        if (format != REPORT_TEXT)
         {
-            added_to_fault_stack[i] = 0;
+            // Write the header with the fault table
+            writer.write(format == REPORT_BINARY ? "DFR1" : "DFB1", 4);
+            writer.writeU32(num_faults);
+
+            for (int i = 0; i < faults.size(); ++i)
+            {
+                writer.writeU32(faults[i].net_id);
+                writer.writeU32(faults[i].value + (faults[i].model == FAULT_TRANSITION ? 2 : 0));
+                writer.writeU32(faults[i].gate == -1 ? 0 : gate_list[faults[i].gate].output_net.id);
+            }
         }
 
-        // For all primary inputs, initialise the fault lists to the singular values
-        for (int i = 0; i < input_list.size(); ++i)
-        {
-            // Fetch the current value of the net, the fault stuck at value will be the inverse
-            int fault_id = input_list[i];
-            int fault_val = !net_list[fault_id - 1].value;
+        bitmap.resize((num_faults + 7) / 8);
+    }
 
-            // Create a fault object
-            Fault f(fault_id, fault_val);
+    bool isOpen() const
+    {
+        return writer.isOpen();
+    }
 
-            // // Check for the fault net stuck at !correct_val in the global fault list
-            // auto it = std::find_if(fault_list.begin(), fault_list.end(),
-            //                        [fault_id, fault_val](const Fault &f)
-            //                        { return f.net_id == fault_id && f.value == fault_val; });
+    // Write the faults detected by one pattern
+    void writePattern(const std::vector<Fault> &detected)
+    {
+        if (format == REPORT_TEXT)
+        {
+            // Write the size of the vector on the first line
+            writer.writeInt(detected.size());
+            writer.writeChar('\n');
 
-            // // If the fault exists in the global fault list
-            // if (it != fault_list.end())
-            // {
-            // Add the fault to the appropriate fault list
-            fault_lists[fault_id - 1].push_back(f);
+            // Write the elements of the vector on separate lines
+            for (const Fault &fault : detected)
+            {
+                writer.write(sites[fault_index[fault]]);
+                writer.writeChar(' ');
+                writer.write(faultValue(fault));
+                writer.writeChar('\n');
+            }
 
-            // Mark the faults as added to the stack
-            added_to_fault[fault_id - 1] = 1;
-            // }
+            writer.write("\n\n", 2);
         }
+        else if (format == REPORT_BINARY)
+        {
+            writer.writeU32(detected.size());
 
-        // Push all the initial gates onto the stack
-        for (int i = 0; i < input_list.size(); ++i)
+            for (const Fault &fault : detected)
+            {
+                writer.writeU32(fault_index[fault]);
+            }
+        }
+        else
         {
-            int connected_gates = net_list[input_list[i] - 1].gates_into.size();
-            for (int j = 0; j < connected_gates; ++j)
+            std::fill(bitmap.begin(), bitmap.end(), 0);
+
+            for (const Fault &fault : detected)
             {
-                // Temporary gate variable
-                int index = net_list[input_list[i] - 1].gates_into[j];
+                int index = fault_index[fault];
+                bitmap[index / 8] |= 1 << (index % 8);
+            }
 
-                // Fetch the corresponding gate
-                Gate g = gate_list[index];
+            writer.write(bitmap.data(), bitmap.size());
+        }
+    }
 
-                // Flag to set if the gate is assigned
-                bool isAssigned = true;
+private:
+    BufferedWriter writer;
+    ReportFormat format;
+    int num_faults;
 
-                // Fetch the number of inputs for the current gate
-                int ins = g.input_nets.size();
+    // Position of every fault in the fault list and its site in text form
+    std::map<Fault, int> fault_index;
+    std::vector<std::string> sites;
 
-                // Check if the gate has both inputs nets assigned to the fault list
-                for (int k = 0; k < ins; ++k)
-                {
-                    // Check if the input has been added to the fault list
-                    if (added_to_fault[g.input_nets[k].id - 1] == 0)
-                    {
-                        isAssigned = false;
-                        break;
-                    }
-                }
+    // Bitmap of the current pattern
+    std::vector<char> bitmap;
+};
 
-                if (isAssigned == true)
-                {
-                    // Flag to mark if the gate has already been added to the stack
-                    bool isAdded = false;
+// Deductive fault simulation of the pattern held in the values of the nets
+// The simulated faults are also flagged by site, at 2 * site + value, for the lookup of the fanout branch faults
+// Returns the faults of the fault list observed at the primary outputs
+std::vector<Fault> deductiveFaultSimulation(std::vector<Gate> &gate_list, std::vector<Net> &net_list, const std::vector<int> &input_list, const std::vector<int> &output_list, std::vector<Fault> &sim_fault_list, const FaultSites &sites, const std::vector<char> &simulated)
+{
+    // Create a variable to store the fault lists
+    std::vector<Fault> fault_lists[net_list.size()];
 
-                    // Check if the gate is not already in the fault stack
-                    if (added_to_fault_stack[g.id])
-                    {
-                        isAdded = true;
-                    }
+    // Create a stack for deductive fault simulation
+    std::stack<Gate> fault_stack;
 
-                    // If the gate was not added previously
-                    if (isAdded == false)
-                    {
-                        // Push the gate onto the stack
-                        fault_stack.push(g);
-                        added_to_fault_stack[g.id] = 1;
-                    }
-                }
-            }
-        }
+    // Create a list which stores the ids of gates already added to the stack
+    int added_to_fault_stack[gate_list.size()];
 
-        // While the fault stack is not empty
-        while (!fault_stack.empty())
-        {
-            // Fetch the top value from the stack
-            Gate g = fault_stack.top();
+    // Create a list which stores the ids of nets with fault lists
+    int added_to_fault[net_list.size()];
 
-            // Pop the stack
-            fault_stack.pop();
+    // Initially set all faults as unassigned
+    for (int i = 0; i < net_list.size(); ++i)
+    {
+        added_to_fault[i] = 0;
+    }
 
-            // Deduce the fault list for the given gate output
-            evaluateFaultList(g, net_list, gate_list, fault_lists, fault_list, added_to_fault);
+    // Initially set all gates as unpushed to the stack
+    for (int i = 0; i < gate_list.size(); ++i)
+    {
+        added_to_fault_stack[i] = 0;
+    }
 
-            // Find gates with inputs whose faults lists have been calculated and not already pushed to the stack
-            for (int i = 0; i < gate_list.size(); ++i)
-            {
-                // Fetch the number of inputs for the current gate
-                int ins = gate_list[i].input_nets.size();
+    // For all primary inputs, initialise the fault lists to the singular values
+    for (int i = 0; i < input_list.size(); ++i)
+    {
+        // Fetch the current value of the net, the fault stuck at value will be the inverse
+        int fault_id = input_list[i];
+        int fault_val = !net_list[fault_id - 1].value;
+
+        // Create a fault object
+        Fault f(fault_id, fault_val);
+
+        // // Check for the fault net stuck at !correct_val in the global fault list
+        // auto it = std::find_if(fault_list.begin(), fault_list.end(),
+        //                        [fault_id, fault_val](const Fault &f)
+        //                        { return f.net_id == fault_id && f.value == fault_val; });
+
+        // // If the fault exists in the global fault list
+        // if (it != fault_list.end())
+        // {
+        // Add the fault to the appropriate fault list
+        fault_lists[fault_id - 1].push_back(f);
+
+        // Mark the faults as added to the stack
+        added_to_fault[fault_id - 1] = 1;
+        // }
+    }
+
+    // Push all the initial gates onto the stack
+    for (int i = 0; i < input_list.size(); ++i)
+    {
+        int connected_gates = net_list[input_list[i] - 1].gates_into.size();
+        for (int j = 0; j < connected_gates; ++j)
+        {
+            // Temporary gate variable
+            int index = net_list[input_list[i] - 1].gates_into[j];
+
+            // Fetch the corresponding gate
+            Gate g = gate_list[index];
 
-                // Flag to set if the gate is assigned
-                bool isAssigned = true;
+            // Flag to set if the gate is assigned
+            bool isAssigned = true;
 
-                // Check if the gate has inputs which have fault lists
-                for (int j = 0; j < ins; ++j)
+            // Fetch the number of inputs for the current gate
+            int ins = g.input_nets.size();
+
+            // Check if the gate has both inputs nets assigned to the fault list
+            for (int k = 0; k < ins; ++k)
+            {
+                // Check if the input has been added to the fault list
+                if (added_to_fault[g.input_nets[k].id - 1] == 0)
                 {
-                    // Check if the input has been added to the fault list
-                    if (added_to_fault[gate_list[i].input_nets[j].id - 1] == 0)
-                    {
-                        isAssigned = false;
-                        break;
-                    }
+                    isAssigned = false;
+                    break;
                 }
+            }
 
+            if (isAssigned == true)
+            {
                 // Flag to mark if the gate has already been added to the stack
                 bool isAdded = false;
 
-                if (isAssigned == true)
+                // Check if the gate is not already in the fault stack
+                if (added_to_fault_stack[g.id])
                 {
-                    // Check if the gate is not already in the stack
-                    if (added_to_fault_stack[gate_list[i].id] == 1)
-                    {
-                        isAdded = true;
-                    }
+                    isAdded = true;
+                }
 
-                    // If the gate was not added previously
-                    if (isAdded == false)
-                    {
-                        // Push the gate onto the stack
-                        fault_stack.push(gate_list[i]);
-                        added_to_fault_stack[gate_list[i].id] = 1;
-                    }
+                // If the gate was not added previously
+                if (isAdded == false)
+                {
+                    // Push the gate onto the stack
+                    fault_stack.push(g);
+                    added_to_fault_stack[g.id] = 1;
                 }
             }
         }
+    }
 
-        // Create a list to store the faults detected at the output
-        std::vector<Fault> detected_faults;
+    // While the fault stack is not empty
+    while (!fault_stack.empty())
+    {
+        // Fetch the top value from the stack
+        Gate g = fault_stack.top();
 
-        // For all the nets in the output lists, create a union of all the faults
-        for (int i = 0; i < output_list.size(); ++i)
+        // Pop the stack
+        fault_stack.pop();
+
+        // Deduce the fault list for the given gate output
+        evaluateFaultList(g, net_list, gate_list, fault_lists, sim_fault_list, added_to_fault, sites, simulated);
+
+        // Find the gates fed by the output whose inputs all have fault lists and which are not already pushed to the stack
+        const std::vector<int> &fed = net_list[g.output_net.id - 1].gates_into;
+        for (int i = 0; i < fed.size(); ++i)
         {
-            // Make a copy of the net fault list
-            std::vector<Fault> list1 = fault_lists[output_list[i] - 1];
+            Gate &next = gate_list[fed[i]];
+
+            // Flag to set if the gate is assigned
+            bool isAssigned = true;
+
+            // Check if the gate has inputs which have fault lists
+            for (int j = 0; j < next.input_nets.size(); ++j)
+            {
+                // Check if the input has been added to the fault list
+                if (added_to_fault[next.input_nets[j].id - 1] == 0)
+                {
+                    isAssigned = false;
+                    break;
+                }
+            }
 
-            // Make a temporary result variable
-            std::vector<Fault> result;
+            // If the gate was not added previously, push it onto the stack
+            if (isAssigned == true && added_to_fault_stack[next.id] == 0)
+            {
+                fault_stack.push(next);
+                added_to_fault_stack[next.id] = 1;
+            }
+        }
+    }
+
+    // Create a list to store the faults detected at the output
+    std::vector<Fault> detected_faults;
+
+    // For all the nets in the output lists, create a union of all the faults
+    for (int i = 0; i < output_list.size(); ++i)
+    {
+        // Make a copy of the net fault list
+        std::vector<Fault> list1 = fault_lists[output_list[i] - 1];
+
+        // Make a temporary result variable
+        std::vector<Fault> result;
+
+        // Union the list with the fault list of the output line
+        std::set_union(list1.begin(), list1.end(), detected_faults.begin(), detected_faults.end(), std::back_inserter(result));
+
+        // Copy the temporary result back into the main detected fault list
+        detected_faults = result;
+    }
+
+    return detected_faults;
+}
+
+// Simulate one pattern with the interpreter, every net gets its value or stays unassigned
+void simulatePattern(const std::vector<int> &inputs, const std::vector<int> &input_list, std::vector<Net> &net_list, std::vector<Gate> &gate_list)
+{
+    // Clear the values left from the previous pattern
+    for (int i = 0; i < net_list.size(); ++i)
+    {
+        net_list[i].value = -1;
+    }
+    for (int j = 0; j < gate_list.size(); ++j)
+    {
+        for (int k = 0; k < gate_list[j].input_nets.size(); ++k)
+        {
+            gate_list[j].input_nets[k].value = -1;
+        }
+    }
 
-            // Union the list with the fault list of the output line
-            std::set_union(list1.begin(), list1.end(), detected_faults.begin(), detected_faults.end(), std::back_inserter(result));
+    // Assign logic to input nets
+    for (int i = 0; i < input_list.size(); ++i)
+    {
+        // Update the value of the net in the net list
+        Net &pi = net_list[input_list[i] - 1];
+        pi.value = inputs[i];
 
-            // Copy the temporary result back into the main detected fault list
-            detected_faults = result;
+        // Update the value of the net in the gates which have it as an input
+        for (int j = 0; j < pi.gates_into.size(); ++j)
+        {
+            Gate &fed = gate_list[pi.gates_into[j]];
+            for (int k = 0; k < fed.input_nets.size(); ++k)
+            {
+                if (fed.input_nets[k].id == pi.id)
+                {
+                    fed.input_nets[k].value = pi.value;
+                }
+            }
         }
+    }
 
-        // Sort the detected fault list
-        std::sort(detected_faults.begin(), detected_faults.end());
+    // The gates are levelized, so one pass in order evaluates every gate after the gates driving it
+    // A gate with an unassigned input, on a loop or fed by an undriven net, keeps its output unassigned
+    for (int j = 0; j < gate_list.size(); ++j)
+    {
+        Gate &g = gate_list[j];
 
-        std::cout << "Detected Faults Size: " << detected_faults.size() << std::endl;
+        bool assigned = true;
+        for (int k = 0; k < g.input_nets.size(); ++k)
+        {
+            if (g.input_nets[k].value == -1)
+            {
+                assigned = false;
+                break;
+            }
+        }
 
-        // Open a file for printing the faults detected in the simulation
-        std::ofstream outputFile("d_" + filename, std::ios::app);
+        if (assigned)
+        {
+            evaluateGate(g, net_list, gate_list);
+        }
+    }
+}
 
-        // Write the size of the vector on the first line
-        outputFile << detected_faults.size() << std::endl;
+// Assign the values of pattern p of words simulated by the compiled kernel, one word per net index
+void unpackPattern(const std::vector<uint64_t> &words, int p, std::vector<Net> &net_list, std::vector<Gate> &gate_list)
+{
+    for (int i = 0; i < net_list.size(); ++i)
+    {
+        net_list[i].value = (words[i] >> p) & 1;
+    }
 
-        // Write the elements of the vector on separate lines
-        for (const Fault &fault : detected_faults)
+    // The gates keep copies of their input nets
+    for (int j = 0; j < gate_list.size(); ++j)
+    {
+        for (int k = 0; k < gate_list[j].input_nets.size(); ++k)
         {
-            outputFile << fault.net_id << " " << fault.value << std::endl;
+            gate_list[j].input_nets[k].value = net_list[gate_list[j].input_nets[k].id - 1].value;
         }
+    }
+}
+
+class SimJob
+{
+
+public:
+    // Paths of the files used by the job
+    std::string netlist;
+    std::string patterns;
+    std::string faults;
+    std::string outputs;
+    std::string detected;
+
+    // Operating mode, 0 simulates the faults in the fault file and 1 simulates all faults in the circuit
+    int mode;
+
+    // Format of the detected fault report
+    ReportFormat report_format;
+
+    // Simulate only one fault of every equivalence class
+    CollapseMode collapse;
+
+    // Include the faults on the fanout branches in the fault universe of mode 1
+    bool pin_faults;
+
+    // Fault simulation engine
+    FaultEngine engine;
+
+    // Fault model, transition faults are simulated with pattern pairs
+    FaultModel model;
+
+    // Stop simulating a fault once it is detected, every fault is only reported for its first detecting pattern
+    bool drop;
+
+    // Directory caching the compiled simulation kernels, empty to simulate with the interpreter
+    std::string kernel_cache;
+
+    // Threads sharing the levels of the netlist in the parallel and transition engines, 1 to simulate sequentially
+    int level_threads;
+
+    // Connection the patterns are streamed from when the pattern file is -, set by the server, -1 to read the file
+    int pattern_fd;
 
-        outputFile << "\n"
-                   << std::endl;
+    // Fault dictionary built from the stuck at patterns for diagnosis, empty for none
+    std::string dictionary;
 
-        // Close the file
-        outputFile.close();
+    // Default constructor
+    SimJob()
+    {
+        mode = 1;
+        report_format = REPORT_TEXT;
+        collapse = COLLAPSE_EQUIVALENCE;
+        pin_faults = false;
+        engine = ENGINE_DEDUCTIVE;
+        drop = false;
+        model = FAULT_STUCK_AT;
+        level_threads = 1;
+        pattern_fd = -1;
     }
+};
 
-    // Clear the gate and net lists
-    gate_list.clear();
-    net_list.clear();
+// Open the pattern stream of a job, a served job reads a copy of the connection descriptor so closing the stream keeps
+// the connection open, returns nullptr on failure
+FILE *openPatterns(const SimJob &job)
+{
+    if (job.pattern_fd < 0)
+    {
+        return std::fopen(job.patterns.c_str(), "rb");
+    }
 
-    // Clear the input and output lists
-    input_list.clear();
-    output_list.clear();
+    int fd = dup(job.pattern_fd);
+    if (fd == -1)
+    {
+        return nullptr;
+    }
 
-    // Clear the variables related to deductive simulation
+    FILE *file = fdopen(fd, "rb");
+    if (file == nullptr)
+    {
+        close(fd);
+    }
 
-    // Close the files
-    fin.close();
-    finput.close();
-    foutput.close();
+    return file;
+}
 
-    return 0;
+// Run the logic and deductive fault simulation for one job on a private copy of the circuit
+// The console report is written to log so that concurrent jobs do not interleave
+int runSimulation(const SimJob &job, Circuit circuit, std::ostream &log)
+{
+    // References to the lists of the circuit
+    std::vector<Gate> &gate_list = circuit.gate_list;
+    std::vector<Net> &net_list = circuit.net_list;
+    std::vector<int> &input_list = circuit.input_list;
+    std::vector<int> &output_list = circuit.output_list;
+
+    // Open the input, output and fault files of the job
+    PatternReader finput(openPatterns(job), input_list.size());
+    std::ifstream ffault;
+    BufferedWriter foutput(job.outputs);
+
+    if (!finput.isOpen())
+    {
+        log << "Unable to open the input patterns " << job.patterns << std::endl;
+        return 1;
+    }
+
+    if (job.mode == 0)
+    {
+        ffault.open(job.faults);
+
+        if (!ffault.is_open())
+        {
+            log << "Unable to open the fault list " << job.faults << std::endl;
+            return 1;
+        }
+    }
+
+    // String to store the lines read from the files
+    std::string line;
+
+    // Print some basic information about the circuit
+    log << "Circuit " << job.netlist << ": " << std::endl;
+    log << "The circuit has " << gate_list.size() << " gates." << std::endl;
+    log << "The circuit has " << net_list.size() << " nets." << std::endl;
+    log << "The circuit has " << input_list.size() << " inputs." << std::endl;
+    log << "The circuit has " << output_list.size() << " outputs." << std::endl;
+
+    // Start main logic loop
+
+    // Create the vector to store the inputs
+    std::vector<int> inputs;
+
+    // Create a global fault list
+    std::vector<Fault> fault_list;
+
+    // Variable to decide the operating mode of the program
+    int mode = job.mode;
+
+    // Circuits with flip-flops are simulated as sequences of patterns, the flip-flop inputs are observed like outputs
+    bool sequential = !circuit.dff_list.empty();
+    std::vector<int> observed = output_list;
+
+    for (int i = 0; i < circuit.dff_list.size(); ++i)
+    {
+        observed.push_back(circuit.dff_list[i].first);
+    }
+
+    if (sequential && job.model == FAULT_TRANSITION)
+    {
+        log << "Transition faults are not supported in circuits with flip-flops" << std::endl;
+        return 1;
+    }
+
+    if (!job.dictionary.empty() && (sequential || job.model != FAULT_STUCK_AT))
+    {
+        log << "Fault dictionaries are only built for stuck at faults in combinational circuits" << std::endl;
+        return 1;
+    }
+
+    // Numbering of the net and fanout branch fault sites
+    FaultSites sites(gate_list, net_list, observed);
+
+    if (mode == 0)
+    {
+        std::string fnet, fval;
+
+        // Parse the file containing the fault list
+        while (getline(ffault, line))
+        {
+            std::stringstream ss(line);
+            if (!(ss >> fnet >> fval))
+            {
+                continue;
+            }
+
+            Fault temp;
+            if (!parseFault(fnet, fval, gate_list, net_list, temp) || sites.siteOf(temp) == -1 || temp.model != job.model)
+            {
+                log << "Invalid fault " << line << ", will be ignored" << std::endl;
+                continue;
+            }
+
+            // A pin without fanout carries the same fault as its net
+            if (sites.siteOf(temp) < sites.num_nets)
+            {
+                temp.gate = -1;
+            }
+
+            fault_list.push_back(temp);
+        }
+    }
+    else
+    {
+        // Populate the fault list with all possible faults in the circuit
+        fault_list = sites.allFaults(job.pin_faults, job.model);
+    }
+
+    // Variable to store the total number of faults
+    int total_faults = fault_list.size();
+
+    // Collapse the fault list, only one fault of every equivalence class is simulated
+    // The structural equivalences of stuck at faults do not hold for transition faults
+    CollapsedFaults collapsed;
+    {
+        INSTRUMENT_PHASE(PHASE_COLLAPSE);
+        collapsed = job.collapse != COLLAPSE_NONE && job.model == FAULT_STUCK_AT ? collapseFaults(gate_list, net_list, observed, fault_list, false) : uncollapsedFaults(fault_list);
+    }
+    std::vector<Fault> &sim_fault_list = collapsed.faults;
+
+    log << "Collapsed " << total_faults << " faults into " << sim_fault_list.size() << " classes." << std::endl;
+
+    // Position of the representative of every class
+    std::map<Fault, int> class_index;
+    for (int i = 0; i < sim_fault_list.size(); ++i)
+    {
+        class_index.insert(std::make_pair(sim_fault_list[i], i));
+    }
+
+    // Stuck at faults of the classes by site, at 2 * site + value, the deductive engine looks up the branch faults here
+    std::vector<char> simulated(2 * sites.num_sites, 0);
+    for (int i = 0; i < sim_fault_list.size(); ++i)
+    {
+        int site = sites.siteOf(sim_fault_list[i]);
+        if (site != -1 && sim_fault_list[i].model == FAULT_STUCK_AT)
+        {
+            simulated[2 * site + sim_fault_list[i].value] = 1;
+        }
+    }
+
+    // Open the report of the detected faults, written once per pattern
+    DetectionReport outputFile(job.detected, job.report_format, fault_list, gate_list);
+
+    if (!foutput.isOpen() || !outputFile.isOpen())
+    {
+        log << "Unable to open the output files " << job.outputs << " and " << job.detected << std::endl;
+        return 1;
+    }
+
+    // State of the critical path tracing and concurrent engines, allocated once per job
+    CriticalPathTracer tracer(gate_list, net_list, output_list);
+    ConcurrentFaultSimulator concurrent(gate_list, net_list, output_list, sim_fault_list, sites);
+
+    // Compiled circuit of the parallel fault engine
+    CompiledCircuit compiled(gate_list, net_list, input_list, output_list, circuit.dff_list);
+    ParallelFaultSimulator parallel(compiled, sites);
+    TransitionFaultSimulator transition(compiled, sites);
+
+    // The sequential engine is only built for netlists with flip-flops
+    std::unique_ptr<SequentialFaultSimulator> sequence;
+    if (sequential)
+    {
+        sequence.reset(new SequentialFaultSimulator(compiled, sites));
+    }
+
+    // Level parallel evaluation of the compiled circuit, its worker threads live as long as the job
+    std::unique_ptr<LevelParallelExecutor> executor;
+
+    if (job.level_threads > 1 && !sequential && (job.engine == ENGINE_PARALLEL || job.model == FAULT_TRANSITION))
+    {
+        executor.reset(new LevelParallelExecutor(compiled, job.level_threads));
+        parallel.useExecutor(executor.get());
+        transition.useExecutor(executor.get());
+    }
+
+    // Compiled code logic simulation of the stuck at patterns, 64 patterns per call
+    CompiledKernel kernel;
+    std::vector<uint64_t> kernel_values;
+
+    if (!job.kernel_cache.empty() && job.model == FAULT_STUCK_AT && !sequential)
+    {
+        std::string error;
+        if (kernel.load(compiled, job.kernel_cache, error))
+        {
+            log << "Simulating with the compiled kernel " << kernel.path() << (kernel.wasCached() ? " (cached)." : ".") << std::endl;
+            kernel_values.assign(compiled.num_nets, 0);
+        }
+        else
+        {
+            log << "Compiled simulation unavailable, " << error << ". Using the interpreter." << std::endl;
+        }
+    }
+
+    // Dictionary of the classes, every class is simulated against every pattern whether faults are dropped or not
+    std::unique_ptr<FaultDictionaryBuilder> dictionary;
+
+    if (!job.dictionary.empty())
+    {
+        dictionary.reset(new FaultDictionaryBuilder(compiled, sites, sim_fault_list));
+    }
+
+    // Classes detected by an earlier pattern, skipped when faults are dropped
+    std::vector<char> dropped(sim_fault_list.size(), 0);
+    std::vector<int> targets, detected;
+
+    // Faults detected by at least one pattern and the number of patterns simulated
+    std::set<Fault> ever_detected;
+    int num_patterns = 0;
+
+    // Read the input patterns from the file in chunks
+    std::vector<uint64_t> pattern_words;
+    int chunk_size;
+
+    // Report the faults detected by pattern p of a packed chunk, given as one word per class
+    auto recordPacked = [&](const std::vector<uint64_t> &words, int p)
+    {
+        std::vector<Fault> detected_faults;
+
+        for (int f = 0; f < sim_fault_list.size(); ++f)
+        {
+            if (!dropped[f] && ((words[f] >> p) & 1))
+            {
+                for (int m : collapsed.members[f])
+                {
+                    detected_faults.push_back(fault_list[m]);
+                }
+
+                if (job.drop)
+                {
+                    dropped[f] = 1;
+                }
+            }
+        }
+
+        std::sort(detected_faults.begin(), detected_faults.end());
+        detected_faults.erase(std::unique(detected_faults.begin(), detected_faults.end()), detected_faults.end());
+
+        {
+            INSTRUMENT_PHASE(PHASE_WRITE);
+            outputFile.writePattern(detected_faults);
+        }
+
+        ever_detected.insert(detected_faults.begin(), detected_faults.end());
+        num_patterns++;
+        INSTRUMENT_COUNT(COUNTER_PATTERNS, 1);
+    };
+
+    // Transition faults are simulated on 64 pattern pairs at a time
+    std::vector<uint64_t> launch_words, pair_detected;
+
+    while (job.model == FAULT_TRANSITION && (chunk_size = finput.readPairChunk(pattern_words, launch_words)) > 0)
+    {
+        uint64_t mask = chunk_size == 64 ? ~0ULL : (1ULL << chunk_size) - 1;
+
+        {
+            INSTRUMENT_PHASE(PHASE_FAULT_SIM);
+            transition.simulate(pattern_words, launch_words, mask, sim_fault_list, pair_detected);
+        }
+
+        for (int p = 0; p < chunk_size; ++p)
+        {
+            // The outputs are captured after the second vector
+            for (int i = 0; i < compiled.outputs.size(); ++i)
+            {
+                foutput.writeChar('0' + ((transition.final()[compiled.outputs[i]] >> p) & 1));
+            }
+            foutput.writeChar('\n');
+
+            recordPacked(pair_detected, p);
+        }
+    }
+
+    // Sequences are simulated 64 at a time, every sequence starts from the reset state
+    std::vector<std::vector<uint64_t>> frames;
+    std::vector<uint64_t> active, sequence_detected;
+    std::vector<int> lengths;
+
+    while (sequential && (chunk_size = finput.readSequenceChunk(frames, active, lengths)) > 0)
+    {
+        targets.clear();
+        for (int f = 0; f < sim_fault_list.size(); ++f)
+        {
+            if (!dropped[f])
+            {
+                targets.push_back(f);
+            }
+        }
+
+        {
+            INSTRUMENT_PHASE(PHASE_FAULT_SIM);
+            sequence->simulate(frames, active, sim_fault_list, targets, sequence_detected);
+        }
+
+        for (int p = 0; p < chunk_size; ++p)
+        {
+            // One output line per frame, the sequences are separated by empty lines like in the pattern file
+            for (int t = 0; t < lengths[p]; ++t)
+            {
+                for (int i = 0; i < compiled.outputs.size(); ++i)
+                {
+                    foutput.writeChar('0' + ((sequence->good[t][compiled.outputs[i]] >> p) & 1));
+                }
+                foutput.writeChar('\n');
+            }
+            foutput.writeChar('\n');
+
+            recordPacked(sequence_detected, p);
+        }
+    }
+
+    // Stuck at faults are simulated one pattern at a time
+    while (job.model == FAULT_STUCK_AT && !sequential && (chunk_size = finput.readChunk(pattern_words)) > 0)
+    {
+        if (dictionary != nullptr)
+        {
+            INSTRUMENT_PHASE(PHASE_FAULT_SIM);
+            dictionary->addChunk(pattern_words, chunk_size);
+        }
+
+        if (kernel.isLoaded())
+        {
+            INSTRUMENT_PHASE(PHASE_SIMULATE);
+
+            for (int i = 0; i < compiled.inputs.size(); ++i)
+            {
+                kernel_values[compiled.inputs[i]] = pattern_words[i];
+            }
+            kernel.evaluate(kernel_values.data());
+        }
+
+        for (int p = 0; p < chunk_size; ++p)
+        {
+            // Unpack the values of the inputs for the current pattern
+            inputs.resize(input_list.size());
+            for (int i = 0; i < input_list.size(); ++i)
+            {
+                inputs[i] = (pattern_words[i] >> p) & 1;
+            }
+
+            // Logic simulation of the pattern, unpacked from the words of the compiled kernel when it is loaded
+            {
+                INSTRUMENT_PHASE(PHASE_SIMULATE);
+
+                if (kernel.isLoaded())
+                {
+                    unpackPattern(kernel_values, p, net_list, gate_list);
+                }
+                else
+                {
+                    simulatePattern(inputs, input_list, net_list, gate_list);
+                }
+            }
+
+            // Create a vector to store the outputs of the circuit
+            std::vector<int> outputs;
+
+            // Create a string to store the value to be printed
+            std::string output_string = "";
+
+            // Find the outputs of the circuit
+            for (int i = 0; i < output_list.size(); ++i)
+            {
+                outputs.push_back(net_list[output_list[i] - 1].value);
+                output_string += std::to_string(net_list[output_list[i] - 1].value);
+            }
+
+            // Write the binary string to the output file
+            {
+                INSTRUMENT_PHASE(PHASE_WRITE);
+                foutput.write(output_string);
+                foutput.writeChar('\n');
+            }
+
+            std::vector<Fault> detected_faults;
+
+            if (job.engine == ENGINE_CPT)
+            {
+                INSTRUMENT_PHASE(PHASE_FAULT_SIM);
+
+                // Trace the critical lines and look up the faults on them
+                tracer.trace(gate_list, net_list);
+
+                for (int f = 0; f < sim_fault_list.size(); ++f)
+                {
+                    if (!dropped[f] && tracer.detects(sim_fault_list[f], sites, net_list))
+                    {
+                        detected_faults.push_back(sim_fault_list[f]);
+                    }
+                }
+            }
+            else if (job.engine == ENGINE_PARALLEL)
+            {
+                INSTRUMENT_PHASE(PHASE_FAULT_SIM);
+
+                // Simulate the classes which are still undetected, or all of them without dropping
+                targets.clear();
+                for (int f = 0; f < sim_fault_list.size(); ++f)
+                {
+                    if (!dropped[f])
+                    {
+                        targets.push_back(f);
+                    }
+                }
+
+                parallel.simulate(inputs, sim_fault_list, targets, detected);
+
+                for (int f : detected)
+                {
+                    detected_faults.push_back(sim_fault_list[f]);
+                }
+            }
+            else if (job.engine == ENGINE_CONCURRENT)
+            {
+                INSTRUMENT_PHASE(PHASE_FAULT_SIM);
+
+                // Update the faulty machines of the gates affected by the new pattern
+                detected = concurrent.simulate(gate_list, net_list);
+
+                for (int f : detected)
+                {
+                    detected_faults.push_back(sim_fault_list[f]);
+                }
+            }
+            else
+            {
+                INSTRUMENT_PHASE(PHASE_FAULT_SIM);
+                detected_faults = deductiveFaultSimulation(gate_list, net_list, input_list, output_list, sim_fault_list, sites, simulated);
+            }
+
+            // Expand the detected classes to all the faults of the original list
+            std::vector<Fault> detected_classes = detected_faults;
+            detected_faults.clear();
+
+            for (const Fault &fault : detected_classes)
+            {
+                auto it = class_index.find(fault);
+                if (it == class_index.end() || dropped[it->second])
+                {
+                    continue;
+                }
+
+                if (job.drop)
+                {
+                    dropped[it->second] = 1;
+                }
+
+                for (int m : collapsed.members[it->second])
+                {
+                    detected_faults.push_back(fault_list[m]);
+                }
+            }
+
+            // Sort the detected fault list
+            std::sort(detected_faults.begin(), detected_faults.end());
+            detected_faults.erase(std::unique(detected_faults.begin(), detected_faults.end()), detected_faults.end());
+
+            // Write the faults detected by the pattern
+            {
+                INSTRUMENT_PHASE(PHASE_WRITE);
+                outputFile.writePattern(detected_faults);
+            }
+
+            ever_detected.insert(detected_faults.begin(), detected_faults.end());
+            num_patterns++;
+            INSTRUMENT_COUNT(COUNTER_PATTERNS, 1);
+        }
+    }
+
+    if (finput.skippedInvalid() > 0)
+    {
+        log << "Skipped " << finput.skippedInvalid() << " patterns with an invalid character." << std::endl;
+    }
+    if (finput.skippedShort() > 0)
+    {
+        log << "Skipped " << finput.skippedShort() << " patterns with fewer bits than inputs." << std::endl;
+    }
+    if (finput.skippedLong() > 0)
+    {
+        log << "Skipped " << finput.skippedLong() << " patterns with more bits than inputs." << std::endl;
+    }
+
+    log << "Simulated " << num_patterns << " patterns, " << ever_detected.size() << " of " << total_faults << " faults detected." << std::endl;
+
+    if (dictionary != nullptr)
+    {
+        INSTRUMENT_PHASE(PHASE_WRITE);
+
+        std::vector<int> branch_net(fault_list.size(), 0);
+        for (int i = 0; i < fault_list.size(); ++i)
+        {
+            if (fault_list[i].gate != -1)
+            {
+                branch_net[i] = gate_list[fault_list[i].gate].output_net.id;
+            }
+        }
+
+        std::string error;
+        if (!dictionary->write(job.dictionary, fault_list, collapsed.class_of, branch_net, error))
+        {
+            log << "Unable to write the fault dictionary: " << error << std::endl;
+            return 1;
+        }
+
+        log << "Wrote the fault dictionary " << job.dictionary << " of " << sim_fault_list.size() << " classes and " << dictionary->numPatterns() << " patterns." << std::endl;
+    }
+
+    // Close the files
+    ffault.close();
+    foutput.close();
+
+    return 0;
+}
+
+void printUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " [options] <netlist>" << std::endl;
+    std::cout << "       " << program << " [options] --batch <manifest>" << std::endl;
+    std::cout << "       " << program << " [options] --serve <socket>" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -i, --patterns <file>  input patterns (default i_<netlist>)" << std::endl;
+    std::cout << "  -f, --faults <file>    fault list used in mode 0 (default f_<netlist>)" << std::endl;
+    std::cout << "  -o, --outputs <file>   output responses (default o_<netlist>)" << std::endl;
+    std::cout << "  -d, --detected <file>  detected fault report (default d_<netlist>)" << std::endl;
+    std::cout << "  -m, --mode <0|1>       0: faults from the fault list, 1: all faults (default 1)" << std::endl;
+    std::cout << "  -r, --report <format>  detected fault report format: text, binary or bitmap (default text)" << std::endl;
+    std::cout << "  -c, --collapse <mode>  fault collapsing: none or equiv (default equiv)" << std::endl;
+    std::cout << "  -s, --sites <model>    fault universe of mode 1: net or pin, pin adds fanout branches (default net)" << std::endl;
+    std::cout << "  -e, --engine <name>    fault simulation engine: deductive, cpt, concurrent or parallel (default deductive)" << std::endl;
+    std::cout << "  -t, --model <model>    fault model: stuck or transition, transitions take pattern pairs (default stuck)" << std::endl;
+    std::cout << "  -x, --drop             drop detected faults, report every fault only for the first pattern detecting it" << std::endl;
+    std::cout << "  -k, --compiled <dir>   simulate the stuck at patterns with a compiled kernel of the netlist cached in dir" << std::endl;
+    std::cout << "  --dictionary <file>    build a pass/fail fault dictionary of the stuck at patterns for diagnose" << std::endl;
+    std::cout << "  -p, --level-threads <n> threads sharing every level of the netlist in the parallel and transition engines (default 1)" << std::endl;
+    std::cout << "  -j, --threads <n>      worker threads used to run batch jobs (default 1)" << std::endl;
+    std::cout << "  -b, --batch <file>     run every job listed in the manifest, one job per line" << std::endl;
+    std::cout << "  --serve <socket>       run jobs sent to a Unix socket until a shutdown request, -i - streams the patterns" << std::endl;
+    std::cout << "  --stats <file>         write the counters and phase times of the run as JSON (build with -DATPG_INSTRUMENT)" << std::endl;
+    std::cout << "  -h, --help             print this message" << std::endl;
+}
+
+// Parse command line style arguments into a job
+// The batch manifest, server socket, thread count and statistics report are only accepted on the real command line
+bool parseArguments(const std::vector<std::string> &args, SimJob &job, std::string *batch, int *threads, std::string *stats, std::string *serve)
+{
+    for (int i = 0; i < args.size(); ++i)
+    {
+        std::string arg = args[i];
+
+        // Options without a value
+        if (arg == "-h" || arg == "--help")
+        {
+            return false;
+        }
+
+        if (arg == "-x" || arg == "--drop")
+        {
+            job.drop = true;
+            continue;
+        }
+
+        // Positional argument, the netlist
+        if (arg.empty() || arg[0] != '-')
+        {
+            job.netlist = arg;
+            continue;
+        }
+
+        // All the other options take a value
+        if (i + 1 >= args.size())
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+
+        std::string value = args[++i];
+
+        if (arg == "-i" || arg == "--patterns")
+        {
+            job.patterns = value;
+        }
+        else if (arg == "-f" || arg == "--faults")
+        {
+            job.faults = value;
+        }
+        else if (arg == "-o" || arg == "--outputs")
+        {
+            job.outputs = value;
+        }
+        else if (arg == "-d" || arg == "--detected")
+        {
+            job.detected = value;
+        }
+        else if (arg == "-m" || arg == "--mode")
+        {
+            if (value != "0" && value != "1")
+            {
+                std::cerr << "Invalid mode " << value << std::endl;
+                return false;
+            }
+            job.mode = std::stoi(value);
+        }
+        else if (arg == "-c" || arg == "--collapse")
+        {
+            if (value != "none" && value != "equiv")
+            {
+                std::cerr << "Invalid collapsing mode " << value << std::endl;
+                return false;
+            }
+            job.collapse = value == "equiv" ? COLLAPSE_EQUIVALENCE : COLLAPSE_NONE;
+        }
+        else if (arg == "-s" || arg == "--sites")
+        {
+            if (value != "net" && value != "pin")
+            {
+                std::cerr << "Invalid fault site model " << value << std::endl;
+                return false;
+            }
+            job.pin_faults = value == "pin";
+        }
+        else if (arg == "-k" || arg == "--compiled")
+        {
+            job.kernel_cache = value;
+        }
+        else if (arg == "--dictionary")
+        {
+            job.dictionary = value;
+        }
+        else if (arg == "-p" || arg == "--level-threads")
+        {
+            job.level_threads = std::atoi(value.c_str());
+            if (job.level_threads < 1)
+            {
+                std::cerr << "Invalid level thread count " << value << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "-t" || arg == "--model")
+        {
+            if (value != "stuck" && value != "transition")
+            {
+                std::cerr << "Invalid fault model " << value << std::endl;
+                return false;
+            }
+            job.model = value == "transition" ? FAULT_TRANSITION : FAULT_STUCK_AT;
+        }
+        else if (arg == "-e" || arg == "--engine")
+        {
+            if (value == "deductive")
+            {
+                job.engine = ENGINE_DEDUCTIVE;
+            }
+            else if (value == "cpt")
+            {
+                job.engine = ENGINE_CPT;
+            }
+            else if (value == "concurrent")
+            {
+                job.engine = ENGINE_CONCURRENT;
+            }
+            else if (value == "parallel")
+            {
+                job.engine = ENGINE_PARALLEL;
+            }
+            else
+            {
+                std::cerr << "Invalid fault simulation engine " << value << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "-r" || arg == "--report")
+        {
+            if (value == "text")
+            {
+                job.report_format = REPORT_TEXT;
+            }
+            else if (value == "binary")
+            {
+                job.report_format = REPORT_BINARY;
+            }
+            else if (value == "bitmap")
+            {
+                job.report_format = REPORT_BITMAP;
+            }
+            else
+            {
+                std::cerr << "Invalid report format " << value << std::endl;
+                return false;
+            }
+        }
+        else if ((arg == "-j" || arg == "--threads") && threads != nullptr)
+        {
+            *threads = std::atoi(value.c_str());
+            if (*threads < 1)
+            {
+                std::cerr << "Invalid thread count " << value << std::endl;
+                return false;
+            }
+        }
+        else if ((arg == "-b" || arg == "--batch") && batch != nullptr)
+        {
+            *batch = value;
+        }
+        else if (arg == "--stats" && stats != nullptr)
+        {
+            *stats = value;
+        }
+        else if (arg == "--serve" && serve != nullptr)
+        {
+            *serve = value;
+        }
+        else
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Fill in the default paths of the files which were not given explicitly
+void completeJob(SimJob &job)
+{
+    if (job.patterns.empty())
+    {
+        job.patterns = companionPath(job.netlist, "i_");
+    }
+    if (job.faults.empty())
+    {
+        job.faults = companionPath(job.netlist, "f_");
+    }
+    if (job.outputs.empty())
+    {
+        job.outputs = companionPath(job.netlist, "o_");
+    }
+    if (job.detected.empty())
+    {
+        job.detected = companionPath(job.netlist, "d_");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // Options given on the command line
+    SimJob defaults;
+    std::string batch, stats, serve;
+    int threads = 1;
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    if (args.empty() || !parseArguments(args, defaults, &batch, &threads, &stats, &serve))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Netlists are parsed once and shared by all the jobs using them
+    NetlistCache cache;
+
+    // Server mode, the options of the command line act as defaults of every job sent to the socket
+    if (!serve.empty())
+    {
+        JobServer server(serve, threads, [&defaults, &cache](const std::vector<std::string> &job_args, const std::string &cwd, int connection, std::ostream &log)
+                         {
+            INSTRUMENT_PHASE(PHASE_JOB);
+            SimJob job = defaults;
+
+            if (!parseArguments(job_args, job, nullptr, nullptr, nullptr, nullptr) || job.netlist.empty())
+            {
+                log << "Invalid job, the request takes the arguments of a batch manifest line" << std::endl;
+                return 1;
+            }
+
+            job.netlist = resolvePath(cwd, job.netlist);
+            job.patterns = resolvePath(cwd, job.patterns);
+            job.faults = resolvePath(cwd, job.faults);
+            job.outputs = resolvePath(cwd, job.outputs);
+            job.detected = resolvePath(cwd, job.detected);
+            job.kernel_cache = resolvePath(cwd, job.kernel_cache);
+            job.dictionary = resolvePath(cwd, job.dictionary);
+            completeJob(job);
+
+            if (job.patterns == "-")
+            {
+                job.pattern_fd = connection;
+            }
+
+            std::shared_ptr<const Circuit> circuit = cache.get(job.netlist);
+            if (circuit == nullptr)
+            {
+                log << "Unable to read the netlist " << job.netlist << std::endl;
+                return 1;
+            }
+
+            return runSimulation(job, *circuit, log); });
+
+        std::string error;
+        if (!server.listen(error))
+        {
+            std::cerr << "Unable to serve on " << serve << ": " << error << std::endl;
+            return 1;
+        }
+
+        std::cout << "Serving jobs on " << serve << " with " << threads << " threads." << std::endl;
+        server.serve();
+
+        if (!stats.empty() && !Instrumentation::writeReport(stats, "part2"))
+        {
+            std::cerr << "Unable to write the statistics report " << stats << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    // Create the list of jobs to run
+    std::vector<SimJob> jobs;
+
+    if (!batch.empty())
+    {
+        bool read = readManifest(batch, defaults, jobs, [](const std::vector<std::string> &args, SimJob &job) {
+            if (!parseArguments(args, job, nullptr, nullptr, nullptr, nullptr) || job.netlist.empty())
+            {
+                return false;
+            }
+
+            completeJob(job);
+            return true; });
+
+        if (!read)
+        {
+            return 1;
+        }
+    }
+    else if (!defaults.netlist.empty())
+    {
+        completeJob(defaults);
+        jobs.push_back(defaults);
+    }
+    else
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    ThreadPool pool(std::min(threads, (int)jobs.size()));
+
+    // Serialise the console output of the jobs
+    std::mutex console;
+    int failures = 0;
+
+    for (int i = 0; i < jobs.size(); ++i)
+    {
+        const SimJob &job = jobs[i];
+
+        pool.submit([&job, &cache, &console, &failures]()
+                    {
+            INSTRUMENT_PHASE(PHASE_JOB);
+            std::ostringstream log;
+            int status = 1;
+
+            std::shared_ptr<const Circuit> circuit = cache.get(job.netlist);
+            if (circuit != nullptr)
+            {
+                status = runSimulation(job, *circuit, log);
+            }
+
+            std::lock_guard<std::mutex> lock(console);
+            std::cout << log.str();
+            if (status != 0)
+            {
+                failures++;
+            } });
+    }
+
+    pool.wait();
+
+    // Report of the counters and phase timers of the run
+    if (!stats.empty() && !Instrumentation::writeReport(stats, "part2"))
+    {
+        std::cerr << "Unable to write the statistics report " << stats << std::endl;
+        return 1;
+    }
+
+    return failures == 0 ? 0 : 1;
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <climits>
 #include <vector>
 #include <stack>
 #include <string>
@@ -6,183 +7,210 @@
 #include <fstream>
 #include <algorithm>
 #include <tuple>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <chrono>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ThreadPool.h"
+#include "Netlist.h"
+#include "Fault.h"
+#include "FaultCollapse.h"
+#include "CompiledCircuit.h"
+#include "ParallelFaultSim.h"
+#include "SatAtpg.h"
+#include "StaticLearning.h"
+#include "UntestableFaults.h"
+#include "Dominators.h"
+#include "FaultCone.h"
+#include "Instrumentation.h"
+#include "SearchTrace.h"
+#include "JobServer.h"
+#include "Checkpoint.h"
+#include "Hash.h"
 
-class Net
+// Returns the controlling value of the particular gate
+int controlling_value(std::string type)
 {
+    if (type == "AND")
+        return 0;
+    else if (type == "NAND")
+        return 0;
+    else if (type == "OR")
+        return 1;
+    else if (type == "NOR")
+        return 1;
+    else
+        return -3;
+}
 
-public:
-    // Information about the Net
-    int id;
-
-    // Information about connected Gates
-    std::vector<int> gates_into;
-    int input;
-
-    // Value that the net carries
-    int value;
-
-    // Flag to indicate the precense of a fault value D/Dbar
-    int isFault;
-
-    // Class constructor
-    Net(int value, int _id, int _input)
+// Evaluate a gate in three valued logic, where -1 is the unknown value X
+int evaluate3(const std::string &type, int in1, int in2)
+{
+    if (type == "BUF")
     {
-        value = value;
-        id = _id;
-        input = _input;
+        return in1;
     }
-
-    // Default constructor
-    Net()
+    else if (type == "INV")
     {
-        value = -1;
-        id = -1;
-        input = -1;
-        isFault = -1;
+        return in1 == -1 ? -1 : !in1;
     }
-};
 
-class Fault
-{
-public:
-    int net_id;
-    int value;
+    // Output of the gate for the controlling value on any input
+    int c = controlling_value(type);
+    int i = (type == "NAND" || type == "NOR") ? 1 : 0;
 
-    Fault(int _net_id, int _value)
+    if (in1 == c || in2 == c)
     {
-        net_id = _net_id;
-        value = _value;
+        return c ^ i;
     }
-
-    Fault()
+    else if (in1 == -1 || in2 == -1)
     {
-        net_id = -1;
-        value = -1;
+        return -1;
     }
 
-    bool operator<(const Fault &struct2) const
-    {
-        return std::tie(net_id, value) < std::tie(struct2.net_id, struct2.value);
-    }
+    return !c ^ i;
+}
 
-    bool operator==(const Fault &struct2) const
+// Value seen by input pin k of a gate in the faulty circuit
+int faultyInput(Fault target, Gate &g, int k, std::vector<Net> &net_list)
+{
+    int id = g.input_nets[k].id;
+
+    // A fault on a fanout branch only affects the pin of its gate
+    if (target.gate == g.id && target.net_id == id)
     {
-        return std::tie(net_id, value) == std::tie(struct2.net_id, struct2.value);
+        return target.value;
     }
-};
 
-class Gate
+    return net_list[id - 1].faulty;
+}
+
+// Check if input pin k of a gate carries a fault value D/Dbar
+bool pinHasFault(Fault target, Gate &g, int k, std::vector<Net> &net_list)
 {
+    int good = net_list[g.input_nets[k].id - 1].value;
+    int faulty = faultyInput(target, g, k, net_list);
 
-public:
-    // Information about the gate
-    std::string type;
-    int id;
+    return good != -1 && faulty != -1 && good != faulty;
+}
+
+// Static learning applied to the search for one fault
+// The learned implications hold in the good circuit, so a gate of the D frontier is only blocked through a side
+// input outside the fanout cone of the fault, where the good and the faulty values agree
+class LearnedImplications
+{
 
-    // Net information
-    std::vector<Net> input_nets;
-    Net output_net;
+public:
+    ImplicationGraph graph;
 
-    // Default constructor
-    Gate()
+    // Class constructor, learns the implications of the circuit
+    LearnedImplications(const CompiledCircuit &circuit) : graph(circuit)
     {
-        type = "";
-        id = -1;
-        input_nets = {};
+        fault_cone = nullptr;
     }
 
-    // Class constructor for two input gates
-    Gate(std::string _type, int _id, Net in1, Net in2, Net out)
+    // Find the fanout cone of the fault, the gates are in topological order
+    // An extracted cone of the fault is used instead of a pass over the gates when given
+    void prepare(Fault target, const std::vector<Gate> &gate_list, int num_nets, const FaultCone *cone = nullptr)
     {
-        type = _type;
-        id = _id;
+        fault_cone = cone;
+        if (cone != nullptr)
+        {
+            return;
+        }
+
+        in_cone.assign(num_nets, 0);
+
+        if (target.gate == -1)
+        {
+            in_cone[target.net_id - 1] = 1;
+        }
+
+        for (int j = 0; j < gate_list.size(); ++j)
+        {
+            const Gate &g = gate_list[j];
 
-        input_nets.push_back(in1);
-        input_nets.push_back(in2);
-        output_net = out;
+            for (int k = 0; k < g.input_nets.size(); ++k)
+            {
+                if (j == target.gate || in_cone[g.input_nets[k].id - 1])
+                {
+                    in_cone[g.output_net.id - 1] = 1;
+                }
+            }
+        }
     }
 
-    // Class constructor for one input gates
-    Gate(std::string _type, int _id, Net in1, Net out)
+    // Value forced on an unassigned net by the current assignment, -1 if none
+    int forced(int net_id, const std::vector<Net> &net_list) const
     {
-        type = _type;
-        id = _id;
+        return graph.forcedValue(net_id - 1, net_list);
+    }
 
-        input_nets.push_back(in1);
-        output_net = out;
+    // Check if a side input is forced to the controlling value c of its gate
+    bool blocks(int net_id, int c, const std::vector<Net> &net_list) const
+    {
+        bool inside = fault_cone != nullptr ? fault_cone->inFanout(net_id - 1) : in_cone[net_id - 1];
+        return !inside && forced(net_id, net_list) == c;
     }
+
+private:
+    std::vector<char> in_cone;
+    const FaultCone *fault_cone;
 };
 
-// Function to compare two nets based on their ID
-// Used for inserting net into the list of nets in order of the ID
-bool compareById(const Net &net1, const Net &net2)
+// With learned implications, a fault whose activation or propagation is already ruled out gets no objective
+// With the cone of the fault only the gates of its fanout which reach an output are searched for the D frontier
+std::tuple<int, int> objective(Fault target, std::vector<Net> &net_list, std::vector<Gate> &gate_list, const LearnedImplications *learned = nullptr, const FaultCone *cone = nullptr)
 {
-    return net1.id < net2.id;
-}
+    int l = -1, v = -2;
 
-// Returns the controlling value of the particular gate
-int controlling_value(std::string type)
-{
-    if (type == "AND")
-        return 0;
-    else if (type == "NAND")
-        return 0;
-    else if (type == "OR")
-        return 1;
-    else if (type == "NOR")
-        return 1;
-    else
-        return -3;
-}
+    // If the value of the net is unassigned, activate the fault
+    if (net_list[target.net_id - 1].value == -1)
+    {
+        if (learned != nullptr && learned->forced(target.net_id, net_list) == target.value)
+        {
+            return std::make_tuple(l, v);
+        }
 
-std::tuple<int, int> objective(int net_id, int net_val, std::vector<Net> &net_list, std::vector<Gate> &gate_list)
-{
-    int l = -1, v = -2;
+        l = target.net_id;
+        v = !target.value;
+        return std::make_tuple(l, v);
+    }
 
-    // If the value of the net is unassigned
-    if (net_list[net_id - 1].value == -1)
+    // If the net has the stuck at value, the fault can not be activated
+    if (net_list[target.net_id - 1].value == target.value)
     {
-        l = net_id;
-        v = !net_val;
         return std::make_tuple(l, v);
     }
 
-    // Find a gate from the D frontier, ie, a gate with an unassigned output and a fault value at the input
-    for (int j = 0; j < gate_list.size(); ++j)
+    // Find a gate from the D frontier, ie, a gate with an unknown output and a fault value at the input
+    int num_gates = cone != nullptr ? cone->frontier.size() : gate_list.size();
+    for (int j = 0; j < num_gates; ++j)
     {
-        Gate g = gate_list[j];
+        Gate &g = gate_list[cone != nullptr ? cone->frontier[j] : j];
+        Net &out = net_list[g.output_net.id - 1];
 
-        // If the gate has an unassigned value
-        if (net_list[g.output_net.id - 1].value == -1)
+        // If the gate has an unknown value in the good or the faulty circuit
+        if (g.input_nets.size() == 2 && (out.value == -1 || out.faulty == -1))
         {
-            if (g.input_nets.size() == 2)
+            for (int k = 0; k < 2; ++k)
             {
-                // If the value is found and if the other input is unassigned
-                if (net_list[g.input_nets[0].id - 1].isFault == 1)
+                // If the fault value is found and the other input is unassigned
+                if (pinHasFault(target, g, k, net_list) && net_list[g.input_nets[!k].id - 1].value == -1)
                 {
-                    if (net_list[g.input_nets[1].id - 1].value == -1)
+                    if (learned != nullptr && learned->blocks(g.input_nets[!k].id, controlling_value(g.type), net_list))
                     {
-                        // Set the correct net id
-                        int l = g.input_nets[1].id;
-
-                        // Get the inversion of the gate
-                        int c = !controlling_value(g.type);
-
-                        return std::make_tuple(l, c);
+                        continue;
                     }
-                }
-                else if (net_list[g.input_nets[1].id - 1].isFault == 1)
-                {
-                    if (net_list[g.input_nets[0].id - 1].value == -1)
-                    {
-                        // Set the correct net id
-                        int l = g.input_nets[0].id;
-
-                        // Get the inversion of the gate
-                        int c = !controlling_value(g.type);
 
-                        return std::make_tuple(l, c);
-                    }
+                    // Set the other input to the non controlling value of the gate
+                    return std::make_tuple(g.input_nets[!k].id, !controlling_value(g.type));
                 }
             }
         }
@@ -192,17 +220,19 @@ std::tuple<int, int> objective(int net_id, int net_val, std::vector<Net> &net_li
 }
 
 // Map a desired objective to a PI assignment
-std::tuple<int, int> backtrace(int net_id, int net_val, std::vector<Net> &net_list, std::vector<Gate> &gate_list)
+// With headline flags the backtrace also stops at a headline, which FAN assigns like an input
+// A variant other than 0 changes which of two unassigned gate inputs is followed, differently for every gate
+std::tuple<int, int> backtrace(int net_id, int net_val, std::vector<Net> &net_list, std::vector<Gate> &gate_list, const std::vector<char> *headline = nullptr, unsigned variant = 0)
 {
     // Original objective values
     int k = net_id;
     int v = net_val;
 
     // While the current net is not a PI
-    while (net_list[k - 1].input != -1)
+    while (net_list[k - 1].input != -1 && !(headline != nullptr && (*headline)[k - 1]))
     {
         // For the input gate of the current net
-        Gate g = gate_list[net_list[k - 1].input];
+        Gate &g = gate_list[net_list[k - 1].input];
 
         // Get the inversion of the gate
         int i;
@@ -217,11 +247,13 @@ std::tuple<int, int> backtrace(int net_id, int net_val, std::vector<Net> &net_li
 
         // For an input of the gate with an unassigned value
         int j = -1;
+        int first = variant != 0 ? ((g.id * 2654435761u) ^ (variant * 40503u)) >> 15 & 1 : 0;
         for (int m = 0; m < g.input_nets.size(); ++m)
         {
-            if (g.input_nets[m].value == -1)
+            int pin = (m + first) % g.input_nets.size();
+            if (net_list[g.input_nets[pin].id - 1].value == -1)
             {
-                j = g.input_nets[m].id;
+                j = g.input_nets[pin].id;
                 break;
             }
         }
@@ -242,359 +274,112 @@ std::tuple<int, int> backtrace(int net_id, int net_val, std::vector<Net> &net_li
     return std::make_tuple(k, v);
 }
 
-void propagateFault(Gate g, std::vector<Net> &net_list, std::vector<Gate> &gate_list)
-{
-    if (g.input_nets.size() == 1)
-    {
-        int in = g.input_nets[0].id;
-        int out = g.output_net.id;
-
-        // Directly propagate the fault
-        net_list[out - 1].isFault = net_list[in - 1].isFault;
-    }
-    else
-    {
-        // If one of the inputs is a fault value and the other is a non controlling value, propagate the fault value to the output
-        int in1 = g.input_nets[0].id;
-        int in2 = g.input_nets[1].id;
-
-        if (net_list[in1 - 1].isFault == 1)
-        {
-            if (net_list[in2 - 1].value != controlling_value(g.type))
-            {
-                net_list[g.output_net.id - 1].isFault = 1;
-            }
-        }
-
-        if (net_list[in2 - 1].isFault == 1)
-        {
-            if (net_list[in1 - 1].value != controlling_value(g.type))
-            {
-                net_list[g.output_net.id - 1].isFault = 1;
-            }
-        }
-    }
-}
-
-void evaluateGate(Fault target, Gate g, std::vector<Net> &net_list, std::vector<Gate> &gate_list)
+// Evaluate a gate in the good and the faulty circuit
+void evaluateGate(Fault target, Gate &g, std::vector<Net> &net_list)
 {
     // Temporary variables for calculation
-    int inval1, inval2, outval;
-
-    // out = in
-    if (g.type == "BUF")
-    {
-        inval1 = net_list[g.input_nets[0].id - 1].value;
-        outval = inval1;
-    }
-    // out = !in
-    else if (g.type == "INV")
-    {
-        inval1 = net_list[g.input_nets[0].id - 1].value;
-
-        if (inval1 == -1)
-        {
-            outval = inval1;
-        }
-        else
-        {
-            outval = !inval1;
-        }
-    }
-    else if (g.type == "AND")
-    {
-        inval1 = net_list[g.input_nets[0].id - 1].value;
-        inval2 = net_list[g.input_nets[1].id - 1].value;
+    int inval1, inval2 = -1;
+    int faulty1, faulty2 = -1;
 
-        if (inval1 == 0 || inval2 == 0)
-        {
-            outval = 0;
-        }
-        else
-        {
-            outval = inval1 & inval2;
-        }
-    }
-    else if (g.type == "OR")
-    {
-        inval1 = net_list[g.input_nets[0].id - 1].value;
-        inval2 = net_list[g.input_nets[1].id - 1].value;
+    inval1 = net_list[g.input_nets[0].id - 1].value;
+    faulty1 = faultyInput(target, g, 0, net_list);
 
-        if (inval1 == 1 || inval2 == 1)
-        {
-            outval = 1;
-        }
-        else
-        {
-            outval = inval1 | inval2;
-        }
-    }
-    else if (g.type == "NAND")
+    if (g.input_nets.size() == 2)
     {
-        inval1 = net_list[g.input_nets[0].id - 1].value;
         inval2 = net_list[g.input_nets[1].id - 1].value;
-
-        if (inval1 == 0 || inval2 == 0)
-        {
-            outval = 1;
-        }
-        else
-        {
-            outval = !(inval1 & inval2);
-        }
+        faulty2 = faultyInput(target, g, 1, net_list);
     }
-    else if (g.type == "NOR")
-    {
-        inval1 = net_list[g.input_nets[0].id - 1].value;
-        inval2 = net_list[g.input_nets[1].id - 1].value;
 
-        if (inval1 == 1 || inval2 == 1)
-        {
-            outval = 0;
-        }
-        else
-        {
-            outval = !(inval1 | inval2);
-        }
-    }
+    INSTRUMENT_COUNT(COUNTER_GATE_EVALS, 1);
 
-    // Update the value in the gate list
-    net_list[g.output_net.id - 1].value = outval;
+    Net &out = net_list[g.output_net.id - 1];
+    out.value = evaluate3(g.type, inval1, inval2);
+    out.faulty = evaluate3(g.type, faulty1, faulty2);
 
-    // Find all gates which have the net as an input
-    for (int j = 0; j < gate_list.size(); ++j)
+    // A fault on the output net forces its value in the faulty circuit
+    if (target.gate == -1 && target.net_id == out.id)
     {
-        // For all the inputs of a given gate
-        for (int k = 0; k < gate_list[j].input_nets.size(); ++k)
-        {
-            // For all the input which is the current net
-            if (gate_list[j].input_nets[k].id == net_list[g.output_net.id - 1].id)
-            {
-                // Update the value of the net in the gate object list
-                gate_list[j].input_nets[k].value = net_list[g.output_net.id - 1].value;
-            }
-        }
+        out.faulty = target.value;
     }
 
-    // Propagate the fault
-    propagateFault(g, net_list, gate_list);
-
-    // For the first run of PODEM
-    if (g.output_net.id == target.net_id && net_list[g.output_net.id - 1].value != target.value)
-    {
-        // Create a fault on the output line
-        net_list[g.output_net.id - 1].isFault = 1;
-    }
+    // The net carries D/Dbar when both circuits have known and different values
+    out.isFault = (out.value != -1 && out.faulty != -1 && out.value != out.faulty) ? 1 : 0;
 }
 
-void imply(Fault target, int net, int val, std::vector<Net> &net_list, std::vector<Gate> &gate_list)
+// Assign a value to a PI and simulate the good and the faulty circuit
+// The gates are stored in topological order, so a single pass updates every net
+// With headline flags the gates driving a headline are skipped, the headlines keep their assigned values
+// With the cone of the fault only the gates feeding the fault site or its reachable outputs are evaluated
+void imply(Fault target, int net, int val, std::vector<Net> &net_list, std::vector<Gate> &gate_list, const std::vector<char> *headline = nullptr, const FaultCone *cone = nullptr)
 {
+    INSTRUMENT_COUNT(COUNTER_IMPLICATIONS, 1);
+
     // Set the PI to the given value
-    net_list[net - 1].value = val;
+    Net &pi = net_list[net - 1];
+    pi.value = val;
+    pi.faulty = val;
 
     // If the current PI is the target fault site
-    if (net == target.net_id)
-    {
-        net_list[net - 1].isFault = 1;
-    }
-
-    // Find all gates which have the net as an input
-    for (int j = 0; j < gate_list.size(); ++j)
+    if (target.gate == -1 && net == target.net_id)
     {
-        // For all the inputs of a given gate
-        for (int k = 0; k < gate_list[j].input_nets.size(); ++k)
-        {
-            // For all the input which is the current net
-            if (gate_list[j].input_nets[k].id == net_list[net - 1].id)
-            {
-                // Update the value of the net in the gate object list
-                gate_list[j].input_nets[k].value = val;
-            }
-        }
+        pi.faulty = target.value;
     }
 
-    // Create a stack for logic simulation
-    std::stack<Gate> logic_stack;
+    pi.isFault = (pi.value != -1 && pi.value != pi.faulty) ? 1 : 0;
 
-    // Create a list which stores the ids of gates already added to the stack
-    std::vector<int> added_to_stack;
-
-    // Add all gates with both inputs assigned to a logic stack
-    for (int i = 0; i < gate_list.size(); ++i)
+    // Evaluate all the gates in order
+    int num_gates = cone != nullptr ? cone->gates.size() : gate_list.size();
+    for (int j = 0; j < num_gates; ++j)
     {
-        // For the current gate
-        Gate g = gate_list[i];
-
-        // Flag to set if the gate is assigned
-        bool isAssigned = true;
-        bool isOneControlling = false;
+        Gate &g = gate_list[cone != nullptr ? cone->gates[j] : j];
 
-        // check for unassigned outputs
-        if (net_list[g.output_net.id - 1].value == -1)
+        if (headline != nullptr && (*headline)[g.output_net.id - 1])
         {
-            // Either only one input is assigned and that input is the controlling value which does not carry the fault
-            for (int j = 0; j < g.input_nets.size(); ++j)
-            {
-                if (g.input_nets[j].value == controlling_value(g.type) && net_list[g.input_nets[j].id - 1].isFault != 1)
-                {
-                    isOneControlling = true;
-                    break;
-                }
-            }
-
-            // Or both inputs are assigned
-            for (int j = 0; j < g.input_nets.size(); ++j)
-            {
-                if (g.input_nets[j].value == -1)
-                {
-                    isAssigned = false;
-                    break;
-                }
-            }
+            continue;
         }
 
-        // If the gate has one input assigned
-        if (isAssigned == true || isOneControlling == true)
-        {
-            // Flag to mark if the gate has already been added to the stack
-            bool isAdded = false;
-
-            // Check if the gate is not already in the stack
-            for (int k = 0; k < added_to_stack.size(); ++k)
-            {
-                if (added_to_stack[k] == g.id)
-                {
-                    isAdded = true;
-                    break;
-                }
-            }
-
-            // If the gate was not added previously
-            if (isAdded == false)
-            {
-                // Push the gate onto the stack
-                logic_stack.push(g);
-                added_to_stack.push_back(g.id);
-            }
-        }
+        evaluateGate(target, g, net_list);
     }
 
-    // While the stack is not empty
-    while (!logic_stack.empty())
-    {
-        // Fetch the top value from the stack
-        Gate g = logic_stack.top();
-
-        // Pop the stack
-        logic_stack.pop();
-
-        // If the inputs are valid
-        int in1 = g.input_nets[0].id;
-        int in2;
-
-        if (g.input_nets.size() == 2)
-        {
-            in2 = g.input_nets[1].id;
-        }
-
-        if (net_list[in1 - 1].value != -1 && (g.type == "INV" | g.type == "BUF"))
-        {
-            // Evaluate the output of the gate
-            evaluateGate(target, g, net_list, gate_list);
-        }
-        else if ((g.type == "AND" || g.type == "OR" || g.type == "NAND" || g.type == "NOR") && net_list[in1 - 1].value != -1 && net_list[in1 - 1].value == controlling_value(g.type))
-        {
-            // Evaluate the output of the gate
-            evaluateGate(target, g, net_list, gate_list);
-        }
-        else if ((g.type == "AND" || g.type == "OR" || g.type == "NAND" || g.type == "NOR") && net_list[in2 - 1].value != -1 && net_list[in2 - 1].value == controlling_value(g.type))
-        {
-            // Evaluate the output of the gate
-            evaluateGate(target, g, net_list, gate_list);
-        }
-        else if ((g.type == "AND" || g.type == "OR" || g.type == "NAND" || g.type == "NOR") && net_list[in1 - 1].value != -1 && net_list[in2 - 1].value != -1)
-        {
-            // Evaluate the output of the gate
-            evaluateGate(target, g, net_list, gate_list);
-        }
-
-        // Find gates with all assigned inputs not already in the stack
-        for (int i = 0; i < gate_list.size(); ++i)
-        {
-            // Fetch the number of inputs for the current gate
-            int ins = gate_list[i].input_nets.size();
-
-            // Flag to set if the gate is assigned
-            bool isAssigned = true;
-            bool isOneControlling = false;
-
-            if (net_list[gate_list[i].output_net.id - 1].value == -1)
-            {
-                // Check if at least one input is assigned
-
-                // Either only one input is assigned and that input is the controlling value
-                for (int j = 0; j < gate_list[i].input_nets.size(); ++j)
-                {
-                    if (gate_list[i].input_nets[j].value == controlling_value(gate_list[i].type) && net_list[gate_list[i].input_nets[j].id - 1].isFault != 1)
-                    {
-                        isOneControlling = true;
-                        break;
-                    }
-                }
-
-                // Or both inputs are assigned
-                for (int j = 0; j < ins; ++j)
-                {
-                    if (gate_list[i].input_nets[j].value == -1)
-                    {
-                        isAssigned = false;
-                        break;
-                    }
-                }
-            }
+    SearchTrace::record(TRACE_IMPLICATION, val, net, num_gates);
+}
 
-            // Flag to mark if the gate has already been added to the stack
-            bool isAdded = false;
+// Effort counters of the test generation searches
+class SearchStats
+{
 
-            if (isAssigned == true || isOneControlling == true)
-            {
-                // Check if the gate is not already in the stack
-                for (int k = 0; k < added_to_stack.size(); ++k)
-                {
-                    if (added_to_stack[k] == gate_list[i].id)
-                    {
-                        isAdded = true;
-                        break;
-                    }
-                }
+public:
+    // Values assigned by the search and decisions reversed after a failure
+    long decisions;
+    long backtracks;
 
-                // If the gate was not added previously
-                if (isAdded == false)
-                {
-                    // Push the gate onto the stack
-                    logic_stack.push(gate_list[i]);
-                    added_to_stack.push_back(gate_list[i].id);
-                }
-            }
-        }
+    SearchStats()
+    {
+        decisions = 0;
+        backtracks = 0;
     }
-}
+};
 
-int PODEM(Fault target, std::vector<Net> &net_list, std::vector<int> &output_list, std::vector<Gate> &gate_list)
+// Returns 1 when a test is found, 0 when the fault is proven undetectable and -1 when the search is aborted
+// stats counts the decisions of the fault, the search aborts once it backtracks more than backtrack_limit times (0 for no limit)
+// With the cone of the fault the implication, the D frontier and the output check are limited to the cone
+int PODEM(Fault target, std::vector<Net> &net_list, std::vector<int> &output_list, std::vector<Gate> &gate_list, SearchStats &stats, int backtrack_limit, const LearnedImplications *learned = nullptr, const FaultCone *cone = nullptr, unsigned variant = 0)
 {
     // Check if the error has reached a primary output
-    for (int i = 0; i < output_list.size(); i++)
+    int num_outputs = cone != nullptr ? cone->outputs.size() : output_list.size();
+    for (int i = 0; i < num_outputs; i++)
     {
-        if (net_list[output_list[i] - 1].isFault == 1)
+        int id = cone != nullptr ? cone->outputs[i] + 1 : output_list[i];
+        if (net_list[id - 1].isFault == 1)
         {
-            std::cout << "Fault propagated to output net " << output_list[i] << std::endl;
+            SearchTrace::record(TRACE_PROPAGATED, 1, id);
             return 1;
         }
     }
 
     // Call the objective function based on the target fault
     int obj_net, obj_val;
-    std::tie(obj_net, obj_val) = objective(target.net_id, target.value, net_list, gate_list);
+    std::tie(obj_net, obj_val) = objective(target, net_list, gate_list, learned, cone);
 
     // If the test is not possible, ie, if the objective is empty, return failure
     if (obj_net == -1 && obj_val == -2)
@@ -604,7 +389,7 @@ int PODEM(Fault target, std::vector<Net> &net_list, std::vector<int> &output_lis
 
     // Backtrace using the objective recieved
     int set_net, set_val;
-    std::tie(set_net, set_val) = backtrace(obj_net, obj_val, net_list, gate_list);
+    std::tie(set_net, set_val) = backtrace(obj_net, obj_val, net_list, gate_list, nullptr, variant);
 
     // If the backtrace is empty, return failure
     if (set_net == -1)
@@ -612,497 +397,1754 @@ int PODEM(Fault target, std::vector<Net> &net_list, std::vector<int> &output_lis
         return 0;
     }
 
-    std::cout << "The objective set is " << obj_net << " " << obj_val << std::endl;
-    std::cout << "The backtrack set is " << set_net << " " << set_val << std::endl;
+    SearchTrace::record(TRACE_OBJECTIVE, obj_val, obj_net);
+    SearchTrace::record(TRACE_DECISION, set_val, set_net);
+
+    stats.decisions++;
 
     // If all goes well, imply the PI assignments found from the backtrace
-    imply(target, set_net, set_val, net_list, gate_list);
+    imply(target, set_net, set_val, net_list, gate_list, nullptr, cone);
 
     // Recursively call PODEM and check if the D frontier moves
-    if (PODEM(target, net_list, output_list, gate_list) == 1)
+    int status = PODEM(target, net_list, output_list, gate_list, stats, backtrack_limit, learned, cone, variant);
+    if (status != 0)
     {
-        return 1;
+        return status;
     }
 
-    std::cout << "The new backtrack set is " << set_net << " " << !set_val << std::endl;
+    // Give up once the search has backtracked too often, the caller clears the circuit
+    stats.backtracks++;
+    if (backtrack_limit > 0 && stats.backtracks > backtrack_limit)
+    {
+        return -1;
+    }
+
+    SearchTrace::record(TRACE_BACKTRACK, !set_val, set_net);
 
     // If PODEM fails, reverse the implication
-    imply(target, set_net, !set_val, net_list, gate_list);
+    imply(target, set_net, !set_val, net_list, gate_list, nullptr, cone);
 
     // Check if the D frontier moves
-    if (PODEM(target, net_list, output_list, gate_list) == 1)
+    status = PODEM(target, net_list, output_list, gate_list, stats, backtrack_limit, learned, cone, variant);
+    if (status != 0)
     {
-        return 1;
+        return status;
     }
 
-    std::cout << "The final backtrack set is " << set_net << " -1" << std::endl;
+    SearchTrace::record(TRACE_RESET, -1, set_net);
 
     // IF PODEM fails again, imply the PI with value x
-    imply(target, set_net, -1, net_list, gate_list);
+    imply(target, set_net, -1, net_list, gate_list, nullptr, cone);
 
     return 0;
 }
 
-int main()
+// FAN test generation
+// The search assigns headlines, the free lines bounding the fanout free regions, instead of primary inputs and
+// justifies them only once a test has been found. Every step collects the objective of the fault together with
+// the values which unique sensitization requires on the dominators of the fault site, and a multiple backtrace
+// resolves them at once, stopping early at a fanout stem whose branches request conflicting values
+class FanSearch
 {
-    // Create the vectors to store the list of Gates and Nets
-    std::vector<Gate> gate_list;
-    std::vector<Net> net_list;
-
-    // Create a vector to store the inputs and outputs of the circuit
-    std::vector<int> input_list;
-    std::vector<int> output_list;
-
-    // Initialise file pointers for the input, output and netlist files
-    std::ifstream fin;
-    std::ifstream finput;
-    std::ifstream ffault;
-    std::ofstream foutput;
-
-    // Select which file to open
-    int file_set = 4;
-
-    // Get the file to use from the user
-    std::string filename;
-
-    // Get the input from the user
-    std::cout << "Enter the index of the file to use: ";
-    std::cin >> file_set;
-
-    // Open the set of input, output and netlist files according to the variable above
-    switch (file_set)
-    {
-    case 0:
-        filename = "s27.txt";
-        fin.open("s27.txt");
-        finput.open("i_s27.txt");
-        foutput.open("o_s27.txt");
-        ffault.open("f_s27.txt");
-        break;
-
-    case 1:
-        filename = "s298f_2.txt";
-        fin.open("s298f_2.txt");
-        finput.open("i_s298f_2.txt");
-        foutput.open("o_s298f_2.txt");
-        ffault.open("f_s298f_2.txt");
-        break;
-
-    case 2:
-        filename = "s344f_2.txt";
-        fin.open("s344f_2.txt");
-        finput.open("i_s344f_2.txt");
-        foutput.open("o_s344f_2.txt");
-        ffault.open("f_s344f_2.txt");
-        break;
-
-    case 3:
-        filename = "s349f_2.txt";
-        fin.open("s349f_2.txt");
-        finput.open("i_s349f_2.txt");
-        foutput.open("o_s349f_2.txt");
-        ffault.open("f_s349f_2.txt");
-        break;
-
-    case 4:
-        filename = "s344ff_2.txt";
-        fin.open("s344ff_2.txt");
-        finput.open("i_s344ff_2.txt");
-        foutput.open("o_s344ff_2.txt");
-        ffault.open("f_s344ff_2.txt");
-        break;
-
-    default:
-        filename = "test.txt";
-        fin.open("test.txt");
-        finput.open("i_test.txt");
-        foutput.open("o_test.txt");
-        ffault.open("f_test.txt");
-        break;
-    }
-
-    // Parsing the Netlist
-
-    // Strings to store the input characters
-    std::string line;
-    std::string str1, str2, str3, str4;
-
-    // Variables to store the net IDs
-    int net_val1, net_val2, out_val;
 
-    // Variable to store the count of the gates (and to give an id)
-    int id = 0;
-
-    // Till the end of file
-    while (getline(fin, line))
+public:
+    // Class constructor, finds the fanout stems and the bound lines of the circuit
+    // The learned implications, if given, have to outlive the search
+    FanSearch(const CompiledCircuit &compiled, const std::vector<Gate> &gate_list, const std::vector<Net> &net_list, const std::vector<int> &output_list, const ImplicationGraph *_learned = nullptr) : dominators(compiled)
     {
-        std::stringstream ss(line);
-        ss >> str1;
+        int num_nets = net_list.size();
+        learned = _learned;
 
-        // If GATE
-        if (str1 == "INV" || str1 == "BUF")
-        {
-            // Get the rest of the parameters as input
-            ss >> str2 >> str3;
+        is_output.assign(num_nets, 0);
+        stem.assign(num_nets, 0);
+        bound.assign(num_nets, 0);
+        queued.assign(num_nets, 0);
+        count0.assign(num_nets, 0);
+        count1.assign(num_nets, 0);
 
-            net_val1 = std::stoi(str2);
-            out_val = std::stoi(str3);
+        for (int i = 0; i < output_list.size(); ++i)
+        {
+            is_output[output_list[i] - 1] = 1;
+        }
 
-            // Flag to mark if the net already exists
-            bool exists = false;
+        for (int i = 0; i < num_nets; ++i)
+        {
+            stem[i] = net_list[i].gates_into.size() + is_output[i] > 1;
+        }
 
-            // Net object to pass to the gate constructor
-            Net in1;
+        // A line is bound when a fanout stem is in its fanin, the gates are in topological order
+        for (int j = 0; j < gate_list.size(); ++j)
+        {
+            const Gate &g = gate_list[j];
 
-            // Check if the net already exists
-            for (int i = 0; i < net_list.size(); ++i)
+            for (int k = 0; k < g.input_nets.size(); ++k)
             {
-                if (net_list[i].id == net_val1)
+                int m = g.input_nets[k].id - 1;
+                if (stem[m] || bound[m])
                 {
-                    // Update the gates_into list
-                    net_list[i].gates_into.push_back(id);
-
-                    // Make a copy of the existing net to pass to the gate constructor
-                    in1 = net_list[i];
-
-                    exists = true;
-                    break; // Found a Net with the target id, no need to continue searching
+                    bound[g.output_net.id - 1] = 1;
                 }
             }
+        }
+    }
 
-            // If the net does not exist
-            if (exists == false)
-            {
-                // If net doesn't exist, create a new object and insert into the array in a sorted format
-                in1.gates_into.push_back(id);
-                in1.id = net_val1;
-                in1.input = -1;
-                in1.value = -1;
-                in1.isFault = 0;
+    // Prepare the search for a fault
+    // Finds the headlines outside the fanout cone of the fault and the side inputs of the dominators of the fault site
+    void prepare(Fault target, const std::vector<Gate> &gate_list, const std::vector<Net> &net_list)
+    {
+        int num_nets = net_list.size();
+        int n = target.net_id - 1;
 
-                // If the vector is empty
-                if (net_list.empty())
-                {
-                    net_list.push_back(in1);
-                }
-                // Else
-                else
-                {
-                    auto it = std::lower_bound(net_list.begin(), net_list.end(), in1, compareById);
-                    net_list.insert(it, in1);
-                }
-            }
+        headline.assign(num_nets, 0);
 
-            exists = false;
+        // Every path to an output passes through the dominators of the fault site, their side inputs have to be non
+        // controlling, the search works with net ids
+        mandatory.clear();
+        unobservable = !dominators.analyze(n, target.gate, mandatory);
 
-            // Net object to pass to the gate constructor
-            Net out;
+        for (int i = 0; i < mandatory.size(); ++i)
+        {
+            mandatory[i].first++;
+        }
 
-            // Check if the net already exists
-            for (int i = 0; i < net_list.size(); ++i)
+        // Free lines feeding a bound line or the fault cone, their fanin is a tree which can always be justified
+        for (int i = 0; i < num_nets; ++i)
+        {
+            if (bound[i] || dominators.inCone(i))
             {
-                if (net_list[i].id == out_val)
-                {
-                    // Update the input variable of the gate
-                    net_list[i].input = id;
-
-                    // Make a copy of the existing net to pass to the gate constructor
-                    out = net_list[i];
-
-                    exists = true;
-                    break; // Found a Net with the target id, no need to continue searching
-                }
+                continue;
             }
 
-            // If the net does not exist
-            if (exists == false)
+            bool h = stem[i] || is_output[i];
+            for (int k = 0; k < net_list[i].gates_into.size(); ++k)
             {
-                // If net doesn't exist, create a new object and insert into the array in a sorted format
-                out.id = out_val;
-                out.input = id;
-                out.value = -1;
-                out.isFault = 0;
-
-                // If the vector is empty
-                if (net_list.empty())
+                int out = gate_list[net_list[i].gates_into[k]].output_net.id - 1;
+                if (bound[out] || dominators.inCone(out))
                 {
-                    net_list.push_back(out);
-                }
-                // Else
-                else
-                {
-                    auto it = std::lower_bound(net_list.begin(), net_list.end(), out, compareById);
-                    net_list.insert(it, out);
+                    h = true;
                 }
             }
 
-            // Create a gate object and instantiate with the above values
-            Gate g(str1, id, in1, out);
-            gate_list.push_back(g);
+            headline[i] = h;
+        }
+    }
 
-            id++;
+    // Search for a test of the prepared fault
+    // Returns 1 when a test is found, 0 when the fault is undetectable and -1 when the search is aborted
+    int search(Fault target, std::vector<Net> &net_list, std::vector<int> &output_list, std::vector<Gate> &gate_list, SearchStats &stats, int backtrack_limit)
+    {
+        // Check if the error has reached a primary output
+        for (int i = 0; i < output_list.size(); i++)
+        {
+            if (net_list[output_list[i] - 1].isFault == 1)
+            {
+                SearchTrace::record(TRACE_PROPAGATED, 1, output_list[i]);
+                return 1;
+            }
         }
-        else if (str1 == "AND" || str1 == "OR" || str1 == "NOR" || str1 == "NAND")
+
+        std::vector<std::pair<int, int>> objectives;
+        if (!collectObjectives(target, net_list, gate_list, objectives))
         {
-            // Get the rest of the parameters as input
-            ss >> str2 >> str3 >> str4;
+            return 0;
+        }
 
-            net_val1 = std::stoi(str2);
-            net_val2 = std::stoi(str3);
-            out_val = std::stoi(str4);
+        int set_net, set_val;
+        std::tie(set_net, set_val) = multipleBacktrace(objectives, net_list, gate_list);
 
-            // Flag to mark if the net already exists
-            bool exists = false;
+        if (set_net == -1)
+        {
+            return 0;
+        }
 
-            // Net object to pass to the gate constructor
-            Net in1;
+        SearchTrace::record(TRACE_DECISION, set_val, set_net);
 
-            // Check if the net already exists
-            for (int i = 0; i < net_list.size(); ++i)
-            {
-                if (net_list[i].id == net_val1)
-                {
-                    // Update the gates_into list
-                    net_list[i].gates_into.push_back(id);
+        stats.decisions++;
+        imply(target, set_net, set_val, net_list, gate_list, &headline);
 
-                    // Make a copy of the existing net to pass to the gate constructor
-                    in1 = net_list[i];
+        int status = search(target, net_list, output_list, gate_list, stats, backtrack_limit);
+        if (status != 0)
+        {
+            return status;
+        }
 
-                    exists = true;
-                    break; // Found a Net with the target id, no need to continue searching
-                }
-            }
+        stats.backtracks++;
+        if (backtrack_limit > 0 && stats.backtracks > backtrack_limit)
+        {
+            return -1;
+        }
 
-            // If the net does not exist
-            if (exists == false)
-            {
-                // If net doesn't exist, create a new object and insert into the array in a sorted format
-                in1.gates_into.push_back(id);
-                in1.id = net_val1;
-                in1.input = -1;
-                in1.value = -1;
-                in1.isFault = 0;
+        SearchTrace::record(TRACE_BACKTRACK, !set_val, set_net);
 
-                // If the vector is empty
-                if (net_list.empty())
-                {
-                    net_list.push_back(in1);
-                }
-                // Else
-                else
-                {
-                    auto it = std::lower_bound(net_list.begin(), net_list.end(), in1, compareById);
-                    net_list.insert(it, in1);
-                }
-            }
+        imply(target, set_net, !set_val, net_list, gate_list, &headline);
 
-            exists = false;
+        status = search(target, net_list, output_list, gate_list, stats, backtrack_limit);
+        if (status != 0)
+        {
+            return status;
+        }
 
-            // Net object to pass to the gate constructor
-            Net in2;
+        SearchTrace::record(TRACE_RESET, -1, set_net);
+        imply(target, set_net, -1, net_list, gate_list, &headline);
 
-            // Check if the net already exists
-            for (int i = 0; i < net_list.size(); ++i)
-            {
-                if (net_list[i].id == net_val2)
-                {
-                    // Update the gates_into list
-                    net_list[i].gates_into.push_back(id);
+        return 0;
+    }
 
-                    // Make a copy of the existing net to pass to the gate constructor
-                    in2 = net_list[i];
+    // Assign the primary inputs which justify the assigned headlines and simulate the circuit from the inputs
+    void justify(Fault target, std::vector<Net> &net_list, std::vector<Gate> &gate_list)
+    {
+        std::vector<std::pair<int, int>> lines;
 
-                    exists = true;
-                    break; // Found a Net with the target id, no need to continue searching
-                }
+        for (int i = 0; i < net_list.size(); ++i)
+        {
+            if (headline[i] && net_list[i].value != -1)
+            {
+                lines.push_back(std::make_pair(i, net_list[i].value));
             }
+        }
+
+        // The fanin of a headline is fanout free, so every requirement is met without conflict
+        while (!lines.empty())
+        {
+            int k = lines.back().first;
+            int v = lines.back().second;
+            lines.pop_back();
 
-            // If the net does not exist
-            if (exists == false)
+            Net &net = net_list[k];
+            if (net.input == -1)
             {
-                // If net doesn't exist, create a new object and insert into the array in a sorted format
-                in2.gates_into.push_back(id);
-                in2.id = net_val2;
-                in2.input = -1;
-                in2.value = -1;
-                in2.isFault = 0;
+                net.value = v;
+                net.faulty = v;
+                net.isFault = 0;
+                continue;
+            }
 
-                // If the vector is empty
-                if (net_list.empty())
-                {
-                    net_list.push_back(in2);
-                }
-                // Else
-                else
+            Gate &g = gate_list[net.input];
+            int c = controlling_value(g.type);
+            int w = (g.type == "INV" || g.type == "NAND" || g.type == "NOR") ? !v : v;
+
+            if (c < 0)
+            {
+                lines.push_back(std::make_pair(g.input_nets[0].id - 1, w));
+            }
+            else if (w == c)
+            {
+                lines.push_back(std::make_pair(g.input_nets[0].id - 1, c));
+            }
+            else
+            {
+                for (int m = 0; m < g.input_nets.size(); ++m)
                 {
-                    auto it = std::lower_bound(net_list.begin(), net_list.end(), in2, compareById);
-                    net_list.insert(it, in2);
+                    lines.push_back(std::make_pair(g.input_nets[m].id - 1, !c));
                 }
             }
+        }
+
+        for (int j = 0; j < gate_list.size(); ++j)
+        {
+            evaluateGate(target, gate_list[j], net_list);
+        }
+    }
 
-            exists = false;
+private:
+    // Output, fanout stem and bound flags of every line
+    std::vector<char> is_output, stem, bound;
 
-            // Net object to pass to the gate constructor
-            Net out;
+    // Fanout cone and dominators, headlines of the prepared fault, and the values required by unique sensitization
+    SiteDominators dominators;
+    std::vector<char> headline;
+    std::vector<std::pair<int, int>> mandatory;
+    bool unobservable;
 
-            // Check if the net already exists
-            for (int i = 0; i < net_list.size(); ++i)
-            {
-                if (net_list[i].id == out_val)
-                {
-                    // Update the input variable of the net
-                    net_list[i].input = id;
+    // Implications learned for the circuit, may be null
+    const ImplicationGraph *learned;
+
+    // Value forced on a line by the learned implications, -1 if none
+    int forced(int k, const std::vector<Net> &net_list) const
+    {
+        return learned != nullptr ? learned->forcedValue(k, net_list) : -1;
+    }
 
-                    // Make a copy of the existing net to pass to the gate constructor
-                    out = net_list[i];
+    // Scratch state of the multiple backtrace, the counts may grow with the number of reconvergent paths
+    std::vector<double> count0, count1;
+    std::vector<char> queued;
+    std::vector<int> touched;
+    std::priority_queue<std::pair<int, int>> queue;
 
-                    exists = true;
-                    break; // Found a Net with the target id, no need to continue searching
-                }
+    // Objectives of the next decision, returns false when the current assignment can not lead to a test
+    bool collectObjectives(Fault target, std::vector<Net> &net_list, std::vector<Gate> &gate_list, std::vector<std::pair<int, int>> &objectives)
+    {
+        if (unobservable)
+        {
+            return false;
+        }
+
+        // Activate the fault
+        Net &site = net_list[target.net_id - 1];
+        if (site.value == target.value)
+        {
+            return false;
+        }
+        if (site.value == -1)
+        {
+            if (forced(target.net_id - 1, net_list) == target.value)
+            {
+                return false;
+            }
+            objectives.push_back(std::make_pair(target.net_id, !target.value));
+        }
+
+        // Unique sensitization, a controlling value on a side input of a dominator blocks the fault
+        for (int i = 0; i < mandatory.size(); ++i)
+        {
+            int val = net_list[mandatory[i].first - 1].value;
+            if (val == -1)
+            {
+                val = forced(mandatory[i].first - 1, net_list);
+            }
+            if (val == !mandatory[i].second)
+            {
+                return false;
+            }
+            if (net_list[mandatory[i].first - 1].value == -1)
+            {
+                objectives.push_back(mandatory[i]);
             }
+        }
+
+        // Propagate through the first gate of the D frontier with an unassigned side input
+        if (site.value != -1)
+        {
+            bool found = false;
 
-            // If the net does not exist
-            if (exists == false)
+            for (int j = 0; j < gate_list.size() && !found; ++j)
             {
-                // If net doesn't exist, create a new object and insert into the array in a sorted format
-                out.id = out_val;
-                out.input = id;
-                out.value = -1;
-                out.isFault = 0;
+                Gate &g = gate_list[j];
+                Net &out = net_list[g.output_net.id - 1];
 
-                // If the vector is empty
-                if (net_list.empty())
+                if (g.input_nets.size() != 2 || (out.value != -1 && out.faulty != -1))
                 {
-                    net_list.push_back(out);
+                    continue;
                 }
-                // Else
-                else
+
+                for (int k = 0; k < 2; ++k)
                 {
-                    auto it = std::lower_bound(net_list.begin(), net_list.end(), out, compareById);
-                    net_list.insert(it, out);
+                    int side = g.input_nets[!k].id - 1;
+                    if (pinHasFault(target, g, k, net_list) && net_list[side].value == -1)
+                    {
+                        // A side input outside the cone forced to the controlling value blocks the gate
+                        if (!dominators.inCone(side) && forced(side, net_list) == controlling_value(g.type))
+                        {
+                            continue;
+                        }
+
+                        objectives.push_back(std::make_pair(g.input_nets[!k].id, !controlling_value(g.type)));
+                        found = true;
+                        break;
+                    }
                 }
             }
 
-            // Create a gate object and instantiate with the above values
-            Gate g(str1, id, in1, in2, out);
-            gate_list.push_back(g);
+            if (!found && objectives.empty())
+            {
+                return false;
+            }
+        }
+
+        return !objectives.empty();
+    }
 
-            id++;
+    // Add requests for a value of an unassigned line to the multiple backtrace
+    void request(int k, int v, double n, const std::vector<Net> &net_list)
+    {
+        if (n <= 0)
+        {
+            return;
         }
-        // If INPUT
-        else if (str1 == "INPUT")
+
+        if (!queued[k])
         {
-            int num;
-            while (ss >> num && num != -1)
-            {
-                input_list.push_back(num);
-            }
+            queued[k] = 1;
+            touched.push_back(k);
+            queue.push(std::make_pair(net_list[k].input, k));
         }
-        // If OUTPUT
-        else if (str1 == "OUTPUT")
+
+        if (v)
         {
-            int num;
-            while (ss >> num && num != -1)
-            {
-                output_list.push_back(num);
-            }
+            count1[k] += n;
         }
-        // If Invalid character in netlist, do nothing
         else
         {
-            std ::cout << "Invalid Input, will be ignored" << std::endl;
+            count0[k] += n;
         }
     }
 
-    // Print some basic information about the circuit
-    std::cout << "File Name: " << filename << std::endl;
-    std::cout << "Circuit Number " << file_set + 1 << ": " << std::endl;
-    std::cout << "The circuit has " << gate_list.size() << " gates." << std::endl;
-    std::cout << "The circuit has " << net_list.size() << " nets." << std::endl;
-    std::cout << "The circuit has " << input_list.size() << " inputs." << std::endl;
-    std::cout << "The circuit has " << output_list.size() << " outputs." << std::endl;
+    // Resolve a set of objectives into one headline or primary input assignment
+    // The requests are passed from the outputs towards the inputs, a gate output needing its controlled value asks
+    // its easiest input for the controlling value and one needing the other value asks all its inputs
+    std::tuple<int, int> multipleBacktrace(const std::vector<std::pair<int, int>> &objectives, std::vector<Net> &net_list, std::vector<Gate> &gate_list)
+    {
+        for (int i = 0; i < objectives.size(); ++i)
+        {
+            request(objectives[i].first - 1, objectives[i].second, 1, net_list);
+        }
 
-    // Create a list of faults to generate tests for
-    std::vector<Fault> fault_list;
+        int best = -1, best_val = 0, stem_net = -1, stem_val = 0;
+        double best_count = 0;
 
-    std::string fnet, fval;
+        while (!queue.empty())
+        {
+            int k = queue.top().second;
+            queue.pop();
 
-    // Parse the file containing the fault list
-    while (getline(ffault, line))
-    {
-        std::stringstream ss(line);
-        ss >> fnet >> fval;
+            double n0 = count0[k], n1 = count1[k];
 
-        int _net_id = std::stoi(fnet);
-        int _value = std::stoi(fval);
+            // Headlines and primary inputs are the candidate decisions, the most requested one is assigned
+            if (net_list[k].input == -1 || headline[k])
+            {
+                if (n0 + n1 > best_count)
+                {
+                    best = k;
+                    best_val = n1 > n0 ? 1 : 0;
+                    best_count = n0 + n1;
+                }
+                continue;
+            }
 
-        Fault temp(_net_id, _value);
-        fault_list.push_back(temp);
-    }
+            // The branches of a fanout stem disagree, decide the stem by vote
+            if (stem[k] && n0 > 0 && n1 > 0)
+            {
+                stem_net = k;
+                stem_val = n1 > n0 ? 1 : 0;
+                break;
+            }
 
-    // For all faults in the fault list
-    for (int i = 0; i < fault_list.size(); ++i)
-    {
-        // For the current fault
-        Fault target(fault_list[i].net_id, fault_list[i].value);
+            Gate &g = gate_list[net_list[k].input];
+            int c = controlling_value(g.type);
+            bool inv = g.type == "INV" || g.type == "NAND" || g.type == "NOR";
 
-        // Call PODEM on the fault
-        int status = PODEM(target, net_list, output_list, gate_list);
+            // Requests for the output value before the inversion
+            double m0 = inv ? n1 : n0, m1 = inv ? n0 : n1;
 
-        // If the test generation is successful
-        if (status == 1)
-        {
-            // Print the value of the generated test(s) to a file
-            for (int i = 0; i < input_list.size(); ++i)
+            if (c < 0)
+            {
+                int in = g.input_nets[0].id - 1;
+                request(in, 0, m0, net_list);
+                request(in, 1, m1, net_list);
+                continue;
+            }
+
+            double controlled = c == 0 ? m0 : m1, uncontrolled = c == 0 ? m1 : m0;
+
+            int easiest = -1;
+            for (int m = 0; m < g.input_nets.size(); ++m)
             {
-                if (net_list[input_list[i] - 1].value != -1)
+                int in = g.input_nets[m].id - 1;
+                if (net_list[in].value != -1)
                 {
-                    foutput << net_list[input_list[i] - 1].value;
+                    continue;
                 }
-                else
+
+                if (easiest == -1 || net_list[in].input < net_list[easiest].input)
                 {
-                    // Print X for an unassigned input
-                    foutput << "X";
+                    easiest = in;
                 }
+                request(in, !c, uncontrolled, net_list);
+            }
+
+            if (easiest != -1)
+            {
+                request(easiest, c, controlled, net_list);
             }
-            foutput << std::endl;
         }
-        else
+
+        // Clear the scratch state
+        while (!queue.empty())
         {
-            // Print that the fault is undetectable
-            std::cout << "The fault " << target.net_id << " stuck at " << target.value << " is undetectable." << std::endl;
+            queue.pop();
+        }
+        for (int i = 0; i < touched.size(); ++i)
+        {
+            queued[touched[i]] = 0;
+            count0[touched[i]] = 0;
+            count1[touched[i]] = 0;
+        }
+        touched.clear();
 
-            // Write to the file
-            foutput << "Undetectable" << std::endl;
+        if (stem_net != -1)
+        {
+            return backtrace(stem_net + 1, stem_val, net_list, gate_list, &headline);
         }
 
-        // Clear all the variables related to the simulation
-        // Reset the value of all nets
-        for (int j = 0; j < net_list.size(); j++)
+        if (best == -1)
         {
-            net_list[j].value = -1;
-            net_list[j].isFault = 0;
+            return std::make_tuple(-1, -1);
         }
 
-        // Reset the values stored in the gate list
-        for (int j = 0; j < gate_list.size(); j++)
+        return std::make_tuple(best + 1, best_val);
+    }
+};
+
+// Run PODEM, or FAN when a FAN search is given, for one fault and clear the circuit afterwards
+// Returns the generated test with X for unassigned inputs, "Undetectable", or "Aborted" when the search
+// exceeds backtrack_limit backtracks (0 for no limit). The effort of the search is added to totals
+// PODEM uses the learned implications when given, a FAN search gets them on construction
+// PODEM is limited to the cone of the fault when a cone extractor is given
+// A variant other than 0 makes PODEM follow other decisions, and usually find another test
+std::string generateTest(Fault target, Circuit &circuit, std::ostream &log, int backtrack_limit, SearchStats &totals, FanSearch *fan = nullptr, LearnedImplications *learned = nullptr, FaultCone *cone = nullptr, unsigned variant = 0)
+{
+    INSTRUMENT_PHASE(PHASE_FAULT);
+    INSTRUMENT_COUNT(COUNTER_FAULTS, 1);
+
+    // References to the lists of the circuit
+    std::vector<Gate> &gate_list = circuit.gate_list;
+    std::vector<Net> &net_list = circuit.net_list;
+    std::vector<int> &input_list = circuit.input_list;
+    std::vector<int> &output_list = circuit.output_list;
+
+    SearchTrace::record(TRACE_FAULT_BEGIN, target.value, target.net_id, target.gate == -1 ? -1 : gate_list[target.gate].output_net.id);
+
+    std::string test;
+
+    // Call PODEM or FAN on the fault
+    SearchStats stats;
+    int status;
+
+    if (fan != nullptr)
+    {
+        fan->prepare(target, gate_list, net_list);
+        status = fan->search(target, net_list, output_list, gate_list, stats, backtrack_limit);
+
+        // The search stops at the headlines, assign the inputs behind them
+        if (status == 1)
         {
-            gate_list[j].input_nets[0].value = -1;
-            gate_list[j].input_nets[0].isFault = 0;
-            gate_list[j].output_net.value = -1;
-            gate_list[j].output_net.isFault = 0;
+            fan->justify(target, net_list, gate_list);
+        }
+    }
+    else
+    {
+        if (cone != nullptr)
+        {
+            cone->extract(target);
+        }
+        if (learned != nullptr)
+        {
+            learned->prepare(target, gate_list, net_list.size(), cone);
+        }
+        status = PODEM(target, net_list, output_list, gate_list, stats, backtrack_limit, learned, cone, variant);
+    }
+
+    totals.decisions += stats.decisions;
+    totals.backtracks += stats.backtracks;
+    INSTRUMENT_COUNT(COUNTER_DECISIONS, stats.decisions);
+    INSTRUMENT_COUNT(COUNTER_BACKTRACKS, stats.backtracks);
+    SearchTrace::record(TRACE_FAULT_END, status, target.net_id, stats.backtracks);
 
-            if (gate_list[j].input_nets.size() == 2)
+    // If the test generation is successful
+    if (status == 1)
+    {
+        // Store the value of the generated test(s)
+        for (int i = 0; i < input_list.size(); ++i)
+        {
+            if (net_list[input_list[i] - 1].value != -1)
             {
-                gate_list[j].input_nets[1].value = -1;
-                gate_list[j].input_nets[1].isFault = 0;
+                test += std::to_string(net_list[input_list[i] - 1].value);
+            }
+            else
+            {
+                // Print X for an unassigned input
+                test += "X";
             }
         }
     }
+    else if (status == -1)
+    {
+        log << "The search for the fault " << faultSite(target, gate_list) << " stuck at " << target.value << " was aborted after " << stats.backtracks << " backtracks." << std::endl;
 
-    // Close the files
-    ffault.close();
-    foutput.close();
+        test = "Aborted";
+    }
+    else
+    {
+        // Print that the fault is undetectable
+        log << "The fault " << faultSite(target, gate_list) << " stuck at " << target.value << " is undetectable." << std::endl;
 
-    return 0;
+        test = "Undetectable";
+    }
+
+    // Clear all the variables related to the simulation
+    // Reset the value of all nets, or of the nets of the cone which are the only ones PODEM assigns
+    bool in_cone = fan == nullptr && cone != nullptr;
+    int num_nets = in_cone ? cone->nets.size() : net_list.size();
+    for (int i = 0; i < num_nets; i++)
+    {
+        int j = in_cone ? cone->nets[i] : i;
+        net_list[j].value = -1;
+        net_list[j].faulty = -1;
+        net_list[j].isFault = 0;
+    }
+
+    return test;
+}
+
+// Upper bound on the number of random pattern batches, in case every batch keeps detecting a few faults
+const int MAX_RANDOM_BATCHES = 1024;
+
+// Pseudo random pattern source, a 64 bit maximal length Galois LFSR
+class Lfsr
+{
+
+public:
+    // Class constructor, a zero seed would lock the register and is replaced by 1
+    Lfsr(uint64_t seed)
+    {
+        state = seed != 0 ? seed : 1;
+    }
+
+    // Next 64 output bits of the register, one bit per shift
+    uint64_t next()
+    {
+        uint64_t word = 0;
+
+        for (int b = 0; b < 64; ++b)
+        {
+            uint64_t bit = state & 1;
+            state >>= 1;
+            if (bit)
+            {
+                state ^= 0xD800000000000000ULL;
+            }
+            word |= bit << b;
+        }
+
+        return word;
+    }
+
+private:
+    uint64_t state;
+};
+
+// Search used to generate the test of a fault
+enum SearchAlgorithm
+{
+    SEARCH_PODEM,
+    SEARCH_FAN
+};
+
+class ATPGJob
+{
+
+public:
+    // Paths of the files used by the job
+    std::string netlist;
+    std::string faults;
+    std::string outputs;
+
+    // Kind of fault collapsing applied to the fault list
+    CollapseMode collapse;
+
+    // Test generation search
+    SearchAlgorithm algorithm;
+
+    // Learn the indirect implications of the circuit before the search
+    bool learn;
+
+    // Prove faults untestable by structural analysis before any search
+    bool untestable;
+
+    // Fault simulate every generated test and drop the faults it detects from test generation
+    bool drop;
+
+    // Run random patterns before PODEM until a batch of 64 detects fewer new classes than this, 0 disables the phase
+    int random_min_gain;
+
+    // Seed of the random pattern generator
+    uint64_t seed;
+
+    // Backtracks after which PODEM gives up on a fault, 0 for no limit
+    int backtrack_limit;
+
+    // Pass the faults aborted by PODEM to the SAT engine, which gives up after sat_conflicts conflicts (0 for no limit)
+    bool sat;
+    long sat_conflicts;
+
+    // Tests wanted for every fault, faults are targeted again until n_detect different tests detect them
+    int n_detect;
+
+    // Checkpoint of the progress written every checkpoint_interval seconds, empty for none
+    std::string checkpoint;
+    double checkpoint_interval;
+
+    // Continue from the checkpoint of an interrupted run
+    bool resume;
+
+    // Default constructor
+    ATPGJob()
+    {
+        collapse = COLLAPSE_EQUIVALENCE;
+        algorithm = SEARCH_PODEM;
+        learn = false;
+        untestable = false;
+        drop = false;
+        random_min_gain = 0;
+        seed = 1;
+        backtrack_limit = 0;
+        sat = false;
+        sat_conflicts = 100000;
+        checkpoint_interval = 60;
+        resume = false;
+        n_detect = 1;
+    }
+};
+
+// Largest detection count of the N-detect mode, the counters are single bytes
+const int MAX_N_DETECT = 255;
+
+// Searches of a fault in the N-detect mode per wanted test, the later searches may repeat earlier tests
+const int N_DETECT_ATTEMPTS = 2;
+
+// Status of a fault class in a checkpoint, followed by the test for CLASS_TESTED
+enum ClassStatus
+{
+    CLASS_OPEN,
+    CLASS_TESTED,
+    CLASS_UNTESTABLE,
+    CLASS_ABORTED
+};
+
+// Identity of a job in its checkpoint, a checkpoint is only resumed by a job with the same faults and options
+uint64_t jobHash(const ATPGJob &job, const std::vector<Fault> &fault_list, int num_classes, int num_inputs)
+{
+    std::ostringstream ss;
+
+    ss << num_classes << " " << num_inputs << " " << job.collapse << " " << job.algorithm << " " << job.learn << " " << job.untestable << " " << job.drop << " "
+       << job.random_min_gain << " " << job.seed << " " << job.backtrack_limit << " " << job.sat << " " << job.sat_conflicts << " " << job.n_detect;
+
+    for (int i = 0; i < fault_list.size(); ++i)
+    {
+        ss << " " << fault_list[i].net_id << " " << fault_list[i].gate << " " << fault_list[i].value;
+    }
+
+    return fnv1a(ss.str());
+}
+
+// Generate tests for every fault of one job on a private copy of the circuit
+// The console report is written to log so that concurrent jobs do not interleave
+int runATPG(const ATPGJob &job, Circuit circuit, std::ostream &log)
+{
+    // References to the lists of the circuit
+    std::vector<Gate> &gate_list = circuit.gate_list;
+    std::vector<Net> &net_list = circuit.net_list;
+    std::vector<int> &input_list = circuit.input_list;
+    std::vector<int> &output_list = circuit.output_list;
+
+    // Test generation assumes full scan, the Q net of a flip-flop is controlled like an input and the D net observed
+    // like an output. The scan cells follow the primary inputs and outputs
+    for (int i = 0; i < circuit.dff_list.size(); ++i)
+    {
+        input_list.push_back(circuit.dff_list[i].second);
+        output_list.push_back(circuit.dff_list[i].first);
+    }
+
+    // Open the fault file of the job, the output file is opened once it is known whether the run resumes
+    std::ifstream ffault(job.faults);
+    std::ofstream foutput;
+
+    if (!ffault.is_open())
+    {
+        log << "Unable to open the fault list " << job.faults << std::endl;
+        return 1;
+    }
+
+    // String to store the lines read from the files
+    std::string line;
+
+    // Print some basic information about the circuit
+    log << "File Name: " << job.netlist << std::endl;
+    log << "The circuit has " << gate_list.size() << " gates." << std::endl;
+    log << "The circuit has " << net_list.size() << " nets." << std::endl;
+    log << "The circuit has " << input_list.size() << " inputs." << std::endl;
+    log << "The circuit has " << output_list.size() << " outputs." << std::endl;
+
+
+    // Create a list of faults to generate tests for
+    std::vector<Fault> fault_list;
+
+    // Numbering of the net and fanout branch fault sites
+    FaultSites sites(gate_list, net_list, output_list);
+
+    std::string fnet, fval;
+
+    // Parse the file containing the fault list
+    while (getline(ffault, line))
+    {
+        std::stringstream ss(line);
+        if (!(ss >> fnet >> fval))
+        {
+            continue;
+        }
+
+        Fault temp;
+        if (!parseFault(fnet, fval, gate_list, net_list, temp) || sites.siteOf(temp) == -1 || temp.model != FAULT_STUCK_AT)
+        {
+            log << "Invalid fault " << line << ", will be ignored" << std::endl;
+            continue;
+        }
+
+        // A pin without fanout carries the same fault as its net
+        if (sites.siteOf(temp) < sites.num_nets)
+        {
+            temp.gate = -1;
+        }
+
+        fault_list.push_back(temp);
+    }
+
+    // Collapse the fault list, PODEM runs once for every class
+    CollapsedFaults collapsed;
+    {
+        INSTRUMENT_PHASE(PHASE_COLLAPSE);
+        collapsed = job.collapse != COLLAPSE_NONE ? collapseFaults(gate_list, net_list, output_list, fault_list, job.collapse == COLLAPSE_DOMINANCE) : uncollapsedFaults(fault_list);
+    }
+
+    log << "Collapsed " << fault_list.size() << " faults into " << collapsed.faults.size() << " classes." << std::endl;
+
+    // Test generated for every class, empty until the class has been targeted
+    std::vector<std::string> class_tests(collapsed.faults.size());
+
+    // Parallel fault simulator used to drop the faults detected by the generated tests
+    CompiledCircuit compiled(gate_list, net_list, input_list, output_list);
+    ParallelFaultSimulator simulator(compiled, sites);
+    std::vector<int> pattern(input_list.size()), targets, detected;
+    int num_generated = 0, num_dropped = 0;
+
+    // Static learning, once for the circuit of the job
+    std::unique_ptr<LearnedImplications> learned;
+    if (job.learn)
+    {
+        INSTRUMENT_PHASE(PHASE_LEARN);
+        learned.reset(new LearnedImplications(compiled));
+        log << "Static learning found " << learned->graph.numImplications() << " implications and " << learned->graph.numConstants() << " constant lines." << std::endl;
+    }
+
+    // FAN classification of the lines, only built when FAN is selected
+    std::unique_ptr<FanSearch> fan;
+    if (job.algorithm == SEARCH_FAN)
+    {
+        fan.reset(new FanSearch(compiled, gate_list, net_list, output_list, learned != nullptr ? &learned->graph : nullptr));
+    }
+    const char *search_name = fan != nullptr ? "FAN" : "PODEM";
+
+    // Cone of the fault targeted by PODEM, extracted again for every fault
+    FaultCone cone(compiled);
+    SearchStats search_stats;
+
+    // Second stage for the faults aborted by the search
+    SatTestGenerator sat(compiled, sites);
+    int num_aborted = 0, num_sat_tests = 0, num_sat_untestable = 0;
+
+    // Generate a test with the search, falling back to SAT when the search is aborted
+    auto solve = [&](const Fault &fault, unsigned variant)
+    {
+        std::string test = generateTest(fault, circuit, log, job.backtrack_limit, search_stats, fan.get(), learned.get(), &cone, variant);
+
+        if (test != "Aborted")
+        {
+            return test;
+        }
+
+        num_aborted++;
+
+        if (job.sat)
+        {
+            INSTRUMENT_PHASE(PHASE_SAT);
+            SatStatus status = sat.generate(fault, job.sat_conflicts, test);
+
+            if (status == SAT_SATISFIABLE)
+            {
+                log << "SAT found a test after " << sat.lastConflicts() << " conflicts." << std::endl;
+                num_sat_tests++;
+            }
+            else if (status == SAT_UNSATISFIABLE)
+            {
+                log << "SAT proved the fault undetectable after " << sat.lastConflicts() << " conflicts." << std::endl;
+                test = "Undetectable";
+                num_sat_untestable++;
+            }
+            else
+            {
+                log << "SAT gave up after " << sat.lastConflicts() << " conflicts." << std::endl;
+            }
+        }
+
+        return test;
+    };
+
+    // N-detect state, the distinct tests found so far, the number of them detecting every class, which saturates at
+    // n_detect since only the classes below it are simulated, and the first n_detect tests detecting every class
+    std::vector<std::string> n_tests;
+    std::set<std::string> n_test_set;
+    std::vector<uint8_t> detections(collapsed.faults.size(), 0);
+    std::vector<std::vector<int>> detecting(collapsed.faults.size());
+
+    // Add a new test and fault simulate it against the classes still detected fewer than n_detect times
+    auto countTest = [&](const std::string &filled)
+    {
+        if (!n_test_set.insert(filled).second)
+        {
+            return;
+        }
+        n_tests.push_back(filled);
+
+        for (int k = 0; k < filled.size(); ++k)
+        {
+            pattern[k] = filled[k] - '0';
+        }
+
+        targets.clear();
+        for (int d = 0; d < class_tests.size(); ++d)
+        {
+            if (detections[d] < job.n_detect && class_tests[d] != "Undetectable")
+            {
+                targets.push_back(d);
+            }
+        }
+
+        INSTRUMENT_PHASE(PHASE_FAULT_SIM);
+        simulator.simulate(pattern, collapsed.faults, targets, detected);
+
+        for (int d : detected)
+        {
+            detections[d]++;
+            detecting[d].push_back(n_tests.size() - 1);
+        }
+    };
+
+    // Target a class with varied decisions until n_detect tests detect it or the attempts run out
+    // The first search is the one of the single detection mode and fills the unassigned inputs with 0, the others
+    // fill them at random, from a generator seeded by the class and the attempt so a resumed run fills them alike
+    auto retarget = [&](int c)
+    {
+        for (int attempt = 0; detections[c] < job.n_detect && attempt < N_DETECT_ATTEMPTS * job.n_detect; ++attempt)
+        {
+            std::string generated = solve(collapsed.faults[c], attempt);
+            num_generated++;
+
+            if (generated == "Undetectable" || generated == "Aborted")
+            {
+                if (detections[c] == 0)
+                {
+                    class_tests[c] = generated;
+                }
+                return;
+            }
+
+            Lfsr fill(job.seed ^ (0x9E3779B97F4A7C15ULL * ((uint64_t)c * N_DETECT_ATTEMPTS * MAX_N_DETECT + attempt + 1)));
+            uint64_t bits = 0;
+
+            for (int k = 0; k < generated.size(); ++k)
+            {
+                if (k % 64 == 0)
+                {
+                    bits = fill.next();
+                }
+                if (generated[k] == 'X')
+                {
+                    generated[k] = attempt == 0 ? '0' : '0' + ((bits >> (k % 64)) & 1);
+                }
+            }
+
+            countTest(generated);
+        }
+    };
+
+    // Progress of an interrupted run, the faults before next_fault have been handled and, unless in the N-detect mode,
+    // written to the output file
+    uint64_t job_hash = jobHash(job, fault_list, collapsed.faults.size(), input_list.size());
+    int next_fault = 0;
+
+    if (job.resume)
+    {
+        std::string payload, error;
+
+        if (readCheckpoint(job.checkpoint, payload, error))
+        {
+            CheckpointDecoder decoder(payload);
+
+            uint64_t saved_hash = decoder.getU64();
+            next_fault = decoder.getU32();
+            uint64_t output_bytes = decoder.getU64();
+            num_generated = decoder.getU32();
+            num_dropped = decoder.getU32();
+            num_aborted = decoder.getU32();
+            num_sat_tests = decoder.getU32();
+            num_sat_untestable = decoder.getU32();
+            search_stats.decisions = decoder.getU64();
+            search_stats.backtracks = decoder.getU64();
+
+            for (int c = 0; c < class_tests.size(); ++c)
+            {
+                int status = decoder.getU8();
+                class_tests[c] = status == CLASS_TESTED ? decoder.getString() : status == CLASS_UNTESTABLE ? "Undetectable" : status == CLASS_ABORTED ? "Aborted" : "";
+            }
+
+            // N-detect state, the tests and the detecting tests of every class
+            if (job.n_detect > 1)
+            {
+                n_tests.resize(decoder.getU32());
+                for (int t = 0; t < n_tests.size() && !decoder.failed; ++t)
+                {
+                    n_tests[t] = decoder.getString();
+                }
+                n_test_set.insert(n_tests.begin(), n_tests.end());
+
+                for (int c = 0; c < detections.size() && !decoder.failed; ++c)
+                {
+                    detections[c] = decoder.getU8();
+                    detecting[c].resize(detections[c]);
+                    for (int k = 0; k < detecting[c].size(); ++k)
+                    {
+                        detecting[c][k] = decoder.getU32();
+                    }
+                }
+            }
+
+            if (decoder.failed || !decoder.atEnd() || saved_hash != job_hash || next_fault > fault_list.size())
+            {
+                log << "The checkpoint " << job.checkpoint << " does not belong to this job" << std::endl;
+                return 1;
+            }
+
+            // Drop the lines written after the checkpoint, they are generated again
+            struct stat output_stat;
+            if (stat(job.outputs.c_str(), &output_stat) != 0 || output_stat.st_size < output_bytes || truncate(job.outputs.c_str(), output_bytes) != 0)
+            {
+                log << "Unable to resume the output file " << job.outputs << " at byte " << output_bytes << std::endl;
+                return 1;
+            }
+
+            foutput.open(job.outputs, std::ios::app);
+            log << "Resumed from " << job.checkpoint << " at fault " << next_fault << " of " << fault_list.size() << "." << std::endl;
+        }
+        else if (!error.empty())
+        {
+            log << "Unable to resume: " << error << std::endl;
+            return 1;
+        }
+        else
+        {
+            log << "No checkpoint " << job.checkpoint << ", starting from the first fault." << std::endl;
+        }
+    }
+
+    bool resumed = foutput.is_open();
+    if (!resumed)
+    {
+        foutput.open(job.outputs);
+    }
+
+    // Checkpoints are written by a background thread, the loop only builds their payload
+    std::unique_ptr<CheckpointWriter> checkpoint;
+    if (!job.checkpoint.empty())
+    {
+        checkpoint.reset(new CheckpointWriter(job.checkpoint));
+    }
+    auto last_checkpoint = std::chrono::steady_clock::now();
+
+    // Payload of a checkpoint taken before fault next of the fault list
+    auto snapshot = [&](int next)
+    {
+        CheckpointEncoder encoder;
+
+        encoder.putU64(job_hash);
+        encoder.putU32(next);
+        encoder.putU64(foutput.tellp());
+        encoder.putU32(num_generated);
+        encoder.putU32(num_dropped);
+        encoder.putU32(num_aborted);
+        encoder.putU32(num_sat_tests);
+        encoder.putU32(num_sat_untestable);
+        encoder.putU64(search_stats.decisions);
+        encoder.putU64(search_stats.backtracks);
+
+        for (int c = 0; c < class_tests.size(); ++c)
+        {
+            const std::string &test = class_tests[c];
+
+            if (test.empty() || test == "Undetectable" || test == "Aborted")
+            {
+                encoder.putU8(test.empty() ? CLASS_OPEN : test == "Undetectable" ? CLASS_UNTESTABLE : CLASS_ABORTED);
+            }
+            else
+            {
+                encoder.putU8(CLASS_TESTED);
+                encoder.putString(test);
+            }
+        }
+
+        if (job.n_detect > 1)
+        {
+            encoder.putU32(n_tests.size());
+            for (int t = 0; t < n_tests.size(); ++t)
+            {
+                encoder.putString(n_tests[t]);
+            }
+
+            for (int c = 0; c < detections.size(); ++c)
+            {
+                encoder.putU8(detections[c]);
+                for (int k = 0; k < detecting[c].size(); ++k)
+                {
+                    encoder.putU32(detecting[c][k]);
+                }
+            }
+        }
+
+        return encoder.data;
+    };
+
+    // Structural untestability analysis, the classes proven untestable are never targeted
+    // A resumed run restored the outcome of this and of the random phase with the classes
+    if (job.untestable && !resumed)
+    {
+        INSTRUMENT_PHASE(PHASE_UNTESTABLE);
+        UntestableFaultFinder finder(compiled, sites);
+        std::vector<char> proven = finder.find(collapsed.faults);
+
+        for (int c = 0; c < proven.size(); ++c)
+        {
+            if (proven[c])
+            {
+                class_tests[c] = "Undetectable";
+            }
+        }
+
+        log << "Structural analysis proved " << finder.num_unobservable + finder.num_conflicting + finder.num_stem << " classes untestable (" << finder.num_unobservable << " unobservable, " << finder.num_conflicting << " conflicting requirements, " << finder.num_stem << " by stem analysis)." << std::endl;
+    }
+
+    // Random pattern phase, the classes detected by a pseudo random pattern are not passed to PODEM
+    if (job.random_min_gain > 0 && !resumed)
+    {
+        INSTRUMENT_PHASE(PHASE_FAULT_SIM);
+        PatternParallelFaultSimulator random_simulator(compiled, sites);
+        Lfsr lfsr(job.seed);
+        std::vector<uint64_t> words(input_list.size());
+
+        std::vector<int> remaining, undetected;
+        for (int c = 0; c < collapsed.faults.size(); ++c)
+        {
+            if (class_tests[c].empty())
+            {
+                remaining.push_back(c);
+            }
+        }
+
+        int num_batches = 0, num_random = 0;
+
+        while (!remaining.empty() && num_batches < MAX_RANDOM_BATCHES)
+        {
+            for (int k = 0; k < words.size(); ++k)
+            {
+                words[k] = lfsr.next();
+            }
+
+            random_simulator.simulateGood(words);
+            num_batches++;
+            INSTRUMENT_COUNT(COUNTER_PATTERNS, 64);
+
+            // Give every detected class the first pattern of the batch detecting it
+            int gain = 0;
+            undetected.clear();
+
+            for (int c : remaining)
+            {
+                uint64_t patterns = random_simulator.detect(collapsed.faults[c], ~0ULL);
+
+                if (patterns == 0)
+                {
+                    undetected.push_back(c);
+                    continue;
+                }
+
+                int p = __builtin_ctzll(patterns);
+                std::string test(input_list.size(), '0');
+                for (int k = 0; k < words.size(); ++k)
+                {
+                    test[k] += (words[k] >> p) & 1;
+                }
+
+                class_tests[c] = test;
+                gain++;
+            }
+
+            remaining.swap(undetected);
+            num_random += gain;
+
+            if (gain < job.random_min_gain)
+            {
+                break;
+            }
+        }
+
+        log << "Random patterns: " << num_batches << " batches of 64 detected " << num_random << " classes, " << remaining.size() << " left for PODEM." << std::endl;
+    }
+
+    // In the N-detect mode the tests of the random phase are counted like the generated ones
+    if (job.n_detect > 1 && !resumed)
+    {
+        for (int c = 0; c < class_tests.size(); ++c)
+        {
+            if (!class_tests[c].empty() && class_tests[c] != "Undetectable")
+            {
+                countTest(class_tests[c]);
+            }
+        }
+    }
+
+    // Write the line of fault i of the fault list
+    auto writeLine = [&](int i, std::string test)
+    {
+        // A dominated fault can be testable even when the fault covering it is not
+        if (test == "Undetectable" && collapsed.dominated[i])
+        {
+            test = solve(fault_list[i], 0);
+        }
+
+        INSTRUMENT_PHASE(PHASE_WRITE);
+        foutput << test << std::endl;
+    };
+
+    // For all faults in the fault list
+    for (int i = next_fault; i < fault_list.size(); ++i)
+    {
+        int c = collapsed.class_of[i];
+
+        // Target the class again until n_detect tests detect it, the lines are written once every class is done
+        if (job.n_detect > 1)
+        {
+            if (detections[c] < job.n_detect && class_tests[c] != "Undetectable" && class_tests[c] != "Aborted")
+            {
+                retarget(c);
+            }
+        }
+        // Call PODEM on the representative of the class
+        else if (class_tests[c].empty())
+        {
+            class_tests[c] = solve(collapsed.faults[c], 0);
+            num_generated++;
+
+            if (job.drop && class_tests[c] != "Undetectable" && class_tests[c] != "Aborted")
+            {
+                // Fill the unassigned inputs with 0 and simulate the test against the classes not targeted yet
+                std::string filled = class_tests[c];
+                for (int k = 0; k < filled.size(); ++k)
+                {
+                    if (filled[k] == 'X')
+                    {
+                        filled[k] = '0';
+                    }
+                    pattern[k] = filled[k] - '0';
+                }
+
+                targets.clear();
+                for (int d = 0; d < class_tests.size(); ++d)
+                {
+                    if (class_tests[d].empty())
+                    {
+                        targets.push_back(d);
+                    }
+                }
+
+                INSTRUMENT_PHASE(PHASE_FAULT_SIM);
+                simulator.simulate(pattern, collapsed.faults, targets, detected);
+
+                for (int d : detected)
+                {
+                    class_tests[d] = filled;
+                    num_dropped++;
+                }
+            }
+        }
+
+        if (job.n_detect == 1)
+        {
+            writeLine(i, class_tests[c]);
+        }
+
+        if (checkpoint != nullptr && std::chrono::steady_clock::now() - last_checkpoint >= std::chrono::duration<double>(job.checkpoint_interval))
+        {
+            checkpoint->submit(snapshot(i + 1));
+            last_checkpoint = std::chrono::steady_clock::now();
+        }
+    }
+
+    // An N-detect line lists the tests detecting the fault, including the ones generated for the classes after it,
+    // so the file is written again from the start once the last class is done
+    if (job.n_detect > 1)
+    {
+        foutput.close();
+        foutput.open(job.outputs);
+
+        for (int i = 0; i < fault_list.size(); ++i)
+        {
+            int c = collapsed.class_of[i];
+            std::string test;
+
+            for (int k = 0; k < detecting[c].size(); ++k)
+            {
+                test += (k > 0 ? " " : "") + n_tests[detecting[c][k]];
+            }
+
+            writeLine(i, test.empty() ? class_tests[c] : test);
+        }
+    }
+
+    // The final checkpoint records a finished run, resuming it only repeats the summary
+    if (checkpoint != nullptr)
+    {
+        checkpoint->submit(snapshot(fault_list.size()));
+        if (!checkpoint->flush())
+        {
+            log << "Unable to write the checkpoint " << job.checkpoint << std::endl;
+        }
+    }
+
+    if (job.drop && job.n_detect == 1)
+    {
+        log << "Generated " << num_generated << " tests with " << search_name << ", " << num_dropped << " classes detected by fault simulation." << std::endl;
+    }
+
+    if (job.n_detect > 1)
+    {
+        int num_complete = std::count(detections.begin(), detections.end(), job.n_detect);
+        log << "N-detect: " << num_generated << " searches with " << search_name << " found " << n_tests.size() << " different tests, " << num_complete << " of " << detections.size() << " classes detected " << job.n_detect << " times." << std::endl;
+    }
+
+    log << search_name << " made " << search_stats.decisions << " decisions and " << search_stats.backtracks << " backtracks." << std::endl;
+
+    if (num_aborted > 0)
+    {
+        log << search_name << " aborted " << num_aborted << " faults";
+        if (job.sat)
+        {
+            log << ", SAT generated " << num_sat_tests << " tests and proved " << num_sat_untestable << " faults undetectable";
+        }
+        log << "." << std::endl;
+    }
+
+    // Close the files
+    ffault.close();
+    foutput.close();
+
+    return 0;
+}
+
+void printUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " [options] <netlist>" << std::endl;
+    std::cout << "       " << program << " [options] --batch <manifest>" << std::endl;
+    std::cout << "       " << program << " [options] --serve <socket>" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -f, --faults <file>    faults to generate tests for (default f_<netlist>)" << std::endl;
+    std::cout << "  -o, --outputs <file>   generated tests (default o_<netlist>)" << std::endl;
+    std::cout << "  -c, --collapse <mode>  fault collapsing: none, equiv or dominance (default equiv)" << std::endl;
+    std::cout << "  -a, --algorithm <name> test generation search: podem or fan (default podem)" << std::endl;
+    std::cout << "  -l, --learn            learn indirect implications of the circuit and use them in the search" << std::endl;
+    std::cout << "  -u, --untestable       prove faults untestable by structural analysis before the search" << std::endl;
+    std::cout << "  -r, --random <n>       run batches of 64 random patterns before PODEM until a batch detects fewer than n new faults" << std::endl;
+    std::cout << "  --seed <n>             seed of the random pattern generator (default 1)" << std::endl;
+    std::cout << "  -x, --drop             fault simulate every test and skip the faults it detects" << std::endl;
+    std::cout << "  -B, --backtracks <n>   abort the search for a fault after n backtracks (default 0, no limit)" << std::endl;
+    std::cout << "  -s, --sat              generate the tests of the aborted faults with the SAT engine" << std::endl;
+    std::cout << "  --conflicts <n>        conflicts after which the SAT engine gives up (default 100000, 0 for no limit)" << std::endl;
+    std::cout << "  --n-detect <n>         target every fault until n different tests detect it, the tests fault simulated (default 1)" << std::endl;
+    std::cout << "  --checkpoint <file>    save the progress of the run to file while it runs" << std::endl;
+    std::cout << "  --checkpoint-interval <s> seconds between two checkpoints (default 60)" << std::endl;
+    std::cout << "  --resume               continue from the checkpoint (default k_<netlist>) of an interrupted run" << std::endl;
+    std::cout << "  -j, --threads <n>      worker threads used to run batch jobs (default 1)" << std::endl;
+    std::cout << "  -b, --batch <file>     run every job listed in the manifest, one job per line" << std::endl;
+    std::cout << "  --serve <socket>       run jobs sent to a Unix socket until a shutdown request" << std::endl;
+    std::cout << "  --stats <file>         write the counters and phase times of the run as JSON (build with -DATPG_INSTRUMENT)" << std::endl;
+    std::cout << "  --trace <file>         record the searches in per thread ring buffers and write them as a binary trace" << std::endl;
+    std::cout << "  --trace-level <n>      1: faults, 2: decisions and backtracks, 3: objectives and implications (default 2)" << std::endl;
+    std::cout << "  -h, --help             print this message" << std::endl;
+}
+
+// Parse command line style arguments into a job
+// The batch manifest, server socket, thread count, statistics report and search trace are only accepted on the real
+// command line
+bool parseArguments(const std::vector<std::string> &args, ATPGJob &job, std::string *batch, int *threads, std::string *stats, std::string *trace, std::string *serve)
+{
+    for (int i = 0; i < args.size(); ++i)
+    {
+        std::string arg = args[i];
+
+        // Options without a value
+        if (arg == "-h" || arg == "--help")
+        {
+            return false;
+        }
+
+        if (arg == "-x" || arg == "--drop")
+        {
+            job.drop = true;
+            continue;
+        }
+
+        if (arg == "-s" || arg == "--sat")
+        {
+            job.sat = true;
+            continue;
+        }
+
+        if (arg == "--resume")
+        {
+            job.resume = true;
+            continue;
+        }
+
+        if (arg == "-l" || arg == "--learn")
+        {
+            job.learn = true;
+            continue;
+        }
+
+        if (arg == "-u" || arg == "--untestable")
+        {
+            job.untestable = true;
+            continue;
+        }
+
+        // Positional argument, the netlist
+        if (arg.empty() || arg[0] != '-')
+        {
+            job.netlist = arg;
+            continue;
+        }
+
+        // All the other options take a value
+        if (i + 1 >= args.size())
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+
+        std::string value = args[++i];
+
+        if (arg == "-f" || arg == "--faults")
+        {
+            job.faults = value;
+        }
+        else if (arg == "-o" || arg == "--outputs")
+        {
+            job.outputs = value;
+        }
+        else if (arg == "-c" || arg == "--collapse")
+        {
+            if (value == "none")
+            {
+                job.collapse = COLLAPSE_NONE;
+            }
+            else if (value == "equiv")
+            {
+                job.collapse = COLLAPSE_EQUIVALENCE;
+            }
+            else if (value == "dominance")
+            {
+                job.collapse = COLLAPSE_DOMINANCE;
+            }
+            else
+            {
+                std::cerr << "Invalid collapsing mode " << value << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "-a" || arg == "--algorithm")
+        {
+            if (value == "podem")
+            {
+                job.algorithm = SEARCH_PODEM;
+            }
+            else if (value == "fan")
+            {
+                job.algorithm = SEARCH_FAN;
+            }
+            else
+            {
+                std::cerr << "Invalid search algorithm " << value << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "-r" || arg == "--random")
+        {
+            job.random_min_gain = std::atoi(value.c_str());
+            if (job.random_min_gain < 0)
+            {
+                std::cerr << "Invalid random pattern gain " << value << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--seed")
+        {
+            job.seed = std::strtoull(value.c_str(), nullptr, 10);
+        }
+        else if (arg == "-B" || arg == "--backtracks")
+        {
+            job.backtrack_limit = std::atoi(value.c_str());
+            if (job.backtrack_limit < 0)
+            {
+                std::cerr << "Invalid backtrack limit " << value << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--n-detect")
+        {
+            job.n_detect = std::atoi(value.c_str());
+            if (job.n_detect < 1 || job.n_detect > MAX_N_DETECT)
+            {
+                std::cerr << "Invalid detection count " << value << ", it has to be between 1 and " << MAX_N_DETECT << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--checkpoint")
+        {
+            job.checkpoint = value;
+        }
+        else if (arg == "--checkpoint-interval")
+        {
+            job.checkpoint_interval = std::atof(value.c_str());
+            if (job.checkpoint_interval < 0)
+            {
+                std::cerr << "Invalid checkpoint interval " << value << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--conflicts")
+        {
+            job.sat_conflicts = std::atol(value.c_str());
+            if (job.sat_conflicts < 0)
+            {
+                std::cerr << "Invalid conflict limit " << value << std::endl;
+                return false;
+            }
+        }
+        else if ((arg == "-j" || arg == "--threads") && threads != nullptr)
+        {
+            *threads = std::atoi(value.c_str());
+            if (*threads < 1)
+            {
+                std::cerr << "Invalid thread count " << value << std::endl;
+                return false;
+            }
+        }
+        else if ((arg == "-b" || arg == "--batch") && batch != nullptr)
+        {
+            *batch = value;
+        }
+        else if (arg == "--stats" && stats != nullptr)
+        {
+            *stats = value;
+        }
+        else if (arg == "--serve" && serve != nullptr)
+        {
+            *serve = value;
+        }
+        else if (arg == "--trace" && trace != nullptr)
+        {
+            *trace = value;
+        }
+        else if (arg == "--trace-level" && trace != nullptr)
+        {
+            int level = std::atoi(value.c_str());
+            if (level < 0 || level > 3)
+            {
+                std::cerr << "Invalid trace level " << value << std::endl;
+                return false;
+            }
+            SearchTrace::level() = level;
+        }
+        else
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Fill in the default paths of the files which were not given explicitly
+void completeJob(ATPGJob &job)
+{
+    if (job.faults.empty())
+    {
+        job.faults = companionPath(job.netlist, "f_");
+    }
+    if (job.outputs.empty())
+    {
+        job.outputs = companionPath(job.netlist, "o_");
+    }
+    if (job.resume && job.checkpoint.empty())
+    {
+        job.checkpoint = companionPath(job.netlist, "k_");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // Options given on the command line
+    ATPGJob defaults;
+    std::string batch, stats, trace, serve;
+    int threads = 1;
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    // Decisions and backtracks are traced by default, nothing is recorded without a trace file
+    SearchTrace::level() = 2;
+
+    if (args.empty() || !parseArguments(args, defaults, &batch, &threads, &stats, &trace, &serve))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (trace.empty())
+    {
+        SearchTrace::level() = 0;
+    }
+
+    // Netlists are parsed once and shared by all the jobs using them
+    NetlistCache cache;
+
+    // Server mode, the options of the command line act as defaults of every job sent to the socket
+    if (!serve.empty())
+    {
+        JobServer server(serve, threads, [&defaults, &cache](const std::vector<std::string> &job_args, const std::string &cwd, int, std::ostream &log)
+                         {
+            INSTRUMENT_PHASE(PHASE_JOB);
+            ATPGJob job = defaults;
+
+            if (!parseArguments(job_args, job, nullptr, nullptr, nullptr, nullptr, nullptr) || job.netlist.empty())
+            {
+                log << "Invalid job, the request takes the arguments of a batch manifest line" << std::endl;
+                return 1;
+            }
+
+            job.netlist = resolvePath(cwd, job.netlist);
+            job.faults = resolvePath(cwd, job.faults);
+            job.outputs = resolvePath(cwd, job.outputs);
+            job.checkpoint = resolvePath(cwd, job.checkpoint);
+            completeJob(job);
+
+            std::shared_ptr<const Circuit> circuit = cache.get(job.netlist);
+            if (circuit == nullptr)
+            {
+                log << "Unable to read the netlist " << job.netlist << std::endl;
+                return 1;
+            }
+
+            return runATPG(job, *circuit, log); });
+
+        std::string error;
+        if (!server.listen(error))
+        {
+            std::cerr << "Unable to serve on " << serve << ": " << error << std::endl;
+            return 1;
+        }
+
+        std::cout << "Serving jobs on " << serve << " with " << threads << " threads." << std::endl;
+        server.serve();
+
+        if (!stats.empty() && !Instrumentation::writeReport(stats, "part3"))
+        {
+            std::cerr << "Unable to write the statistics report " << stats << std::endl;
+            return 1;
+        }
+
+        if (!trace.empty() && !SearchTrace::write(trace))
+        {
+            std::cerr << "Unable to write the search trace " << trace << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    // Create the list of jobs to run
+    std::vector<ATPGJob> jobs;
+
+    if (!batch.empty())
+    {
+        bool read = readManifest(batch, defaults, jobs, [](const std::vector<std::string> &args, ATPGJob &job) {
+            if (!parseArguments(args, job, nullptr, nullptr, nullptr, nullptr, nullptr) || job.netlist.empty())
+            {
+                return false;
+            }
+
+            completeJob(job);
+            return true; });
+
+        if (!read)
+        {
+            return 1;
+        }
+    }
+    else if (!defaults.netlist.empty())
+    {
+        completeJob(defaults);
+        jobs.push_back(defaults);
+    }
+    else
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    ThreadPool pool(std::min(threads, (int)jobs.size()));
+
+    // Serialise the console output of the jobs
+    std::mutex console;
+    int failures = 0;
+
+    for (int i = 0; i < jobs.size(); ++i)
+    {
+        const ATPGJob &job = jobs[i];
+
+        pool.submit([&job, &cache, &console, &failures]()
+                    {
+            INSTRUMENT_PHASE(PHASE_JOB);
+            std::ostringstream log;
+            int status = 1;
+
+            std::shared_ptr<const Circuit> circuit = cache.get(job.netlist);
+            if (circuit != nullptr)
+            {
+                status = runATPG(job, *circuit, log);
+            }
+
+            std::lock_guard<std::mutex> lock(console);
+            std::cout << log.str();
+            if (status != 0)
+            {
+                failures++;
+            } });
+    }
+
+    pool.wait();
+
+    // Report of the counters and phase timers of the run
+    if (!stats.empty() && !Instrumentation::writeReport(stats, "part3"))
+    {
+        std::cerr << "Unable to write the statistics report " << stats << std::endl;
+        return 1;
+    }
+
+    // Rings of the search trace, decoded offline
+    if (!trace.empty() && !SearchTrace::write(trace))
+    {
+        std::cerr << "Unable to write the search trace " << trace << std::endl;
+        return 1;
+    }
+
+    return failures == 0 ? 0 : 1;
 }
\ No newline at end of file
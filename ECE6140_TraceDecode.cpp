@@ -0,0 +1,227 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+
+#include "SearchTrace.h"
+
+// Records of one thread of a trace file
+class ThreadTrace
+{
+
+public:
+    // Records written by the thread, more than the kept ones when the ring wrapped
+    uint64_t written;
+    std::vector<TraceRecord> records;
+
+    ThreadTrace()
+    {
+        written = 0;
+    }
+};
+
+// Read a trace written by part3 --trace, returns false if the file is not a valid trace
+bool readTrace(const std::string &filename, std::vector<ThreadTrace> &threads)
+{
+    std::ifstream fin(filename, std::ios::binary);
+
+    if (!fin.is_open())
+    {
+        std::cerr << "Unable to open the trace " << filename << std::endl;
+        return false;
+    }
+
+    char magic[sizeof(TRACE_MAGIC)];
+    uint32_t record_size = 0, num_threads = 0;
+
+    fin.read(magic, sizeof(magic));
+    fin.read((char *)&record_size, sizeof(record_size));
+    fin.read((char *)&num_threads, sizeof(num_threads));
+
+    if (!fin || std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0 || record_size != sizeof(TraceRecord))
+    {
+        std::cerr << filename << " is not a search trace of this version" << std::endl;
+        return false;
+    }
+
+    threads.resize(num_threads);
+
+    for (int t = 0; t < num_threads; ++t)
+    {
+        uint32_t kept = 0;
+
+        fin.read((char *)&threads[t].written, sizeof(threads[t].written));
+        fin.read((char *)&kept, sizeof(kept));
+
+        if (!fin || kept > TRACE_RING_SIZE)
+        {
+            std::cerr << "The trace " << filename << " is truncated" << std::endl;
+            return false;
+        }
+
+        threads[t].records.resize(kept);
+        fin.read((char *)threads[t].records.data(), (std::streamsize)kept * sizeof(TraceRecord));
+
+        if (!fin)
+        {
+            std::cerr << "The trace " << filename << " is truncated" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Text of one record
+std::string describe(const TraceRecord &r)
+{
+    std::string net = std::to_string(r.net);
+    std::string value = r.value == -1 ? "X" : std::to_string(r.value);
+
+    switch (r.kind)
+    {
+    case TRACE_FAULT_BEGIN:
+        return "Fault " + net + (r.aux != -1 ? ">" + std::to_string(r.aux) : "") + " stuck at " + value;
+    case TRACE_FAULT_END:
+        return std::string(r.value == 1 ? "Test found" : r.value == 0 ? "Undetectable" : "Aborted") + " after " + std::to_string(r.aux) + " backtracks";
+    case TRACE_DECISION:
+        return "Decision " + net + " = " + value;
+    case TRACE_BACKTRACK:
+        return "Backtrack " + net + " = " + value;
+    case TRACE_RESET:
+        return "Reset " + net + " = X";
+    case TRACE_OBJECTIVE:
+        return "Objective " + net + " = " + value;
+    case TRACE_PROPAGATED:
+        return "Fault propagated to output net " + net;
+    case TRACE_IMPLICATION:
+        return "Implication " + net + " = " + value + ", " + std::to_string(r.aux) + " gates evaluated";
+    default:
+        return "Unknown record " + std::to_string(r.kind);
+    }
+}
+
+void printUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " [options] <trace>" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -t, --thread <n>       only print the records of thread n" << std::endl;
+    std::cout << "  -f, --fault <n>        only print the records of the nth fault of a thread" << std::endl;
+    std::cout << "  -l, --level <n>        only print the records of verbosity up to n" << std::endl;
+    std::cout << "  -s, --summary          only print the number of records, faults and backtracks per thread" << std::endl;
+    std::cout << "  -h, --help             print this message" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string filename;
+    int thread = -1, fault = -1, level = 3;
+    bool summary = false;
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        std::string arg = args[i];
+
+        if (arg == "-h" || arg == "--help")
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        if (arg == "-s" || arg == "--summary")
+        {
+            summary = true;
+            continue;
+        }
+
+        if (arg.empty() || arg[0] != '-')
+        {
+            filename = arg;
+            continue;
+        }
+
+        if (i + 1 >= args.size())
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 1;
+        }
+
+        std::string value = args[++i];
+
+        if (arg == "-t" || arg == "--thread")
+        {
+            thread = std::atoi(value.c_str());
+        }
+        else if (arg == "-f" || arg == "--fault")
+        {
+            fault = std::atoi(value.c_str());
+        }
+        else if (arg == "-l" || arg == "--level")
+        {
+            level = std::atoi(value.c_str());
+        }
+        else
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (filename.empty())
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<ThreadTrace> threads;
+    if (!readTrace(filename, threads))
+    {
+        return 1;
+    }
+
+    for (int t = 0; t < threads.size(); ++t)
+    {
+        if (thread != -1 && t != thread)
+        {
+            continue;
+        }
+
+        const std::vector<TraceRecord> &records = threads[t].records;
+
+        std::cout << "Thread " << t << ": " << threads[t].written << " records, " << threads[t].written - records.size() << " overwritten." << std::endl;
+
+        if (summary)
+        {
+            long num_faults = 0, num_tests = 0, num_backtracks = 0;
+            for (int i = 0; i < records.size(); ++i)
+            {
+                num_faults += records[i].kind == TRACE_FAULT_END;
+                num_tests += records[i].kind == TRACE_FAULT_END && records[i].value == 1;
+                num_backtracks += records[i].kind == TRACE_FAULT_END ? records[i].aux : 0;
+            }
+
+            std::cout << "  " << num_faults << " faults searched, " << num_tests << " tests found, " << num_backtracks << " backtracks." << std::endl;
+            continue;
+        }
+
+        for (int i = 0; i < records.size(); ++i)
+        {
+            const TraceRecord &r = records[i];
+
+            if ((fault != -1 && r.fault != fault) || r.kind >= NUM_TRACE_KINDS || TRACE_LEVELS[r.kind] > level)
+            {
+                continue;
+            }
+
+            // Records of a search are indented below the fault
+            std::cout << "[" << t << ":" << r.fault << "] " << (TRACE_LEVELS[r.kind] > 1 ? "  " : "") << describe(r) << std::endl;
+        }
+    }
+
+    return 0;
+}
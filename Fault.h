@@ -0,0 +1,257 @@
+#ifndef FAULT_H
+#define FAULT_H
+
+#include <tuple>
+#include <string>
+#include <vector>
+
+// Fault models
+enum FaultModel
+{
+    // The line is stuck at value
+    FAULT_STUCK_AT,
+
+    // The line is slow to rise (value 0) or slow to fall (value 1), it keeps its old value for one pattern
+    FAULT_TRANSITION
+};
+
+class Fault
+{
+public:
+    int net_id;
+    int value;
+
+    // Gate whose input pin carries the fault, -1 for a fault on the whole net (the stem)
+    int gate;
+
+    FaultModel model;
+
+    Fault(int _net_id, int _value, int _gate = -1, FaultModel _model = FAULT_STUCK_AT)
+    {
+        net_id = _net_id;
+        value = _value;
+        gate = _gate;
+        model = _model;
+    }
+
+    Fault()
+    {
+        net_id = -1;
+        value = -1;
+        gate = -1;
+        model = FAULT_STUCK_AT;
+    }
+
+    bool operator<(const Fault &struct2) const
+    {
+        return std::tie(net_id, value, gate, model) < std::tie(struct2.net_id, struct2.value, struct2.gate, struct2.model);
+    }
+
+    bool operator==(const Fault &struct2) const
+    {
+        return std::tie(net_id, value, gate, model) == std::tie(struct2.net_id, struct2.value, struct2.gate, struct2.model);
+    }
+};
+
+// Dense numbering of the fault sites of a circuit
+// Sites 0 to num_nets - 1 are the nets (net id - 1), they are followed by one site for every gate input pin
+// driven by a fanout stem, ie. a net which feeds more than one gate input or also is a primary output
+// Fault (site, v) has the index 2 * site + v
+class FaultSites
+{
+
+public:
+    int num_nets;
+    int num_sites;
+
+    // Site of input pin k of gate j is branch_site[2 * j + k], -1 if the pin is not a fanout branch
+    // A gate reading the same net on both pins has a single site shared by both
+    std::vector<int> branch_site;
+
+    // Net and gate of every branch site, indexed by site - num_nets
+    std::vector<int> branch_net;
+    std::vector<int> branch_gate;
+
+    FaultSites()
+    {
+        num_nets = 0;
+        num_sites = 0;
+    }
+
+    template <class GateT, class NetT>
+    FaultSites(const std::vector<GateT> &gate_list, const std::vector<NetT> &net_list, const std::vector<int> &output_list)
+    {
+        num_nets = net_list.size();
+        num_sites = num_nets;
+
+        // Count the gate inputs and primary outputs fed by every net
+        std::vector<int> fanout(num_nets, 0);
+        for (int i = 0; i < num_nets; ++i)
+        {
+            fanout[i] = net_list[i].gates_into.size();
+        }
+        for (int i = 0; i < output_list.size(); ++i)
+        {
+            fanout[output_list[i] - 1]++;
+        }
+
+        branch_site.assign(2 * gate_list.size(), -1);
+
+        for (int j = 0; j < gate_list.size(); ++j)
+        {
+            for (int k = 0; k < gate_list[j].input_nets.size(); ++k)
+            {
+                int net = gate_list[j].input_nets[k].id;
+
+                if (k == 1 && gate_list[j].input_nets[0].id == net)
+                {
+                    branch_site[2 * j + 1] = branch_site[2 * j];
+                }
+                else if (fanout[net - 1] > 1)
+                {
+                    branch_site[2 * j + k] = num_sites++;
+                    branch_net.push_back(net);
+                    branch_gate.push_back(j);
+                }
+            }
+        }
+    }
+
+    // Site of a fault, a pin fault on a line without fanout is the same as the fault on the net
+    // Returns -1 for faults outside the circuit
+    int siteOf(const Fault &f) const
+    {
+        if (f.net_id < 1 || f.net_id > num_nets || f.value < 0 || f.value > 1)
+        {
+            return -1;
+        }
+
+        if (f.gate >= 0 && 2 * f.gate + 1 < branch_site.size())
+        {
+            for (int k = 0; k < 2; ++k)
+            {
+                int site = branch_site[2 * f.gate + k];
+                if (site != -1 && branch_net[site - num_nets] == f.net_id)
+                {
+                    return site;
+                }
+            }
+        }
+
+        return f.net_id - 1;
+    }
+
+    // Fault with the given index
+    Fault faultAt(int index) const
+    {
+        int site = index / 2;
+
+        if (site < num_nets)
+        {
+            return Fault(site + 1, index % 2);
+        }
+
+        return Fault(branch_net[site - num_nets], index % 2, branch_gate[site - num_nets]);
+    }
+
+    // All the faults of the circuit, optionally including the faults on fanout branches
+    std::vector<Fault> allFaults(bool pins, FaultModel model = FAULT_STUCK_AT) const
+    {
+        std::vector<Fault> faults;
+        int sites = pins ? num_sites : num_nets;
+
+        for (int i = 0; i < 2 * sites; ++i)
+        {
+            faults.push_back(faultAt(i));
+            faults.back().model = model;
+        }
+
+        return faults;
+    }
+};
+
+// Parse the site and value of a fault from a fault list
+// A net fault is written as "net value", a fault on the branch of net into the gate driving out as "net>out value"
+// The value is 0 or 1 for a stuck at fault and R (slow to rise) or F (slow to fall) for a transition fault
+// Returns false if the net is not in the circuit, the value is not one of these or the site does not name a gate input
+template <class GateT, class NetT>
+bool parseFault(const std::string &site, const std::string &value, const std::vector<GateT> &gate_list, const std::vector<NetT> &net_list, Fault &fault)
+{
+    size_t arrow = site.find('>');
+
+    try
+    {
+        if (value == "R" || value == "F")
+        {
+            fault = Fault(std::stoi(site.substr(0, arrow)), value == "F", -1, FAULT_TRANSITION);
+        }
+        else if (value == "0" || value == "1")
+        {
+            fault = Fault(std::stoi(site.substr(0, arrow)), value == "1");
+        }
+        else
+        {
+            return false;
+        }
+
+        if (fault.net_id < 1 || fault.net_id > net_list.size())
+        {
+            return false;
+        }
+
+        if (arrow != std::string::npos)
+        {
+            int out = std::stoi(site.substr(arrow + 1));
+
+            if (out < 1 || out > net_list.size() || net_list[out - 1].input == -1)
+            {
+                return false;
+            }
+
+            // The gate is identified by the net it drives
+            const GateT &g = gate_list[net_list[out - 1].input];
+
+            for (int k = 0; k < g.input_nets.size(); ++k)
+            {
+                if (g.input_nets[k].id == fault.net_id)
+                {
+                    fault.gate = g.id;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+// Site of a fault in the notation of the fault lists
+template <class GateT>
+std::string faultSite(const Fault &fault, const std::vector<GateT> &gate_list)
+{
+    if (fault.gate == -1)
+    {
+        return std::to_string(fault.net_id);
+    }
+
+    return std::to_string(fault.net_id) + ">" + std::to_string(gate_list[fault.gate].output_net.id);
+}
+
+// Value of a fault in the notation of the fault lists
+inline std::string faultValue(const Fault &fault)
+{
+    if (fault.model == FAULT_TRANSITION)
+    {
+        return fault.value ? "F" : "R";
+    }
+
+    return std::to_string(fault.value);
+}
+
+#endif
@@ -0,0 +1,232 @@
+#ifndef FAULTCOLLAPSE_H
+#define FAULTCOLLAPSE_H
+
+#include <vector>
+#include <string>
+#include <map>
+
+#include "Fault.h"
+
+// Kinds of fault collapsing
+enum CollapseMode
+{
+    COLLAPSE_NONE,
+    COLLAPSE_EQUIVALENCE,
+    COLLAPSE_DOMINANCE
+};
+
+// Result of collapsing a fault list
+class CollapsedFaults
+{
+
+public:
+    // One representative fault per class, these are the faults which have to be simulated or targeted
+    std::vector<Fault> faults;
+
+    // For every fault of the original list, the index of its class in faults
+    std::vector<int> class_of;
+
+    // For every fault of the original list, set if its class was dropped because it is dominated
+    // Tests for the representative detect the fault, but the fault may be testable when the representative is not
+    std::vector<char> dominated;
+
+    // Faults of the original list belonging to every class
+    std::vector<std::vector<int>> members;
+};
+
+// Fault list in which every fault is a class of its own, used when collapsing is disabled
+inline CollapsedFaults uncollapsedFaults(const std::vector<Fault> &fault_list)
+{
+    CollapsedFaults result;
+    result.faults = fault_list;
+    result.dominated.resize(fault_list.size(), 0);
+
+    for (int f = 0; f < fault_list.size(); ++f)
+    {
+        result.class_of.push_back(f);
+        result.members.push_back({f});
+    }
+
+    return result;
+}
+
+// Find the root of a fault class, halving the path on the way
+inline int findClass(std::vector<int> &parent, int x)
+{
+    while (parent[x] != x)
+    {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+// Structural fault collapsing of a list of stuck at faults
+// Faults on the input line of a gate are merged with the equivalent fault on its output:
+//   BUF in s-a-v = out s-a-v,   INV in s-a-v = out s-a-!v
+//   AND in s-a-0 = out s-a-0,   NAND in s-a-0 = out s-a-1
+//   OR  in s-a-1 = out s-a-1,   NOR  in s-a-1 = out s-a-0
+// The input line is the fanout branch into the gate, or the net itself when it has no fanout
+// With dominance enabled the output fault which dominates the non controlled input faults
+// (AND s-a-1, NAND s-a-0, OR s-a-0, NOR s-a-1) is dropped in favour of an input fault
+template <class GateT, class NetT>
+CollapsedFaults collapseFaults(const std::vector<GateT> &gate_list, const std::vector<NetT> &net_list, const std::vector<int> &output_list, const std::vector<Fault> &fault_list, bool dominance)
+{
+    FaultSites sites(gate_list, net_list, output_list);
+
+    // Union find over the fault indices of all the sites
+    std::vector<int> parent(2 * sites.num_sites);
+    for (int i = 0; i < parent.size(); ++i)
+    {
+        parent[i] = i;
+    }
+
+    // Class covering a dominated class, -1 if the class is kept
+    std::vector<int> covered_by(2 * sites.num_sites, -1);
+
+    for (int j = 0; j < gate_list.size(); ++j)
+    {
+        const GateT &g = gate_list[j];
+        int out = g.output_net.id - 1;
+
+        // Controlling value and inversion of the gate, -1 for single input gates
+        int c = -1, i = 0;
+        if (g.type == "AND")
+        {
+            c = 0;
+        }
+        else if (g.type == "NAND")
+        {
+            c = 0;
+            i = 1;
+        }
+        else if (g.type == "OR")
+        {
+            c = 1;
+        }
+        else if (g.type == "NOR")
+        {
+            c = 1;
+            i = 1;
+        }
+        else if (g.type == "INV")
+        {
+            i = 1;
+        }
+
+        for (int k = 0; k < g.input_nets.size(); ++k)
+        {
+            // Site of the input line of the gate
+            int in = sites.branch_site[2 * j + k];
+            if (in == -1)
+            {
+                in = g.input_nets[k].id - 1;
+            }
+
+            if (c == -1)
+            {
+                // BUF and INV merge both faults of the input
+                for (int v = 0; v < 2; ++v)
+                {
+                    int a = findClass(parent, 2 * in + v);
+                    int b = findClass(parent, 2 * out + (v ^ i));
+                    parent[a] = b;
+                }
+            }
+            else
+            {
+                // The controlling value on the input is equivalent to the controlled value on the output
+                int a = findClass(parent, 2 * in + c);
+                int b = findClass(parent, 2 * out + (c ^ i));
+                parent[a] = b;
+            }
+        }
+    }
+
+    // Dominance is recorded after all the equivalences are known
+    if (dominance)
+    {
+        for (int j = 0; j < gate_list.size(); ++j)
+        {
+            const GateT &g = gate_list[j];
+
+            if (g.input_nets.size() != 2)
+            {
+                continue;
+            }
+
+            int c = (g.type == "AND" || g.type == "NAND") ? 0 : 1;
+            int i = (g.type == "NAND" || g.type == "NOR") ? 1 : 0;
+            int out = findClass(parent, 2 * (g.output_net.id - 1) + (!c ^ i));
+
+            if (covered_by[out] != -1)
+            {
+                continue;
+            }
+
+            // Prefer an input without fanout, so that lists of net faults are covered by net faults
+            int k = sites.branch_site[2 * j] == -1 ? 0 : 1;
+            int in = sites.branch_site[2 * j + k];
+            if (in == -1)
+            {
+                in = g.input_nets[k].id - 1;
+            }
+
+            covered_by[out] = findClass(parent, 2 * in + !c);
+        }
+    }
+
+    CollapsedFaults result;
+    result.class_of.resize(fault_list.size());
+    result.dominated.resize(fault_list.size(), 0);
+
+    // Map the final class of every fault to its position in the collapsed list
+    std::map<int, int> class_index;
+
+    for (int f = 0; f < fault_list.size(); ++f)
+    {
+        int site = sites.siteOf(fault_list[f]);
+
+        // Faults outside the circuit are kept as classes of their own
+        if (site == -1)
+        {
+            result.class_of[f] = result.faults.size();
+            result.faults.push_back(fault_list[f]);
+            result.members.push_back({f});
+            continue;
+        }
+
+        int root = findClass(parent, 2 * site + fault_list[f].value);
+
+        // Follow the dominance chain to a class which is kept
+        int steps = 0;
+        while (covered_by[root] != -1 && steps < parent.size())
+        {
+            root = findClass(parent, covered_by[root]);
+            result.dominated[f] = 1;
+            steps++;
+        }
+
+        auto it = class_index.find(root);
+        if (it == class_index.end())
+        {
+            // The first listed fault of the class represents it, dominated faults use the covering class
+            Fault representative = fault_list[f];
+            if (result.dominated[f])
+            {
+                representative = sites.faultAt(root);
+            }
+
+            it = class_index.insert(std::make_pair(root, (int)result.faults.size())).first;
+            result.faults.push_back(representative);
+            result.members.push_back({});
+        }
+
+        result.class_of[f] = it->second;
+        result.members[it->second].push_back(f);
+    }
+
+    return result;
+}
+
+#endif
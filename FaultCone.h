@@ -0,0 +1,163 @@
+#ifndef FAULTCONE_H
+#define FAULTCONE_H
+
+#include <algorithm>
+#include <vector>
+
+#include "Fault.h"
+#include "CompiledCircuit.h"
+
+// The part of a circuit which matters for the test of one fault
+// The fanout cone of the fault site gives the outputs the fault can reach; the gates of the fanin of these outputs
+// and of the site are the only ones a test generator has to evaluate, and the gates of the fanout cone which reach
+// one of these outputs are the only candidates of the D frontier. The cone is extracted on demand with a walk over
+// the fanout and the drivers of the touched lines, so its cost grows with the cone and not with the circuit
+class FaultCone
+{
+
+public:
+    // Gate indices in topological order, the gates to evaluate and the gates of the fanout cone reaching an output
+    std::vector<int> gates;
+    std::vector<int> frontier;
+
+    // Net indices of the outputs the fault can reach and of every net touched by the gates
+    std::vector<int> outputs;
+    std::vector<int> nets;
+
+    // Class constructor, the circuit has to outlive the cone
+    FaultCone(const CompiledCircuit &_circuit) : circuit(_circuit)
+    {
+        fanout.resize(circuit.num_nets);
+        driver.assign(circuit.num_nets, -1);
+        is_output.assign(circuit.num_nets, 0);
+        in_fanout.assign(circuit.num_nets, 0);
+        in_region.assign(circuit.num_nets, 0);
+
+        for (int j = 0; j < circuit.gates.size(); ++j)
+        {
+            const CompiledGate &g = circuit.gates[j];
+
+            fanout[g.in1].push_back(j);
+            if (g.in2 != g.in1)
+            {
+                fanout[g.in2].push_back(j);
+            }
+            driver[g.out] = j;
+        }
+
+        for (int i = 0; i < circuit.outputs.size(); ++i)
+        {
+            is_output[circuit.outputs[i]] = 1;
+        }
+    }
+
+    // Extract the cone of a fault, replacing the previous one
+    void extract(const Fault &fault)
+    {
+        clear();
+
+        int n = fault.net_id - 1;
+
+        // Fanout cone of the fault site, a branch fault starts at the output of its gate
+        int start = fault.gate == -1 ? n : circuit.gates[fault.gate].out;
+        std::vector<int> cone(1, start);
+        in_fanout[start] = 1;
+
+        for (int i = 0; i < cone.size(); ++i)
+        {
+            int m = cone[i];
+
+            if (is_output[m])
+            {
+                outputs.push_back(m);
+            }
+
+            for (int k = 0; k < fanout[m].size(); ++k)
+            {
+                int out = circuit.gates[fanout[m][k]].out;
+                if (!in_fanout[out])
+                {
+                    in_fanout[out] = 1;
+                    cone.push_back(out);
+                }
+            }
+        }
+
+        // Fanin of the reachable outputs and of the fault site
+        std::vector<int> pending(outputs);
+        pending.push_back(n);
+
+        while (!pending.empty())
+        {
+            int m = pending.back();
+            pending.pop_back();
+
+            if (in_region[m])
+            {
+                continue;
+            }
+
+            in_region[m] = 1;
+            nets.push_back(m);
+
+            int j = driver[m];
+            if (j != -1)
+            {
+                gates.push_back(j);
+                pending.push_back(circuit.gates[j].in1);
+                pending.push_back(circuit.gates[j].in2);
+            }
+        }
+
+        std::sort(gates.begin(), gates.end());
+
+        for (int i = 0; i < gates.size(); ++i)
+        {
+            const CompiledGate &g = circuit.gates[gates[i]];
+            if (in_fanout[g.in1] || in_fanout[g.in2] || gates[i] == fault.gate)
+            {
+                frontier.push_back(gates[i]);
+            }
+        }
+
+        fanout_nets.swap(cone);
+    }
+
+    // Check if a net (an index) is in the fanout cone of the fault
+    bool inFanout(int m) const
+    {
+        return in_fanout[m];
+    }
+
+private:
+    const CompiledCircuit &circuit;
+
+    std::vector<std::vector<int>> fanout;
+    std::vector<int> driver;
+    std::vector<char> is_output;
+
+    // Membership flags of the current cone, cleared line by line
+    std::vector<char> in_fanout;
+    std::vector<char> in_region;
+    std::vector<int> fanout_nets;
+
+    void clear()
+    {
+        for (int i = 0; i < nets.size(); ++i)
+        {
+            in_region[nets[i]] = 0;
+        }
+        for (int i = 0; i < fanout_nets.size(); ++i)
+        {
+            in_fanout[fanout_nets[i]] = 0;
+        }
+
+        gates.clear();
+        frontier.clear();
+        outputs.clear();
+        nets.clear();
+        fanout_nets.clear();
+    }
+};
+
+#endif
@@ -0,0 +1,536 @@
+#ifndef FAULTDICTIONARY_H
+#define FAULTDICTIONARY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Fault.h"
+#include "Hash.h"
+#include "CompiledCircuit.h"
+#include "ParallelFaultSim.h"
+
+// Pass/fail fault dictionary for diagnosis
+// For every fault class and every pattern the dictionary records whether the class fails the pattern and, if it
+// does, a 32 bit signature of the set of failing outputs. The response of a class is the list of its failing
+// patterns with their signatures, and its 64 bit hash is indexed, so an observed response matching a class exactly
+// is found by a binary search. Other responses are ranked by comparing them with every class.
+//
+// File layout, all values in the byte order of the writing machine and every array aligned to its element size
+// header, index[num_entries] sorted by hash, bitmaps[num_entries][words] with bit p of word p / 64 set if the class
+// fails pattern p, offsets[num_entries + 1] into the signatures, faults[num_faults], outputs[num_outputs] net ids,
+// signatures[num_signatures] of the failing patterns of every class in pattern order
+static const char DICTIONARY_MAGIC[8] = {'A', 'T', 'P', 'G', 'D', 'I', 'C', '1'};
+
+class DictionaryHeader
+{
+
+public:
+    char magic[8];
+    uint32_t num_patterns;
+    uint32_t num_outputs;
+    uint32_t num_entries;
+    uint32_t num_faults;
+    uint64_t num_signatures;
+};
+
+// Response hash of a class, in hash order
+class DictionaryIndex
+{
+
+public:
+    uint64_t hash;
+    uint32_t entry;
+    uint32_t reserved;
+};
+
+// A fault of the fault list, branch is the output net of the gate of a fanout branch fault and 0 for a net fault
+class DictionaryFault
+{
+
+public:
+    int32_t net;
+    int32_t value;
+    int32_t branch;
+    uint32_t entry;
+};
+
+// Signature of the failing outputs of one pattern, FNV-1a over the output positions, never 0
+inline uint32_t outputSignature(const std::vector<uint32_t> &outputs)
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < outputs.size(); ++i)
+    {
+        for (int b = 0; b < 4; ++b)
+        {
+            h = (h ^ ((outputs[i] >> (8 * b)) & 0xFF)) * 16777619u;
+        }
+    }
+    return h != 0 ? h : 1;
+}
+
+// Fold one failing pattern into a response hash, which starts from FNV_BASIS
+inline uint64_t foldResponse(uint64_t h, uint32_t pattern, uint32_t signature)
+{
+    uint64_t v = ((uint64_t)pattern << 32) | signature;
+    unsigned char bytes[8];
+    for (int b = 0; b < 8; ++b)
+    {
+        bytes[b] = (v >> (8 * b)) & 0xFF;
+    }
+    return fnv1a(bytes, sizeof(bytes), h);
+}
+
+// Builds the dictionary of a fault list while the patterns are simulated, 64 at a time
+class FaultDictionaryBuilder
+{
+
+public:
+    // Class constructor, every class of the collapsed list becomes an entry
+    // The circuit and the sites have to outlive the builder
+    FaultDictionaryBuilder(const CompiledCircuit &_circuit, const FaultSites &sites, const std::vector<Fault> &_classes) : circuit(_circuit), simulator(_circuit, sites), classes(_classes)
+    {
+        num_patterns = 0;
+        bitmaps.resize(classes.size());
+        signatures.resize(classes.size());
+        diff.resize(circuit.outputs.size());
+    }
+
+    // Simulate a chunk of patterns, one word per primary input, the first count patterns are valid
+    void addChunk(const std::vector<uint64_t> &inputs, int count)
+    {
+        uint64_t mask = count == 64 ? ~0ULL : (1ULL << count) - 1;
+        simulator.simulateGood(inputs);
+
+        for (int c = 0; c < classes.size(); ++c)
+        {
+            uint64_t failing = simulator.detectOutputs(classes[c], mask, diff.data());
+            bitmaps[c].push_back(failing);
+
+            if (failing == 0)
+            {
+                continue;
+            }
+
+            // Failing outputs of every failing pattern, in output order
+            for (uint64_t rest = failing; rest != 0; rest &= rest - 1)
+            {
+                failing_outputs[__builtin_ctzll(rest)].clear();
+            }
+            for (int i = 0; i < diff.size(); ++i)
+            {
+                for (uint64_t rest = diff[i]; rest != 0; rest &= rest - 1)
+                {
+                    failing_outputs[__builtin_ctzll(rest)].push_back(i);
+                }
+            }
+            for (uint64_t rest = failing; rest != 0; rest &= rest - 1)
+            {
+                signatures[c].push_back(outputSignature(failing_outputs[__builtin_ctzll(rest)]));
+            }
+        }
+
+        num_patterns += count;
+    }
+
+    int numPatterns() const
+    {
+        return num_patterns;
+    }
+
+    // Write the dictionary, fault_list holds the faults of the classes and class_of the class of every fault
+    // The branch of a fanout branch fault is given as the output net of its gate in branch_net
+    bool write(const std::string &filename, const std::vector<Fault> &fault_list, const std::vector<int> &class_of, const std::vector<int> &branch_net, std::string &error) const
+    {
+        std::ofstream fout(filename, std::ios::binary);
+
+        if (!fout.is_open())
+        {
+            error = "unable to open " + filename;
+            return false;
+        }
+
+        int words = (num_patterns + 63) / 64;
+
+        DictionaryHeader header;
+        std::memcpy(header.magic, DICTIONARY_MAGIC, sizeof(header.magic));
+        header.num_patterns = num_patterns;
+        header.num_outputs = circuit.outputs.size();
+        header.num_entries = classes.size();
+        header.num_faults = fault_list.size();
+        header.num_signatures = 0;
+
+        std::vector<uint64_t> offsets(1, 0);
+        std::vector<DictionaryIndex> index(classes.size());
+
+        for (int c = 0; c < classes.size(); ++c)
+        {
+            header.num_signatures += signatures[c].size();
+            offsets.push_back(header.num_signatures);
+
+            // The bit of a pattern gives the position of its signature
+            uint64_t h = FNV_BASIS;
+            int k = 0;
+            for (int w = 0; w < words; ++w)
+            {
+                for (uint64_t rest = bitmaps[c][w]; rest != 0; rest &= rest - 1)
+                {
+                    h = foldResponse(h, 64 * w + __builtin_ctzll(rest), signatures[c][k++]);
+                }
+            }
+
+            index[c].hash = h;
+            index[c].entry = c;
+            index[c].reserved = 0;
+        }
+
+        std::sort(index.begin(), index.end(), [](const DictionaryIndex &a, const DictionaryIndex &b)
+                  { return a.hash != b.hash ? a.hash < b.hash : a.entry < b.entry; });
+
+        fout.write((const char *)&header, sizeof(header));
+        fout.write((const char *)index.data(), index.size() * sizeof(DictionaryIndex));
+
+        for (int c = 0; c < classes.size(); ++c)
+        {
+            fout.write((const char *)bitmaps[c].data(), words * sizeof(uint64_t));
+        }
+
+        fout.write((const char *)offsets.data(), offsets.size() * sizeof(uint64_t));
+
+        for (int i = 0; i < fault_list.size(); ++i)
+        {
+            DictionaryFault f;
+            f.net = fault_list[i].net_id;
+            f.value = fault_list[i].value;
+            f.branch = branch_net[i];
+            f.entry = class_of[i];
+            fout.write((const char *)&f, sizeof(f));
+        }
+
+        for (int i = 0; i < circuit.outputs.size(); ++i)
+        {
+            uint32_t net = circuit.outputs[i] + 1;
+            fout.write((const char *)&net, sizeof(net));
+        }
+
+        for (int c = 0; c < classes.size(); ++c)
+        {
+            fout.write((const char *)signatures[c].data(), signatures[c].size() * sizeof(uint32_t));
+        }
+
+        fout.close();
+
+        if (!fout)
+        {
+            error = "unable to write " + filename;
+            return false;
+        }
+
+        return true;
+    }
+
+private:
+    const CompiledCircuit &circuit;
+    PatternParallelFaultSimulator simulator;
+    const std::vector<Fault> &classes;
+    int num_patterns;
+
+    // Failing patterns of every class, one word per chunk, and the signatures of its failing patterns
+    std::vector<std::vector<uint64_t>> bitmaps;
+    std::vector<std::vector<uint32_t>> signatures;
+
+    // Scratch state of a chunk, the output differences of a class and the failing outputs of every pattern
+    std::vector<uint64_t> diff;
+    std::vector<uint32_t> failing_outputs[64];
+};
+
+// A class ranked by the diagnosis
+class DiagnosisCandidate
+{
+
+public:
+    int entry;
+
+    // Patterns in which the response of the class differs from the observed one
+    int mismatches;
+
+    // Failing patterns of the observed response with the same failing outputs in the class
+    int matched;
+
+    // Observed failing patterns the class passes, and failing patterns of the class which passed
+    int missing;
+    int extra;
+};
+
+// Read only view of a dictionary file mapped into memory, nothing is copied on open
+class FaultDictionary
+{
+
+public:
+    FaultDictionary()
+    {
+        base = nullptr;
+        size = 0;
+    }
+
+    ~FaultDictionary()
+    {
+        if (base != nullptr)
+        {
+            munmap(base, size);
+        }
+    }
+
+    FaultDictionary(const FaultDictionary &) = delete;
+    FaultDictionary &operator=(const FaultDictionary &) = delete;
+
+    // Map a dictionary file, returns false with the reason in error if it is not a complete dictionary
+    bool open(const std::string &filename, std::string &error)
+    {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            error = "unable to open the dictionary " + filename;
+            return false;
+        }
+
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0 || file_stat.st_size < sizeof(DictionaryHeader))
+        {
+            close(fd);
+            error = filename + " is not a fault dictionary of this version";
+            return false;
+        }
+
+        size = file_stat.st_size;
+        base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (base == MAP_FAILED)
+        {
+            base = nullptr;
+            error = "unable to map the dictionary " + filename;
+            return false;
+        }
+
+        const char *p = (const char *)base;
+        header = (const DictionaryHeader *)p;
+
+        if (std::memcmp(header->magic, DICTIONARY_MAGIC, sizeof(DICTIONARY_MAGIC)) != 0)
+        {
+            error = filename + " is not a fault dictionary of this version";
+            return false;
+        }
+
+        words = (header->num_patterns + 63) / 64;
+
+        // Expected size of the file, computed in 64 bits from the counts of the header
+        uint64_t expected = sizeof(DictionaryHeader) + (uint64_t)header->num_entries * sizeof(DictionaryIndex) + (uint64_t)header->num_entries * words * sizeof(uint64_t) +
+                            ((uint64_t)header->num_entries + 1) * sizeof(uint64_t) + (uint64_t)header->num_faults * sizeof(DictionaryFault) +
+                            (uint64_t)header->num_outputs * sizeof(uint32_t) + header->num_signatures * sizeof(uint32_t);
+
+        if (expected != size)
+        {
+            error = "the dictionary " + filename + " is truncated";
+            return false;
+        }
+
+        p += sizeof(DictionaryHeader);
+        index = (const DictionaryIndex *)p;
+        p += header->num_entries * sizeof(DictionaryIndex);
+        bitmaps = (const uint64_t *)p;
+        p += (uint64_t)header->num_entries * words * sizeof(uint64_t);
+        offsets = (const uint64_t *)p;
+        p += (header->num_entries + 1) * sizeof(uint64_t);
+        faults = (const DictionaryFault *)p;
+        p += header->num_faults * sizeof(DictionaryFault);
+        outputs = (const uint32_t *)p;
+        p += header->num_outputs * sizeof(uint32_t);
+        signatures = (const uint32_t *)p;
+
+        if (offsets[header->num_entries] != header->num_signatures)
+        {
+            error = "the dictionary " + filename + " is corrupted";
+            return false;
+        }
+
+        return true;
+    }
+
+    int numPatterns() const
+    {
+        return header->num_patterns;
+    }
+
+    int numOutputs() const
+    {
+        return header->num_outputs;
+    }
+
+    int numEntries() const
+    {
+        return header->num_entries;
+    }
+
+    int numFaults() const
+    {
+        return header->num_faults;
+    }
+
+    const DictionaryFault &fault(int i) const
+    {
+        return faults[i];
+    }
+
+    // Position of an output net in the responses, -1 if the net is not a primary output
+    int outputIndex(int net) const
+    {
+        for (int i = 0; i < header->num_outputs; ++i)
+        {
+            if (outputs[i] == net)
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Rank the classes against an observed response, given as (pattern, output position) failures
+    // Returns at most max_candidates classes, the classes with the fewest mismatching patterns first. The classes
+    // matching exactly are looked up in the index, the others are only compared when more candidates are wanted
+    std::vector<DiagnosisCandidate> diagnose(std::vector<std::pair<int, int>> failures, int max_candidates) const
+    {
+        // Failing patterns of the observed response and their signatures
+        std::sort(failures.begin(), failures.end());
+        failures.erase(std::unique(failures.begin(), failures.end()), failures.end());
+
+        std::vector<uint64_t> observed(words, 0);
+        std::vector<int> observed_patterns;
+        std::vector<uint32_t> observed_signatures, pattern_outputs;
+
+        for (int i = 0; i < failures.size(); ++i)
+        {
+            pattern_outputs.push_back(failures[i].second);
+
+            if (i + 1 == failures.size() || failures[i + 1].first != failures[i].first)
+            {
+                int p = failures[i].first;
+                observed[p / 64] |= 1ULL << (p % 64);
+                observed_patterns.push_back(p);
+                observed_signatures.push_back(outputSignature(pattern_outputs));
+                pattern_outputs.clear();
+            }
+        }
+
+        // Exact matches through the index
+        uint64_t h = FNV_BASIS;
+        for (int k = 0; k < observed_patterns.size(); ++k)
+        {
+            h = foldResponse(h, observed_patterns[k], observed_signatures[k]);
+        }
+
+        std::vector<DiagnosisCandidate> candidates;
+        const DictionaryIndex *first = std::lower_bound(index, index + header->num_entries, h, [](const DictionaryIndex &a, uint64_t value)
+                                                        { return a.hash < value; });
+
+        for (const DictionaryIndex *it = first; it != index + header->num_entries && it->hash == h; ++it)
+        {
+            candidates.push_back(compare(it->entry, observed, observed_signatures));
+        }
+
+        if (candidates.size() >= max_candidates)
+        {
+            candidates.resize(max_candidates);
+            return candidates;
+        }
+
+        // Compare the response of every class
+        candidates.clear();
+        for (int c = 0; c < header->num_entries; ++c)
+        {
+            candidates.push_back(compare(c, observed, observed_signatures));
+        }
+
+        auto better = [](const DiagnosisCandidate &a, const DiagnosisCandidate &b)
+        {
+            if (a.mismatches != b.mismatches)
+            {
+                return a.mismatches < b.mismatches;
+            }
+            if (a.matched != b.matched)
+            {
+                return a.matched > b.matched;
+            }
+            return a.entry < b.entry;
+        };
+
+        int kept = std::min((int)candidates.size(), max_candidates);
+        std::partial_sort(candidates.begin(), candidates.begin() + kept, candidates.end(), better);
+        candidates.resize(kept);
+
+        return candidates;
+    }
+
+private:
+    void *base;
+    size_t size;
+    int words;
+
+    // Arrays of the mapped file
+    const DictionaryHeader *header;
+    const DictionaryIndex *index;
+    const uint64_t *bitmaps;
+    const uint64_t *offsets;
+    const DictionaryFault *faults;
+    const uint32_t *outputs;
+    const uint32_t *signatures;
+
+    // Compare the response of a class with the observed one
+    DiagnosisCandidate compare(int c, const std::vector<uint64_t> &observed, const std::vector<uint32_t> &observed_signatures) const
+    {
+        DiagnosisCandidate result;
+        result.entry = c;
+        result.matched = 0;
+        result.missing = 0;
+        result.extra = 0;
+
+        const uint64_t *bits = bitmaps + (uint64_t)c * words;
+        const uint32_t *own = signatures + offsets[c];
+        int own_before = 0, observed_before = 0;
+
+        for (int w = 0; w < words; ++w)
+        {
+            uint64_t both = bits[w] & observed[w];
+            result.missing += __builtin_popcountll(observed[w] & ~bits[w]);
+            result.extra += __builtin_popcountll(bits[w] & ~observed[w]);
+
+            // The signatures of a pattern failing in both are found by counting the failing patterns before it
+            for (uint64_t rest = both; rest != 0; rest &= rest - 1)
+            {
+                uint64_t below = (rest & -rest) - 1;
+                int k = own_before + __builtin_popcountll(bits[w] & below);
+                int o = observed_before + __builtin_popcountll(observed[w] & below);
+
+                result.matched += own[k] == observed_signatures[o];
+            }
+
+            own_before += __builtin_popcountll(bits[w]);
+            observed_before += __builtin_popcountll(observed[w]);
+        }
+
+        result.mismatches = result.missing + result.extra + (int)observed_signatures.size() - result.missing - result.matched;
+
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64 bit FNV-1a, names the cached kernels and checks the checkpoints and the responses of the fault dictionaries
+const uint64_t FNV_BASIS = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+
+// Hash of size bytes, h continues the hash of the bytes before them
+inline uint64_t fnv1a(const void *data, size_t size, uint64_t h = FNV_BASIS)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        h = (h ^ bytes[i]) * FNV_PRIME;
+    }
+    return h;
+}
+
+inline uint64_t fnv1a(const std::string &text)
+{
+    return fnv1a(text.data(), text.size());
+}
+
+#endif
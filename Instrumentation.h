@@ -0,0 +1,228 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Run time counters and phase timers
+// Every thread updates its own counters, so the hot paths take no lock; the counters of all the threads are summed
+// when the report is written. The INSTRUMENT_ macros only do something when compiled with -DATPG_INSTRUMENT,
+// otherwise they expand to nothing and the report only states that the program was built without instrumentation
+
+// Events counted in the hot paths
+enum Counter
+{
+    COUNTER_GATE_EVALS,
+    COUNTER_IMPLICATIONS,
+    COUNTER_DECISIONS,
+    COUNTER_BACKTRACKS,
+    COUNTER_PATTERNS,
+    COUNTER_FAULTS,
+    NUM_COUNTERS
+};
+
+// Timed phases of a run, the phases may nest and their times are inclusive
+// A job covers everything done for one job, fault covers the search for one fault
+enum Phase
+{
+    PHASE_JOB,
+    PHASE_PARSE,
+    PHASE_LEVELIZE,
+    PHASE_COMPILE,
+    PHASE_COLLAPSE,
+    PHASE_LEARN,
+    PHASE_UNTESTABLE,
+    PHASE_SIMULATE,
+    PHASE_FAULT_SIM,
+    PHASE_FAULT,
+    PHASE_SAT,
+    PHASE_WRITE,
+    NUM_PHASES
+};
+
+static const char *const COUNTER_NAMES[NUM_COUNTERS] = {"gate_evals", "implications", "decisions", "backtracks", "patterns", "faults"};
+static const char *const PHASE_NAMES[NUM_PHASES] = {"job", "parse", "levelize", "compile", "collapse", "learn", "untestable", "simulate", "fault_sim", "fault", "sat", "write"};
+
+// Counters and phase times of one thread
+class ThreadStats
+{
+
+public:
+    uint64_t counters[NUM_COUNTERS];
+
+    // Number of times every phase was entered, total and longest time in nanoseconds
+    uint64_t phase_calls[NUM_PHASES];
+    uint64_t phase_ns[NUM_PHASES];
+    uint64_t phase_max_ns[NUM_PHASES];
+
+    ThreadStats()
+    {
+        for (int i = 0; i < NUM_COUNTERS; ++i)
+        {
+            counters[i] = 0;
+        }
+        for (int i = 0; i < NUM_PHASES; ++i)
+        {
+            phase_calls[i] = 0;
+            phase_ns[i] = 0;
+            phase_max_ns[i] = 0;
+        }
+    }
+};
+
+class Instrumentation
+{
+
+public:
+    // Statistics of the calling thread, registered on first use and kept after the thread ends
+    static ThreadStats &local()
+    {
+        thread_local ThreadStats *stats = nullptr;
+
+        if (stats == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(mutex());
+            threads().emplace_back(new ThreadStats());
+            stats = threads().back().get();
+        }
+
+        return *stats;
+    }
+
+    // Write the statistics of every thread and their sum as JSON, returns false if the file cannot be written
+    // Call once the worker threads are idle
+    static bool writeReport(const std::string &filename, const std::string &program)
+    {
+        std::ofstream fout(filename);
+        if (!fout.is_open())
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex());
+        const std::vector<std::unique_ptr<ThreadStats>> &list = threads();
+
+#ifdef ATPG_INSTRUMENT
+        bool enabled = true;
+#else
+        bool enabled = false;
+#endif
+
+        fout << "{\"program\": \"" << program << "\", \"instrumented\": " << (enabled ? "true" : "false") << ", \"threads\": " << list.size() << "," << std::endl;
+
+        ThreadStats total;
+        for (int t = 0; t < list.size(); ++t)
+        {
+            for (int i = 0; i < NUM_COUNTERS; ++i)
+            {
+                total.counters[i] += list[t]->counters[i];
+            }
+            for (int i = 0; i < NUM_PHASES; ++i)
+            {
+                total.phase_calls[i] += list[t]->phase_calls[i];
+                total.phase_ns[i] += list[t]->phase_ns[i];
+                total.phase_max_ns[i] = std::max(total.phase_max_ns[i], list[t]->phase_max_ns[i]);
+            }
+        }
+
+        fout << " \"total\": ";
+        writeStats(total, fout);
+        fout << "," << std::endl;
+
+        fout << " \"per_thread\": [" << std::endl;
+        for (int t = 0; t < list.size(); ++t)
+        {
+            fout << "  ";
+            writeStats(*list[t], fout);
+            fout << (t + 1 < list.size() ? "," : "") << std::endl;
+        }
+        fout << " ]}" << std::endl;
+
+        return true;
+    }
+
+private:
+    static std::mutex &mutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+
+    static std::vector<std::unique_ptr<ThreadStats>> &threads()
+    {
+        static std::vector<std::unique_ptr<ThreadStats>> list;
+        return list;
+    }
+
+    // One JSON object with the counters and the phases which were entered, times in seconds
+    static void writeStats(const ThreadStats &stats, std::ostream &out)
+    {
+        out << "{\"counters\": {";
+        for (int i = 0; i < NUM_COUNTERS; ++i)
+        {
+            out << (i > 0 ? ", " : "") << "\"" << COUNTER_NAMES[i] << "\": " << stats.counters[i];
+        }
+        out << "}, \"phases\": {";
+
+        bool first = true;
+        for (int i = 0; i < NUM_PHASES; ++i)
+        {
+            if (stats.phase_calls[i] == 0)
+            {
+                continue;
+            }
+
+            out << (first ? "" : ", ") << "\"" << PHASE_NAMES[i] << "\": {\"calls\": " << stats.phase_calls[i] << ", \"seconds\": " << stats.phase_ns[i] * 1e-9
+                << ", \"max_seconds\": " << stats.phase_max_ns[i] * 1e-9 << "}";
+            first = false;
+        }
+        out << "}}";
+    }
+};
+
+// Adds the time until the end of the scope to a phase of the calling thread
+class ScopedPhase
+{
+
+public:
+    ScopedPhase(Phase _phase)
+    {
+        phase = _phase;
+        start = std::chrono::steady_clock::now();
+    }
+
+    ~ScopedPhase()
+    {
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        ThreadStats &stats = Instrumentation::local();
+
+        stats.phase_calls[phase]++;
+        stats.phase_ns[phase] += ns;
+        if (ns > stats.phase_max_ns[phase])
+        {
+            stats.phase_max_ns[phase] = ns;
+        }
+    }
+
+private:
+    Phase phase;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define INSTRUMENT_CONCAT_(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_(a, b)
+
+#ifdef ATPG_INSTRUMENT
+#define INSTRUMENT_COUNT(counter, n) (Instrumentation::local().counters[counter] += (n))
+#define INSTRUMENT_PHASE(phase) ScopedPhase INSTRUMENT_CONCAT(scoped_phase_, __LINE__)(phase)
+#else
+#define INSTRUMENT_COUNT(counter, n) ((void)0)
+#define INSTRUMENT_PHASE(phase) ((void)0)
+#endif
+
+#endif
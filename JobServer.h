@@ -0,0 +1,237 @@
+#ifndef JOBSERVER_H
+#define JOBSERVER_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ThreadPool.h"
+
+// Request line which stops the server once the jobs already accepted have finished
+const std::string SERVER_SHUTDOWN = "shutdown";
+
+// Longest request line accepted, the arguments of one job
+const size_t SERVER_MAX_LINE = 1 << 16;
+
+// Run one job of a request, given its arguments, the working directory of the client and the connection, which holds
+// the streamed input of the job after the request lines. The report sent back is written to log
+// Returns the exit status of the job
+typedef std::function<int(const std::vector<std::string> &args, const std::string &cwd, int connection, std::ostream &log)> JobHandler;
+
+// Resolve a path given by a client against its working directory, - stands for the connection and is kept
+inline std::string resolvePath(const std::string &cwd, const std::string &path)
+{
+    if (path.empty() || path == "-" || path[0] == '/' || cwd.empty())
+    {
+        return path;
+    }
+
+    return cwd + "/" + path;
+}
+
+// Send all of text, returns false if the peer went away
+inline bool sendAll(int fd, const std::string &text)
+{
+    size_t sent = 0;
+
+    while (sent < text.size())
+    {
+        ssize_t n = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        sent += n;
+    }
+
+    return true;
+}
+
+// Read one line ending with a newline, byte by byte so that the streamed input after it stays in the socket
+inline bool receiveLine(int fd, std::string &line)
+{
+    line.clear();
+
+    while (line.size() < SERVER_MAX_LINE)
+    {
+        char c;
+        ssize_t n = recv(fd, &c, 1, 0);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        if (c == '\n')
+        {
+            return true;
+        }
+        line.push_back(c);
+    }
+
+    return false;
+}
+
+// Long running job server on a local Unix socket
+// The parsed netlists and the worker threads stay in memory between jobs, so a job only pays for its own work.
+// A client connects, sends its working directory and the arguments of one job on two lines, like a line of a batch
+// manifest, and optionally streams the input of the job until it shuts down its side of the connection.
+// Every connection is served by a worker of the pool, which sends back the report of the job followed by a
+// last line "exit <status>" and closes the connection
+class JobServer
+{
+
+public:
+    // Class constructor, the jobs run on the given number of worker threads
+    JobServer(const std::string &_path, int threads, JobHandler _handler) : pool(threads), stopping(false)
+    {
+        path = _path;
+        handler = _handler;
+        listener = -1;
+    }
+
+    ~JobServer()
+    {
+        if (listener >= 0)
+        {
+            close(listener);
+            unlink(path.c_str());
+        }
+    }
+
+    // Create the socket, returns false with the reason in error if it cannot be listened on
+    bool listen(std::string &error)
+    {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            error = "the socket path " + path + " is too long";
+            return false;
+        }
+        std::strcpy(address.sun_path, path.c_str());
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            error = std::strerror(errno);
+            return false;
+        }
+
+        // A socket left behind by a server which did not stop cleanly is replaced, a live one is not
+        if (connect(fd, (sockaddr *)&address, sizeof(address)) == 0)
+        {
+            close(fd);
+            error = "a server is already listening on " + path;
+            return false;
+        }
+        unlink(path.c_str());
+
+        if (bind(fd, (sockaddr *)&address, sizeof(address)) != 0 || ::listen(fd, SOMAXCONN) != 0)
+        {
+            error = std::strerror(errno);
+            close(fd);
+            return false;
+        }
+
+        listener = fd;
+
+        return true;
+    }
+
+    // Accept connections until a shutdown request and wait for the accepted jobs
+    void serve()
+    {
+        while (!stopping)
+        {
+            int connection = accept(listener, nullptr, nullptr);
+
+            if (connection < 0)
+            {
+                if (stopping || (errno != EINTR && errno != ECONNABORTED))
+                {
+                    break;
+                }
+                continue;
+            }
+
+            pool.submit([this, connection]()
+                        { serveConnection(connection); });
+        }
+
+        pool.wait();
+    }
+
+private:
+    std::string path;
+    JobHandler handler;
+    ThreadPool pool;
+
+    int listener;
+    std::atomic<bool> stopping;
+
+    void serveConnection(int connection)
+    {
+        std::string cwd, line;
+        std::ostringstream log;
+        int status = 1;
+
+        if (!receiveLine(connection, cwd) || !receiveLine(connection, line))
+        {
+            log << "Incomplete request" << std::endl;
+        }
+        else
+        {
+            std::stringstream ss(line);
+            std::vector<std::string> args;
+            std::string arg;
+
+            while (ss >> arg)
+            {
+                args.push_back(arg);
+            }
+
+            if (args.size() == 1 && args[0] == SERVER_SHUTDOWN)
+            {
+                // Wakes the accept in serve, jobs already queued still run
+                stopping = true;
+                shutdown(listener, SHUT_RDWR);
+
+                log << "Server stopping" << std::endl;
+                status = 0;
+            }
+            else if (args.empty())
+            {
+                log << "Empty request" << std::endl;
+            }
+            else
+            {
+                status = handler(args, cwd, connection, log);
+            }
+        }
+
+        log << "exit " << status << std::endl;
+
+        sendAll(connection, log.str());
+        close(connection);
+    }
+};
+
+#endif
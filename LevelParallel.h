@@ -0,0 +1,231 @@
+#ifndef LEVELPARALLEL_H
+#define LEVELPARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CompiledCircuit.h"
+
+// Gates a thread gets at least in a level, smaller levels are evaluated by one thread without a barrier
+const int MIN_GATES_PER_THREAD = 256;
+
+// Barrier for a fixed number of threads which spins briefly before yielding
+// The levels of a large circuit take microseconds, so waking the threads through the kernel would cost more
+class SpinBarrier
+{
+
+public:
+    SpinBarrier(int _count) : waiting(0), phase(0)
+    {
+        count = _count;
+    }
+
+    void wait()
+    {
+        int p = phase.load(std::memory_order_acquire);
+
+        // The last thread to arrive releases the others
+        if (waiting.fetch_add(1, std::memory_order_acq_rel) == count - 1)
+        {
+            waiting.store(0, std::memory_order_relaxed);
+            phase.store(p + 1, std::memory_order_release);
+            return;
+        }
+
+        for (int spin = 0; phase.load(std::memory_order_acquire) == p; ++spin)
+        {
+            if (spin > 1000)
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    int count;
+    std::atomic<int> waiting;
+    std::atomic<int> phase;
+};
+
+// Level by level evaluation of a compiled circuit on several threads
+// The gates are grouped by logic level, every level is split into one contiguous range per thread and the threads
+// meet at a barrier before the next level. Inside a level the gates keep their order in the circuit, so every thread
+// walks its part of the gate, mask and net arrays forward. Runs of levels too small to split are evaluated by the
+// calling thread alone, which saves their barriers
+class LevelParallelExecutor
+{
+
+public:
+    // Gate indices grouped by level, in increasing order inside a level
+    std::vector<int> gates;
+
+    // Stage s covers gates[stage_start[s]] to gates[stage_start[s + 1] - 1], split between the threads if parallel
+    std::vector<int> stage_start;
+    std::vector<char> stage_parallel;
+
+    // Class constructor, the circuit has to be levelized and to outlive the executor
+    LevelParallelExecutor(const CompiledCircuit &circuit, int _threads) : barrier(std::max(1, _threads))
+    {
+        num_threads = std::max(1, _threads);
+        generation = 0;
+        stopping = false;
+        task = nullptr;
+
+        // Level of every net, the inputs and flip-flop outputs are at level 0
+        std::vector<int> level(circuit.num_nets, 0);
+        std::vector<int> gate_level(circuit.gates.size());
+        int depth = 0;
+
+        for (int j = 0; j < circuit.gates.size(); ++j)
+        {
+            const CompiledGate &g = circuit.gates[j];
+            gate_level[j] = std::max(level[g.in1], level[g.in2]) + 1;
+            level[g.out] = gate_level[j];
+            depth = std::max(depth, gate_level[j]);
+        }
+
+        // Counting sort by level keeps the circuit order inside every level
+        std::vector<int> first(depth + 2, 0);
+        for (int j = 0; j < circuit.gates.size(); ++j)
+        {
+            first[gate_level[j] + 1]++;
+        }
+        for (int l = 0; l <= depth; ++l)
+        {
+            first[l + 1] += first[l];
+        }
+
+        gates.resize(circuit.gates.size());
+        std::vector<int> next(first.begin(), first.end() - 1);
+        for (int j = 0; j < circuit.gates.size(); ++j)
+        {
+            gates[next[gate_level[j]]++] = j;
+        }
+
+        // A level becomes a parallel stage when every thread gets enough gates, the other levels are merged
+        for (int l = 1; l <= depth; ++l)
+        {
+            bool parallel = num_threads > 1 && first[l + 1] - first[l] >= MIN_GATES_PER_THREAD * num_threads;
+
+            if (parallel || stage_parallel.empty() || stage_parallel.back())
+            {
+                stage_start.push_back(first[l]);
+                stage_parallel.push_back(parallel);
+            }
+        }
+        stage_start.push_back(gates.size());
+
+        for (int t = 1; t < num_threads; ++t)
+        {
+            workers.emplace_back([this, t]()
+                                 { workerLoop(t); });
+        }
+    }
+
+    ~LevelParallelExecutor()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        start.notify_all();
+
+        for (int i = 0; i < workers.size(); ++i)
+        {
+            workers[i].join();
+        }
+    }
+
+    int numThreads() const
+    {
+        return num_threads;
+    }
+
+    // Call body on ranges of gate indices covering every gate, a gate is only evaluated after the gates driving it
+    // Returns once every range has been evaluated, only one call may run at a time
+    void run(const std::function<void(const int *first, const int *last)> &body)
+    {
+        if (num_threads > 1)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                task = &body;
+                generation++;
+            }
+            start.notify_all();
+        }
+
+        runStages(0, body);
+    }
+
+private:
+    int num_threads;
+
+    // Workers 1 to num_threads - 1, the calling thread is thread 0
+    std::vector<std::thread> workers;
+    SpinBarrier barrier;
+
+    // Task of the current run, published under the mutex with a new generation
+    std::mutex mutex;
+    std::condition_variable start;
+    const std::function<void(const int *, const int *)> *task;
+    long generation;
+    bool stopping;
+
+    // Evaluate the part of every stage owned by thread t
+    void runStages(int t, const std::function<void(const int *, const int *)> &body)
+    {
+        for (int s = 0; s + 1 < stage_start.size(); ++s)
+        {
+            int begin = stage_start[s], end = stage_start[s + 1];
+
+            if (stage_parallel[s])
+            {
+                long size = end - begin;
+                body(gates.data() + begin + size * t / num_threads, gates.data() + begin + size * (t + 1) / num_threads);
+            }
+            else if (t == 0)
+            {
+                body(gates.data() + begin, gates.data() + end);
+            }
+
+            if (num_threads > 1)
+            {
+                barrier.wait();
+            }
+        }
+    }
+
+    void workerLoop(int t)
+    {
+        long seen = 0;
+
+        while (true)
+        {
+            const std::function<void(const int *, const int *)> *current;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                start.wait(lock, [this, seen]()
+                           { return stopping || generation != seen; });
+
+                if (stopping)
+                {
+                    return;
+                }
+
+                seen = generation;
+                current = task;
+            }
+
+            runStages(t, *current);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,520 @@
+#ifndef NETLIST_H
+#define NETLIST_H
+
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "Instrumentation.h"
+
+// Netlists read by part 2 and part 3, the nets and gates of a circuit and the batch manifests naming them
+class Net
+{
+
+public:
+    // Information about the Net
+    int id;
+
+    // Information about connected Gates
+    std::vector<int> gates_into;
+    int input;
+
+    // Value that the net carries
+    int value;
+
+    // Flag to indicate the precense of a fault value D/Dbar
+    int isFault;
+
+    // Value that the net carries in the faulty circuit
+    int faulty;
+
+    // Class constructor
+    Net(int value, int _id, int _input)
+    {
+        value = value;
+        id = _id;
+        input = _input;
+    }
+
+    // Default constructor
+    Net()
+    {
+        value = -1;
+        id = -1;
+        input = -1;
+        isFault = -1;
+        faulty = -1;
+    }
+};
+
+class Gate
+{
+
+public:
+    // Information about the gate
+    std::string type;
+    int id;
+
+    // Net information
+    std::vector<Net> input_nets;
+    Net output_net;
+
+    // Default constructor
+    Gate()
+    {
+        type = "";
+        id = -1;
+        input_nets = {};
+    }
+
+    // Class constructor for two input gates
+    Gate(std::string _type, int _id, Net in1, Net in2, Net out)
+    {
+        type = _type;
+        id = _id;
+
+        input_nets.push_back(in1);
+        input_nets.push_back(in2);
+        output_net = out;
+    }
+
+    // Class constructor for one input gates
+    Gate(std::string _type, int _id, Net in1, Net out)
+    {
+        type = _type;
+        id = _id;
+
+        input_nets.push_back(in1);
+        output_net = out;
+    }
+};
+
+
+class Circuit
+{
+
+public:
+    // Lists of the Gates and Nets in the circuit
+    std::vector<Gate> gate_list;
+    std::vector<Net> net_list;
+
+    // Lists of the primary inputs and outputs of the circuit
+    std::vector<int> input_list;
+    std::vector<int> output_list;
+
+    // Flip-flops as (D net, Q net) pairs, the Q nets have no driving gate
+    // Sequential simulation clocks them, test generation treats them as scan cells
+    std::vector<std::pair<int, int>> dff_list;
+};
+
+// Net of the given id in the table of the nets being parsed, the table is indexed by the id
+// The net is created on first use, so every lookup takes constant time
+inline Net &addNet(std::vector<Net> &net_table, int id)
+{
+    if (id >= net_table.size())
+    {
+        net_table.resize(id + 1);
+    }
+
+    Net &net = net_table[id];
+    if (net.id == -1)
+    {
+        net.id = id;
+        net.isFault = 0;
+    }
+
+    return net;
+}
+
+// Reorder the gates so that every gate comes after the gates driving its inputs
+// The gate ids and the references to them in the nets are renumbered to match
+inline void levelize(Circuit &circuit)
+{
+    INSTRUMENT_PHASE(PHASE_LEVELIZE);
+
+    std::vector<Gate> &gate_list = circuit.gate_list;
+    std::vector<Net> &net_list = circuit.net_list;
+
+    // Number of inputs of every gate driven by a gate which has not been placed yet
+    std::vector<int> pending(gate_list.size(), 0);
+    for (int j = 0; j < gate_list.size(); ++j)
+    {
+        for (int k = 0; k < gate_list[j].input_nets.size(); ++k)
+        {
+            if (net_list[gate_list[j].input_nets[k].id - 1].input != -1)
+            {
+                pending[j]++;
+            }
+        }
+    }
+
+    // Place the gates driven only by primary inputs first
+    std::vector<int> order;
+    for (int j = 0; j < gate_list.size(); ++j)
+    {
+        if (pending[j] == 0)
+        {
+            order.push_back(j);
+        }
+    }
+
+    // Place a gate once all the gates driving it have been placed
+    for (int i = 0; i < order.size(); ++i)
+    {
+        Net &out = net_list[gate_list[order[i]].output_net.id - 1];
+
+        for (int k = 0; k < out.gates_into.size(); ++k)
+        {
+            if (--pending[out.gates_into[k]] == 0)
+            {
+                order.push_back(out.gates_into[k]);
+            }
+        }
+    }
+
+    // Gates on combinational loops can not be ordered, keep them at the end
+    for (int j = 0; j < gate_list.size(); ++j)
+    {
+        if (pending[j] > 0)
+        {
+            order.push_back(j);
+        }
+    }
+
+    // Renumber the gates
+    std::vector<int> new_id(gate_list.size());
+    std::vector<Gate> ordered;
+
+    for (int i = 0; i < order.size(); ++i)
+    {
+        new_id[order[i]] = i;
+        ordered.push_back(gate_list[order[i]]);
+        ordered[i].id = i;
+    }
+
+    for (int i = 0; i < net_list.size(); ++i)
+    {
+        for (int k = 0; k < net_list[i].gates_into.size(); ++k)
+        {
+            net_list[i].gates_into[k] = new_id[net_list[i].gates_into[k]];
+        }
+
+        if (net_list[i].input != -1)
+        {
+            net_list[i].input = new_id[net_list[i].input];
+        }
+    }
+
+    gate_list = ordered;
+}
+
+// Check the net ids of a netlist line, they have to be positive
+inline bool validNetIds(const std::string &filename, std::initializer_list<int> ids)
+{
+    for (int id : ids)
+    {
+        if (id < 1)
+        {
+            std::cerr << "Invalid net id " << id << " in the netlist " << filename << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Parse a netlist file into a circuit, returns false if the file cannot be opened or holds an invalid net id
+inline bool parseNetlist(const std::string &filename, Circuit &circuit)
+{
+    INSTRUMENT_PHASE(PHASE_PARSE);
+
+    std::ifstream fin(filename);
+
+    if (!fin.is_open())
+    {
+        std::cerr << "Unable to open the netlist " << filename << std::endl;
+        return false;
+    }
+
+    // References to the lists being populated
+    std::vector<Gate> &gate_list = circuit.gate_list;
+    std::vector<Net> &net_list = circuit.net_list;
+    std::vector<int> &input_list = circuit.input_list;
+    std::vector<int> &output_list = circuit.output_list;
+
+    // Parsing the Netlist
+
+    // Strings to store the input characters
+    std::string line;
+    std::string str1, str2, str3, str4;
+
+    // Variables to store the net IDs
+    int net_val1, net_val2, out_val;
+
+    // Variable to store the count of the gates (and to give an id)
+    int id = 0;
+
+    // Nets indexed by id while parsing, the entries of the ids which do not appear keep the id -1
+    std::vector<Net> net_table;
+
+    // Till the end of file
+    while (getline(fin, line))
+    {
+        std::stringstream ss(line);
+
+        // Skip empty lines, they would repeat the previous gate
+        if (!(ss >> str1))
+        {
+            continue;
+        }
+
+        // If GATE
+        if (str1 == "INV" || str1 == "BUF")
+        {
+            // Get the rest of the parameters as input
+            ss >> str2 >> str3;
+
+            net_val1 = std::stoi(str2);
+            out_val = std::stoi(str3);
+
+            // Connect the nets, the copies kept by the gate only carry the id
+            if (!validNetIds(filename, {net_val1, out_val}))
+            {
+                return false;
+            }
+
+            Net &net1 = addNet(net_table, net_val1);
+            net1.gates_into.push_back(id);
+            Net in1;
+            in1.id = net_val1;
+
+            Net &net_out = addNet(net_table, out_val);
+            net_out.input = id;
+            Net out;
+            out.id = out_val;
+
+            // Create a gate object and instantiate with the above values
+            Gate g(str1, id, in1, out);
+            gate_list.push_back(g);
+
+            id++;
+        }
+        else if (str1 == "AND" || str1 == "OR" || str1 == "NOR" || str1 == "NAND")
+        {
+            // Get the rest of the parameters as input
+            ss >> str2 >> str3 >> str4;
+
+            net_val1 = std::stoi(str2);
+            net_val2 = std::stoi(str3);
+            out_val = std::stoi(str4);
+
+            // Connect the nets, the copies kept by the gate only carry the id
+            if (!validNetIds(filename, {net_val1, net_val2, out_val}))
+            {
+                return false;
+            }
+
+            Net &net1 = addNet(net_table, net_val1);
+            net1.gates_into.push_back(id);
+            Net in1;
+            in1.id = net_val1;
+
+            Net &net2 = addNet(net_table, net_val2);
+            net2.gates_into.push_back(id);
+            Net in2;
+            in2.id = net_val2;
+
+            Net &net_out = addNet(net_table, out_val);
+            net_out.input = id;
+            Net out;
+            out.id = out_val;
+
+            // Create a gate object and instantiate with the above values
+            Gate g(str1, id, in1, in2, out);
+            gate_list.push_back(g);
+
+            id++;
+        }
+        // If flip-flop, DFF <D net> <Q net>
+        else if (str1 == "DFF")
+        {
+            ss >> str2 >> str3;
+
+            net_val1 = std::stoi(str2);
+            out_val = std::stoi(str3);
+
+            if (!validNetIds(filename, {net_val1, out_val}))
+            {
+                return false;
+            }
+
+            addNet(net_table, net_val1);
+            addNet(net_table, out_val);
+
+            circuit.dff_list.push_back(std::make_pair(net_val1, out_val));
+        }
+        // If INPUT
+        else if (str1 == "INPUT")
+        {
+            int num;
+            while (ss >> num && num != -1)
+            {
+                // A net no gate reads or drives still needs its entry
+                if (!validNetIds(filename, {num}))
+                {
+                    return false;
+                }
+
+                addNet(net_table, num);
+                input_list.push_back(num);
+            }
+        }
+        // If OUTPUT
+        else if (str1 == "OUTPUT")
+        {
+            int num;
+            while (ss >> num && num != -1)
+            {
+                if (!validNetIds(filename, {num}))
+                {
+                    return false;
+                }
+
+                addNet(net_table, num);
+                output_list.push_back(num);
+            }
+        }
+        // If Invalid character in netlist, do nothing
+        else
+        {
+            std ::cout << "Invalid Input, will be ignored" << std::endl;
+        }
+    }
+
+    fin.close();
+
+    // Keep the nets which appear in the netlist, in order of the id
+    for (int i = 1; i < net_table.size(); ++i)
+    {
+        if (net_table[i].id != -1)
+        {
+            net_list.push_back(std::move(net_table[i]));
+        }
+    }
+
+    levelize(circuit);
+
+    return true;
+}
+
+// Netlists parsed so far, shared by all the jobs of a batch or of a server
+class NetlistCache
+{
+
+public:
+    // Fetch a parsed netlist, parsing the file on first use and again once it was modified
+    // Returns a null pointer if the netlist cannot be read
+    std::shared_ptr<const Circuit> get(const std::string &filename)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        struct stat info;
+        long long modified = stat(filename.c_str(), &info) == 0 ? info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec : -1;
+
+        auto it = circuits.find(filename);
+        if (it != circuits.end() && it->second.first == modified)
+        {
+            return it->second.second;
+        }
+
+        std::shared_ptr<Circuit> circuit = std::make_shared<Circuit>();
+        if (!parseNetlist(filename, *circuit))
+        {
+            circuit = nullptr;
+        }
+
+        circuits[filename] = std::make_pair(modified, circuit);
+
+        return circuit;
+    }
+
+private:
+    // Modification time in nanoseconds and the netlist parsed from it
+    std::map<std::string, std::pair<long long, std::shared_ptr<const Circuit>>> circuits;
+    std::mutex mutex;
+};
+
+// Derive the path of a file belonging to a netlist, eg. i_s27.txt for s27.txt
+inline std::string companionPath(const std::string &netlist, const std::string &prefix)
+{
+    size_t slash = netlist.find_last_of('/');
+
+    if (slash == std::string::npos)
+    {
+        return prefix + netlist;
+    }
+
+    return netlist.substr(0, slash + 1) + prefix + netlist.substr(slash + 1);
+}
+
+// Read a batch manifest, every non empty line holds the arguments of one job
+// Lines starting with # are comments, options given on the command line act as defaults
+// parse(args, job) fills in a copy of the defaults from the arguments of a line, it returns false if they are invalid
+template <class Job, class ParseJob>
+bool readManifest(const std::string &filename, const Job &defaults, std::vector<Job> &jobs, ParseJob parse)
+{
+    std::ifstream fmanifest(filename);
+
+    if (!fmanifest.is_open())
+    {
+        std::cerr << "Unable to open the batch manifest " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int line_number = 0;
+
+    while (getline(fmanifest, line))
+    {
+        line_number++;
+
+        // Split the line into arguments
+        std::stringstream ss(line);
+        std::vector<std::string> args;
+        std::string arg;
+
+        while (ss >> arg)
+        {
+            args.push_back(arg);
+        }
+
+        // Skip empty lines and comments
+        if (args.empty() || args[0][0] == '#')
+        {
+            continue;
+        }
+
+        Job job = defaults;
+
+        if (!parse(args, job))
+        {
+            std::cerr << "Invalid job on line " << line_number << " of " << filename << std::endl;
+            return false;
+        }
+
+        jobs.push_back(job);
+    }
+
+    return true;
+}
+
+#endif
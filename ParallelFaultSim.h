@@ -0,0 +1,422 @@
+#ifndef PARALLELFAULTSIM_H
+#define PARALLELFAULTSIM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "Fault.h"
+#include "CompiledCircuit.h"
+#include "Instrumentation.h"
+#include "LevelParallel.h"
+
+// Number of faulty machines simulated next to the good machine in one word
+const int FAULTS_PER_WORD = 63;
+
+// Parallel fault simulation of one pattern at a time
+// Bit 0 of every word holds the good machine and bits 1 to 63 hold faulty machines,
+// each fault is injected through force masks on its net or gate input pin
+class ParallelFaultSimulator
+{
+
+public:
+    // Class constructor, the circuit and the sites have to outlive the simulator
+    ParallelFaultSimulator(const CompiledCircuit &_circuit, const FaultSites &_sites) : circuit(_circuit), sites(_sites)
+    {
+        executor = nullptr;
+        values.assign(circuit.num_nets, 0);
+        net_keep.assign(circuit.num_nets, ~0ULL);
+        net_set.assign(circuit.num_nets, 0);
+        pin_keep.assign(2 * circuit.gates.size(), ~0ULL);
+        pin_set.assign(2 * circuit.gates.size(), 0);
+    }
+
+    // Simulate one pattern, given as the 0/1 value of every primary input, against a set of faults
+    // targets lists the positions in faults to simulate, the detected ones are returned in detected
+    void simulate(const std::vector<int> &pattern, const std::vector<Fault> &faults, const std::vector<int> &targets, std::vector<int> &detected)
+    {
+        detected.clear();
+
+        for (int first = 0; first < targets.size(); first += FAULTS_PER_WORD)
+        {
+            int count = std::min((int)targets.size() - first, FAULTS_PER_WORD);
+
+            // Inject the faults of the group, fault i of the group goes to bit i + 1
+            for (int i = 0; i < count; ++i)
+            {
+                inject(faults[targets[first + i]], 1ULL << (i + 1), true);
+            }
+
+            uint64_t diff = simulateWord(pattern);
+
+            for (int i = 0; i < count; ++i)
+            {
+                if ((diff >> (i + 1)) & 1)
+                {
+                    detected.push_back(targets[first + i]);
+                }
+
+                inject(faults[targets[first + i]], 1ULL << (i + 1), false);
+            }
+        }
+    }
+
+    // Evaluate every pattern level by level on the threads of an executor built for the same circuit, nullptr for one thread
+    void useExecutor(LevelParallelExecutor *_executor)
+    {
+        executor = _executor;
+    }
+
+private:
+    const CompiledCircuit &circuit;
+    const FaultSites &sites;
+    LevelParallelExecutor *executor;
+
+    // Values of the nets and the force masks of the nets and gate input pins
+    std::vector<uint64_t> values;
+    std::vector<uint64_t> net_keep, net_set;
+    std::vector<uint64_t> pin_keep, pin_set;
+
+    // Set or clear the force masks of a fault in the given bit
+    void inject(const Fault &fault, uint64_t bit, bool enable)
+    {
+        int site = sites.siteOf(fault);
+
+        if (site == -1)
+        {
+            return;
+        }
+
+        if (site < sites.num_nets)
+        {
+            force(net_keep[site], net_set[site], fault.value, bit, enable);
+            return;
+        }
+
+        // A branch fault is forced on every pin of the gate reading the net
+        int g = sites.branch_gate[site - sites.num_nets];
+        for (int k = 0; k < 2; ++k)
+        {
+            if (sites.branch_site[2 * g + k] == site)
+            {
+                force(pin_keep[2 * g + k], pin_set[2 * g + k], fault.value, bit, enable);
+            }
+        }
+    }
+
+    // Set or clear the force of a value in the given bit of a pair of masks
+    static void force(uint64_t &keep, uint64_t &set, int value, uint64_t bit, bool enable)
+    {
+        if (enable)
+        {
+            keep &= ~bit;
+            if (value)
+            {
+                set |= bit;
+            }
+        }
+        else
+        {
+            keep |= bit;
+            set &= ~bit;
+        }
+    }
+
+    // Simulate the pattern on all the machines, returns the machines differing from the good one at an output
+    uint64_t simulateWord(const std::vector<int> &pattern)
+    {
+        for (int i = 0; i < circuit.inputs.size(); ++i)
+        {
+            int n = circuit.inputs[i];
+            values[n] = ((pattern[i] ? ~0ULL : 0) & net_keep[n]) | net_set[n];
+        }
+
+        if (executor != nullptr)
+        {
+            executor->run([this](const int *first, const int *last)
+                          { evaluateGates(first, last); });
+        }
+        else
+        {
+            for (int j = 0; j < circuit.gates.size(); ++j)
+            {
+                const CompiledGate &g = circuit.gates[j];
+
+                uint64_t a = (values[g.in1] & pin_keep[2 * j]) | pin_set[2 * j];
+                uint64_t b = (values[g.in2] & pin_keep[2 * j + 1]) | pin_set[2 * j + 1];
+
+                values[g.out] = (evaluateWord(g.op, a, b) & net_keep[g.out]) | net_set[g.out];
+            }
+        }
+        INSTRUMENT_COUNT(COUNTER_GATE_EVALS, circuit.gates.size());
+
+        uint64_t diff = 0;
+
+        for (int i = 0; i < circuit.outputs.size(); ++i)
+        {
+            uint64_t v = values[circuit.outputs[i]];
+            diff |= v ^ (0 - (v & 1));
+        }
+
+        return diff;
+    }
+
+    // Evaluate a range of gates given by index with the force masks applied
+    void evaluateGates(const int *first, const int *last)
+    {
+        for (const int *p = first; p != last; ++p)
+        {
+            int j = *p;
+            const CompiledGate &g = circuit.gates[j];
+
+            uint64_t a = (values[g.in1] & pin_keep[2 * j]) | pin_set[2 * j];
+            uint64_t b = (values[g.in2] & pin_keep[2 * j + 1]) | pin_set[2 * j + 1];
+
+            values[g.out] = (evaluateWord(g.op, a, b) & net_keep[g.out]) | net_set[g.out];
+        }
+    }
+};
+
+// Parallel pattern single fault propagation
+// Up to 64 patterns are simulated at once, pattern p in bit p of every word. The good machine is simulated
+// once per chunk and every fault is then propagated through its fanout cone, starting from the patterns
+// in which the fault is activated
+class PatternParallelFaultSimulator
+{
+
+public:
+    // Good machine values of every net for the last simulated chunk
+    std::vector<uint64_t> good;
+
+    // Class constructor, the circuit and the sites have to outlive the simulator
+    PatternParallelFaultSimulator(const CompiledCircuit &_circuit, const FaultSites &_sites) : circuit(_circuit), sites(_sites)
+    {
+        executor = nullptr;
+        good.assign(circuit.num_nets, 0);
+        faulty.assign(circuit.num_nets, 0);
+        changed.assign(circuit.num_nets, 0);
+        is_output.assign(circuit.num_nets, 0);
+        scheduled.assign(circuit.gates.size(), 0);
+        fanout.resize(circuit.num_nets);
+
+        for (int j = 0; j < circuit.gates.size(); ++j)
+        {
+            fanout[circuit.gates[j].in1].push_back(j);
+            if (circuit.gates[j].in2 != circuit.gates[j].in1)
+            {
+                fanout[circuit.gates[j].in2].push_back(j);
+            }
+        }
+
+        for (int i = 0; i < circuit.outputs.size(); ++i)
+        {
+            is_output[circuit.outputs[i]] = 1;
+        }
+
+        // Every net is touched and every gate queued at most once per fault, so detect never allocates
+        touched.reserve(circuit.num_nets);
+        std::vector<int> storage;
+        storage.reserve(circuit.gates.size());
+        queue = std::priority_queue<int, std::vector<int>, std::greater<int>>(std::greater<int>(), std::move(storage));
+    }
+
+    // Simulate the good machine for a chunk of patterns, one word per primary input
+    void simulateGood(const std::vector<uint64_t> &inputs)
+    {
+        simulateGood(inputs.data());
+    }
+
+    void simulateGood(const uint64_t *inputs)
+    {
+        for (int i = 0; i < circuit.inputs.size(); ++i)
+        {
+            good[circuit.inputs[i]] = inputs[i];
+        }
+
+        if (executor != nullptr)
+        {
+            executor->run([this](const int *first, const int *last)
+                          {
+                for (const int *p = first; p != last; ++p)
+                {
+                    const CompiledGate &g = circuit.gates[*p];
+                    good[g.out] = evaluateWord(g.op, good[g.in1], good[g.in2]);
+                } });
+        }
+        else
+        {
+            for (int j = 0; j < circuit.gates.size(); ++j)
+            {
+                const CompiledGate &g = circuit.gates[j];
+                good[g.out] = evaluateWord(g.op, good[g.in1], good[g.in2]);
+            }
+        }
+        INSTRUMENT_COUNT(COUNTER_GATE_EVALS, circuit.gates.size());
+    }
+
+    // Simulate the good machine level by level on the threads of an executor built for the same circuit, nullptr for one thread
+    void useExecutor(LevelParallelExecutor *_executor)
+    {
+        executor = _executor;
+    }
+
+    // Patterns of the last chunk which detect the line of the fault stuck at its value, limited to mask
+    uint64_t detect(const Fault &fault, uint64_t mask)
+    {
+        uint64_t activated = propagate(fault, mask);
+
+        if (activated == 0)
+        {
+            return 0;
+        }
+
+        // Collect the differences at the outputs and clear the scratch state
+        uint64_t result = 0;
+
+        for (int i = 0; i < touched.size(); ++i)
+        {
+            if (is_output[touched[i]])
+            {
+                result |= faulty[touched[i]] ^ good[touched[i]];
+            }
+            changed[touched[i]] = 0;
+        }
+
+        return result & activated;
+    }
+
+    // Like detect, but diff receives for every primary output the patterns in which the fault flips it
+    // Returns the patterns detecting the fault, the union of diff
+    uint64_t detectOutputs(const Fault &fault, uint64_t mask, uint64_t *diff)
+    {
+        uint64_t activated = propagate(fault, mask);
+        uint64_t result = 0;
+
+        for (int i = 0; i < circuit.outputs.size(); ++i)
+        {
+            int n = circuit.outputs[i];
+            diff[i] = activated != 0 ? (value(n) ^ good[n]) & activated : 0;
+            result |= diff[i];
+        }
+
+        for (int i = 0; i < touched.size(); ++i)
+        {
+            changed[touched[i]] = 0;
+        }
+
+        return result;
+    }
+
+private:
+    const CompiledCircuit &circuit;
+    const FaultSites &sites;
+    LevelParallelExecutor *executor;
+
+    // Gates fed by every net and the primary output flags
+    std::vector<std::vector<int>> fanout;
+    std::vector<char> is_output;
+
+    // Scratch state of the single fault propagation
+    std::vector<uint64_t> faulty;
+    std::vector<char> changed;
+    std::vector<char> scheduled;
+    std::vector<int> touched;
+    std::priority_queue<int, std::vector<int>, std::greater<int>> queue;
+
+    // Value of a net in the faulty machine
+    uint64_t value(int n) const
+    {
+        return changed[n] ? faulty[n] : good[n];
+    }
+
+    // Flip the line of the fault in the patterns of mask activating it and propagate the faulty values
+    // Returns the activated patterns, the changed nets are left in touched for the caller to collect and clear
+    uint64_t propagate(const Fault &fault, uint64_t mask)
+    {
+        touched.clear();
+
+        int site = sites.siteOf(fault);
+
+        if (site == -1)
+        {
+            return 0;
+        }
+
+        int n = fault.net_id - 1;
+
+        // The patterns which activate the fault, the line is flipped in these patterns only
+        uint64_t activated = (fault.value ? ~good[n] : good[n]) & mask;
+
+        if (activated == 0)
+        {
+            return 0;
+        }
+
+        if (site < sites.num_nets)
+        {
+            change(n, good[n] ^ activated);
+        }
+        else
+        {
+            // Fanout branch, only the input pin of the gate is flipped
+            int j = sites.branch_gate[site - sites.num_nets];
+            const CompiledGate &g = circuit.gates[j];
+
+            uint64_t a = good[g.in1], b = good[g.in2];
+            if (sites.branch_site[2 * j] == site)
+            {
+                a ^= activated;
+            }
+            if (sites.branch_site[2 * j + 1] == site)
+            {
+                b ^= activated;
+            }
+
+            uint64_t v = evaluateWord(g.op, a, b);
+            if (v != good[g.out])
+            {
+                change(g.out, v);
+            }
+        }
+
+        while (!queue.empty())
+        {
+            int j = queue.top();
+            queue.pop();
+            scheduled[j] = 0;
+
+            const CompiledGate &g = circuit.gates[j];
+            uint64_t v = evaluateWord(g.op, value(g.in1), value(g.in2));
+            INSTRUMENT_COUNT(COUNTER_GATE_EVALS, 1);
+
+            if (v != good[g.out])
+            {
+                change(g.out, v);
+            }
+        }
+
+        return activated;
+    }
+
+    // Record a faulty value which differs from the good one and schedule the gates it feeds
+    void change(int n, uint64_t v)
+    {
+        faulty[n] = v;
+        changed[n] = 1;
+        touched.push_back(n);
+
+        for (int k = 0; k < fanout[n].size(); ++k)
+        {
+            int g = fanout[n][k];
+            if (!scheduled[g])
+            {
+                scheduled[g] = 1;
+                queue.push(g);
+            }
+        }
+    }
+};
+
+#endif
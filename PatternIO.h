@@ -0,0 +1,364 @@
+#ifndef PATTERNIO_H
+#define PATTERNIO_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Size of the user space buffers used for reading and writing files
+const size_t IO_BUFFER_SIZE = 1 << 20;
+
+// Number of patterns packed into one chunk, one pattern per bit of a word
+const int PATTERNS_PER_CHUNK = 64;
+
+// Streaming reader for pattern files with one pattern per line
+// Patterns are read in chunks of up to 64 and packed into one word per input,
+// pattern p of the chunk is held in bit p of every word
+class PatternReader
+{
+
+public:
+    // Class constructor, opens the file for a circuit with the given number of inputs
+    PatternReader(const std::string &filename, int _num_inputs) : PatternReader(std::fopen(filename.c_str(), "rb"), _num_inputs)
+    {
+    }
+
+    // Class constructor, reads from a stream opened by the caller and closed with the reader, eg. a socket
+    PatternReader(FILE *_file, int _num_inputs)
+    {
+        file = _file;
+        num_inputs = _num_inputs;
+        buffer.resize(IO_BUFFER_SIZE);
+        pos = 0;
+        end = 0;
+        line_invalid = false;
+        invalid_lines = 0;
+        short_lines = 0;
+        long_lines = 0;
+    }
+
+    ~PatternReader()
+    {
+        if (file != nullptr)
+        {
+            std::fclose(file);
+        }
+    }
+
+    bool isOpen() const
+    {
+        return file != nullptr;
+    }
+
+    // Number of lines ignored because they hold a character other than 0, 1 and blanks
+    int skippedInvalid() const
+    {
+        return invalid_lines;
+    }
+
+    // Number of lines ignored because they hold fewer bits than a pattern
+    int skippedShort() const
+    {
+        return short_lines;
+    }
+
+    // Number of lines ignored because they hold more bits than a pattern
+    int skippedLong() const
+    {
+        return long_lines;
+    }
+
+    // Read the next chunk of patterns into words, resized to one word per input
+    // Returns the number of patterns in the chunk, 0 once the file is exhausted
+    int readChunk(std::vector<uint64_t> &words)
+    {
+        words.assign(num_inputs, 0);
+
+        int count = 0;
+        std::vector<char> bits;
+
+        while (count < PATTERNS_PER_CHUNK && readLine(bits))
+        {
+            // Skip empty lines
+            if (bits.empty() && !line_invalid)
+            {
+                continue;
+            }
+
+            // A pattern must assign every input exactly once
+            if (!accept(bits, num_inputs))
+            {
+                continue;
+            }
+
+            for (int i = 0; i < num_inputs; ++i)
+            {
+                words[i] |= (uint64_t)bits[i] << count;
+            }
+
+            count++;
+        }
+
+        return count;
+    }
+
+    // Read the next chunk of pattern pairs, every line holds the first vector followed by the second one,
+    // eg. "0110 1010", the vectors are packed like in readChunk
+    // Returns the number of pairs in the chunk, 0 once the file is exhausted
+    int readPairChunk(std::vector<uint64_t> &first, std::vector<uint64_t> &second)
+    {
+        first.assign(num_inputs, 0);
+        second.assign(num_inputs, 0);
+
+        int count = 0;
+        std::vector<char> bits;
+
+        while (count < PATTERNS_PER_CHUNK && readLine(bits))
+        {
+            if (bits.empty() && !line_invalid)
+            {
+                continue;
+            }
+
+            if (!accept(bits, 2 * num_inputs))
+            {
+                continue;
+            }
+
+            for (int i = 0; i < num_inputs; ++i)
+            {
+                first[i] |= (uint64_t)bits[i] << count;
+                second[i] |= (uint64_t)bits[num_inputs + i] << count;
+            }
+
+            count++;
+        }
+
+        return count;
+    }
+
+    // Read the next chunk of up to 64 sequences, the sequences are separated by empty lines
+    // Frame t of sequence s is packed into bit s of frames[t], one word per input,
+    // and bit s of active[t] is set if sequence s is long enough to have frame t
+    // lengths receives the number of frames of every sequence, the return value is the number of sequences
+    int readSequenceChunk(std::vector<std::vector<uint64_t>> &frames, std::vector<uint64_t> &active, std::vector<int> &lengths)
+    {
+        frames.clear();
+        active.clear();
+        lengths.clear();
+
+        std::vector<char> bits;
+        bool more = true;
+
+        while (lengths.size() < PATTERNS_PER_CHUNK && more)
+        {
+            int s = lengths.size();
+            int length = 0;
+
+            // Read the lines of one sequence
+            while ((more = readLine(bits)) && (!bits.empty() || line_invalid))
+            {
+                if (!accept(bits, num_inputs))
+                {
+                    continue;
+                }
+
+                if (frames.size() <= length)
+                {
+                    frames.push_back(std::vector<uint64_t>(num_inputs, 0));
+                    active.push_back(0);
+                }
+
+                for (int i = 0; i < num_inputs; ++i)
+                {
+                    frames[length][i] |= (uint64_t)bits[i] << s;
+                }
+                active[length] |= 1ULL << s;
+
+                length++;
+            }
+
+            // Several empty lines in a row do not make empty sequences
+            if (length > 0)
+            {
+                lengths.push_back(length);
+            }
+        }
+
+        return lengths.size();
+    }
+
+    // Read one line and collect its 0/1 characters, any other character than blanks marks the line invalid
+    // Returns false at the end of the file
+    bool readLine(std::vector<char> &bits)
+    {
+        bits.clear();
+        line_invalid = false;
+        bool found = false;
+
+        while (true)
+        {
+            // Refill the buffer when it runs out
+            if (pos == end)
+            {
+                if (file == nullptr)
+                {
+                    return found;
+                }
+
+                end = std::fread(buffer.data(), 1, buffer.size(), file);
+                pos = 0;
+
+                if (end == 0)
+                {
+                    return found;
+                }
+            }
+
+            char c = buffer[pos++];
+            found = true;
+
+            if (c == '\n')
+            {
+                return true;
+            }
+            else if (c == '0' || c == '1')
+            {
+                bits.push_back(c - '0');
+            }
+            else if (c != ' ' && c != '\t' && c != '\r')
+            {
+                line_invalid = true;
+            }
+        }
+    }
+
+private:
+    FILE *file;
+    int num_inputs;
+
+    // Read buffer and the unread range inside it
+    std::vector<char> buffer;
+    size_t pos, end;
+
+    // The last line read holds an invalid character
+    bool line_invalid;
+
+    int invalid_lines;
+    int short_lines;
+    int long_lines;
+
+    // Check a non empty line against the number of bits of a pattern, counting it by the reason if it is rejected
+    bool accept(const std::vector<char> &bits, int width)
+    {
+        if (line_invalid)
+        {
+            invalid_lines++;
+            return false;
+        }
+        if (bits.size() < width)
+        {
+            short_lines++;
+            return false;
+        }
+        if (bits.size() > width)
+        {
+            long_lines++;
+            return false;
+        }
+        return true;
+    }
+};
+
+// Output file with a large user space buffer which is only flushed when full or on close
+class BufferedWriter
+{
+
+public:
+    // Class constructor, truncates the file unless append is set
+    BufferedWriter(const std::string &filename, bool append = false)
+    {
+        file = std::fopen(filename.c_str(), append ? "ab" : "wb");
+        buffer.reserve(IO_BUFFER_SIZE);
+    }
+
+    ~BufferedWriter()
+    {
+        close();
+    }
+
+    bool isOpen() const
+    {
+        return file != nullptr;
+    }
+
+    void write(const char *data, size_t size)
+    {
+        if (buffer.size() + size > IO_BUFFER_SIZE)
+        {
+            flush();
+        }
+
+        buffer.append(data, size);
+    }
+
+    void write(const std::string &text)
+    {
+        write(text.data(), text.size());
+    }
+
+    void writeChar(char c)
+    {
+        if (buffer.size() + 1 > IO_BUFFER_SIZE)
+        {
+            flush();
+        }
+
+        buffer.push_back(c);
+    }
+
+    // Write an integer as decimal text
+    void writeInt(long long value)
+    {
+        char digits[24];
+        int length = std::snprintf(digits, sizeof(digits), "%lld", value);
+        write(digits, length);
+    }
+
+    // Write a 32 bit value in little endian byte order
+    void writeU32(uint32_t value)
+    {
+        char bytes[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            bytes[i] = (value >> (8 * i)) & 0xFF;
+        }
+        write(bytes, 4);
+    }
+
+    void flush()
+    {
+        if (file != nullptr && !buffer.empty())
+        {
+            std::fwrite(buffer.data(), 1, buffer.size(), file);
+        }
+        buffer.clear();
+    }
+
+    void close()
+    {
+        if (file != nullptr)
+        {
+            flush();
+            std::fclose(file);
+            file = nullptr;
+        }
+    }
+
+private:
+    FILE *file;
+    std::string buffer;
+};
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef SATATPG_H
+#define SATATPG_H
+
+#include <string>
+#include <vector>
+
+#include "Fault.h"
+#include "CompiledCircuit.h"
+#include "SatSolver.h"
+
+// SAT based test generation for single stuck at faults
+// The good circuit is encoded for the fanin of the outputs the fault can reach and the faulty circuit for the
+// fanout cone of the fault site, both with Tseitin clauses. A miter requires one of these outputs to differ,
+// so a satisfying assignment of the inputs is a test and an unsatisfiable instance proves the fault untestable
+class SatTestGenerator
+{
+
+public:
+    // Class constructor, the circuit and the sites have to outlive the generator
+    SatTestGenerator(const CompiledCircuit &_circuit, const FaultSites &_sites) : circuit(_circuit), sites(_sites)
+    {
+        last_conflicts = 0;
+    }
+
+    // Generate a test for the fault, giving up after conflict_limit conflicts (0 for no limit)
+    // On success test holds one character per primary input, X for the inputs outside the encoded fanin
+    SatStatus generate(const Fault &fault, long conflict_limit, std::string &test)
+    {
+        int site = sites.siteOf(fault);
+        last_conflicts = 0;
+
+        if (site == -1)
+        {
+            return SAT_UNKNOWN;
+        }
+
+        int n = fault.net_id - 1;
+        int fault_gate = -1, fault_pin = -1;
+
+        if (site >= sites.num_nets)
+        {
+            fault_gate = sites.branch_gate[site - sites.num_nets];
+            fault_pin = sites.branch_site[2 * fault_gate] == site ? 0 : 1;
+        }
+
+        // Fanout cone of the fault site, the gates are in topological order
+        std::vector<char> in_cone(circuit.num_nets, 0);
+
+        if (fault_gate == -1)
+        {
+            in_cone[n] = 1;
+        }
+
+        for (int j = 0; j < circuit.gates.size(); ++j)
+        {
+            const CompiledGate &g = circuit.gates[j];
+            if (j == fault_gate || in_cone[g.in1] || in_cone[g.in2])
+            {
+                in_cone[g.out] = 1;
+            }
+        }
+
+        // Outputs the fault effect can reach
+        std::vector<int> cone_outputs;
+        for (int i = 0; i < circuit.outputs.size(); ++i)
+        {
+            if (in_cone[circuit.outputs[i]])
+            {
+                cone_outputs.push_back(circuit.outputs[i]);
+            }
+        }
+
+        if (cone_outputs.empty())
+        {
+            return SAT_UNSATISFIABLE;
+        }
+
+        // Fanin of these outputs and of the fault site, the only nets needed in the good circuit
+        std::vector<char> needed(circuit.num_nets, 0);
+        needed[n] = 1;
+        for (int i = 0; i < cone_outputs.size(); ++i)
+        {
+            needed[cone_outputs[i]] = 1;
+        }
+
+        for (int j = (int)circuit.gates.size() - 1; j >= 0; --j)
+        {
+            const CompiledGate &g = circuit.gates[j];
+            if (needed[g.out])
+            {
+                needed[g.in1] = 1;
+                needed[g.in2] = 1;
+            }
+        }
+
+        SatSolver solver;
+        std::vector<int> good_var(circuit.num_nets, -1), faulty_var(circuit.num_nets, -1);
+
+        for (int i = 0; i < circuit.num_nets; ++i)
+        {
+            if (needed[i])
+            {
+                good_var[i] = solver.newVar();
+                faulty_var[i] = in_cone[i] ? solver.newVar() : good_var[i];
+            }
+        }
+
+        // Variable holding the stuck at value
+        int stuck = solver.newVar();
+        solver.addClause({SatSolver::literal(stuck, fault.value == 0)});
+
+        // Activate the fault, the good value of the line is the opposite of the stuck at value
+        solver.addClause({SatSolver::literal(good_var[n], fault.value == 1)});
+
+        if (fault_gate == -1)
+        {
+            equal(solver, faulty_var[n], stuck);
+        }
+
+        for (int j = 0; j < circuit.gates.size(); ++j)
+        {
+            const CompiledGate &g = circuit.gates[j];
+
+            if (!needed[g.out])
+            {
+                continue;
+            }
+
+            encodeGate(solver, g.op, good_var[g.in1], good_var[g.in2], good_var[g.out]);
+
+            // The faulty copy of the gates in the cone, the stuck at value replaces the faulty net or pin
+            if (in_cone[g.out] && !(fault_gate == -1 && g.out == n))
+            {
+                int a = faulty_var[g.in1], b = faulty_var[g.in2];
+
+                // A gate fed twice by the faulty branch sees the fault on both pins, as in PODEM
+                if (j == fault_gate)
+                {
+                    if (fault_pin == 0 || g.in1 == n)
+                    {
+                        a = stuck;
+                    }
+                    if (fault_pin == 1 || g.in2 == n)
+                    {
+                        b = stuck;
+                    }
+                }
+
+                encodeGate(solver, g.op, a, b, faulty_var[g.out]);
+            }
+        }
+
+        // Miter, one of the cone outputs differs between the good and the faulty circuit
+        std::vector<int> differs;
+        for (int i = 0; i < cone_outputs.size(); ++i)
+        {
+            int d = solver.newVar();
+            int gv = good_var[cone_outputs[i]], fv = faulty_var[cone_outputs[i]];
+
+            solver.addClause({SatSolver::literal(d, true), SatSolver::literal(gv, false), SatSolver::literal(fv, false)});
+            solver.addClause({SatSolver::literal(d, true), SatSolver::literal(gv, true), SatSolver::literal(fv, true)});
+            differs.push_back(SatSolver::literal(d, false));
+        }
+        solver.addClause(differs);
+
+        SatStatus status = solver.solve(conflict_limit);
+        last_conflicts = solver.numConflicts();
+
+        if (status == SAT_SATISFIABLE)
+        {
+            test.clear();
+            for (int i = 0; i < circuit.inputs.size(); ++i)
+            {
+                int v = good_var[circuit.inputs[i]];
+                test += v == -1 ? 'X' : (solver.modelValue(v) ? '1' : '0');
+            }
+        }
+
+        return status;
+    }
+
+    // Number of conflicts of the last call to generate
+    long lastConflicts() const
+    {
+        return last_conflicts;
+    }
+
+private:
+    const CompiledCircuit &circuit;
+    const FaultSites &sites;
+    long last_conflicts;
+
+    static void equal(SatSolver &solver, int a, int b)
+    {
+        solver.addClause({SatSolver::literal(a, true), SatSolver::literal(b, false)});
+        solver.addClause({SatSolver::literal(a, false), SatSolver::literal(b, true)});
+    }
+
+    // Tseitin clauses of out = op(a, b), the single input gates only use a
+    static void encodeGate(SatSolver &solver, int op, int a, int b, int out)
+    {
+        switch (op)
+        {
+        case OP_AND:
+        case OP_NAND:
+        {
+            bool inv = op == OP_NAND;
+            solver.addClause({SatSolver::literal(out, !inv), SatSolver::literal(a, false)});
+            solver.addClause({SatSolver::literal(out, !inv), SatSolver::literal(b, false)});
+            solver.addClause({SatSolver::literal(out, inv), SatSolver::literal(a, true), SatSolver::literal(b, true)});
+            break;
+        }
+        case OP_OR:
+        case OP_NOR:
+        {
+            bool inv = op == OP_NOR;
+            solver.addClause({SatSolver::literal(out, inv), SatSolver::literal(a, true)});
+            solver.addClause({SatSolver::literal(out, inv), SatSolver::literal(b, true)});
+            solver.addClause({SatSolver::literal(out, !inv), SatSolver::literal(a, false), SatSolver::literal(b, false)});
+            break;
+        }
+        case OP_INV:
+            solver.addClause({SatSolver::literal(out, false), SatSolver::literal(a, false)});
+            solver.addClause({SatSolver::literal(out, true), SatSolver::literal(a, true)});
+            break;
+        default:
+            equal(solver, out, a);
+            break;
+        }
+    }
+};
+
+#endif
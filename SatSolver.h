@@ -0,0 +1,528 @@
+#ifndef SATSOLVER_H
+#define SATSOLVER_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Result of a call to the solver
+enum SatStatus
+{
+    SAT_SATISFIABLE,
+    SAT_UNSATISFIABLE,
+    SAT_UNKNOWN
+};
+
+// Conflict driven clause learning SAT solver
+// Variables are numbered from 0, a literal is 2 * variable for the positive and 2 * variable + 1 for the
+// negated form. The solver uses two watched literals, first UIP learning, VSIDS branching with phase saving
+// and Luby restarts. Clauses can only be added before the first call to solve
+class SatSolver
+{
+
+public:
+    SatSolver()
+    {
+        ok = true;
+        qhead = 0;
+        var_inc = 1.0;
+        conflicts = 0;
+    }
+
+    // Literal of a variable, negated or not
+    static int literal(int v, bool negated)
+    {
+        return 2 * v + (negated ? 1 : 0);
+    }
+
+    int newVar()
+    {
+        int v = assigns.size();
+
+        assigns.push_back(-1);
+        level.push_back(0);
+        reason.push_back(-1);
+        activity.push_back(0.0);
+        polarity.push_back(0);
+        seen.push_back(0);
+        heap_index.push_back(-1);
+        watches.emplace_back();
+        watches.emplace_back();
+
+        heapInsert(v);
+
+        return v;
+    }
+
+    int numVars() const
+    {
+        return assigns.size();
+    }
+
+    // Number of conflicts of the last call to solve
+    long numConflicts() const
+    {
+        return conflicts;
+    }
+
+    // Add a clause, returns false once the clauses are known to be unsatisfiable
+    bool addClause(std::vector<int> lits)
+    {
+        if (!ok)
+        {
+            return false;
+        }
+
+        // Drop the false and repeated literals, skip satisfied clauses and tautologies
+        std::sort(lits.begin(), lits.end());
+
+        int size = 0;
+        for (int i = 0; i < lits.size(); ++i)
+        {
+            if (value(lits[i]) == 1 || (size > 0 && lits[i] == (lits[size - 1] ^ 1)))
+            {
+                return true;
+            }
+            if (value(lits[i]) == 0 || (size > 0 && lits[i] == lits[size - 1]))
+            {
+                continue;
+            }
+            lits[size++] = lits[i];
+        }
+        lits.resize(size);
+
+        if (lits.empty())
+        {
+            ok = false;
+        }
+        else if (lits.size() == 1)
+        {
+            assign(lits[0], -1);
+            ok = propagate() == -1;
+        }
+        else
+        {
+            attach(lits);
+        }
+
+        return ok;
+    }
+
+    // Search for a satisfying assignment, giving up after conflict_limit conflicts (0 for no limit)
+    SatStatus solve(long conflict_limit)
+    {
+        conflicts = 0;
+
+        if (!ok)
+        {
+            return SAT_UNSATISFIABLE;
+        }
+
+        long restart_conflicts = 0;
+        int restarts = 0;
+        std::vector<int> learnt;
+
+        while (true)
+        {
+            int confl = propagate();
+
+            if (confl != -1)
+            {
+                conflicts++;
+                restart_conflicts++;
+
+                // A conflict without decisions can not be resolved
+                if (decisionLevel() == 0)
+                {
+                    ok = false;
+                    return SAT_UNSATISFIABLE;
+                }
+
+                int backtrack_level = analyze(confl, learnt);
+                cancelUntil(backtrack_level);
+
+                if (learnt.size() == 1)
+                {
+                    assign(learnt[0], -1);
+                }
+                else
+                {
+                    assign(learnt[0], attach(learnt));
+                }
+
+                var_inc /= 0.95;
+
+                if (conflict_limit > 0 && conflicts >= conflict_limit)
+                {
+                    cancelUntil(0);
+                    return SAT_UNKNOWN;
+                }
+
+                if (restart_conflicts >= 100 * luby(restarts))
+                {
+                    restart_conflicts = 0;
+                    restarts++;
+                    cancelUntil(0);
+                }
+            }
+            else
+            {
+                // Branch on the unassigned variable with the highest activity
+                int v = -1;
+                while (!heap.empty())
+                {
+                    int top = heapPop();
+                    if (assigns[top] == -1)
+                    {
+                        v = top;
+                        break;
+                    }
+                }
+
+                // Every variable is assigned without conflict
+                if (v == -1)
+                {
+                    model = assigns;
+                    cancelUntil(0);
+                    return SAT_SATISFIABLE;
+                }
+
+                trail_lim.push_back(trail.size());
+                assign(literal(v, polarity[v] == 0), -1);
+            }
+        }
+    }
+
+    // Value of a variable in the last satisfying assignment
+    bool modelValue(int v) const
+    {
+        return model[v] == 1;
+    }
+
+private:
+    // False once a conflict has been found without decisions
+    bool ok;
+
+    // Clauses, the first two literals of every clause are watched
+    std::vector<std::vector<int>> clauses;
+    std::vector<std::vector<int>> watches;
+
+    // Value (-1 for unassigned), decision level and implying clause of every variable
+    std::vector<signed char> assigns;
+    std::vector<int> level;
+    std::vector<int> reason;
+
+    // Assigned literals in order, with the start of every decision level
+    std::vector<int> trail;
+    std::vector<int> trail_lim;
+    int qhead;
+
+    // Branching heuristic, the activity heap and the saved phases
+    std::vector<double> activity;
+    double var_inc;
+    std::vector<int> heap;
+    std::vector<int> heap_index;
+    std::vector<signed char> polarity;
+
+    std::vector<char> seen;
+    std::vector<signed char> model;
+    long conflicts;
+
+    int decisionLevel() const
+    {
+        return trail_lim.size();
+    }
+
+    // Value of a literal, -1 if its variable is unassigned
+    int value(int lit) const
+    {
+        int v = assigns[lit >> 1];
+        return v == -1 ? -1 : v ^ (lit & 1);
+    }
+
+    void assign(int lit, int from)
+    {
+        int v = lit >> 1;
+        assigns[v] = !(lit & 1);
+        level[v] = decisionLevel();
+        reason[v] = from;
+        trail.push_back(lit);
+    }
+
+    // Store a clause of at least two literals and watch its first two, returns its index
+    int attach(const std::vector<int> &lits)
+    {
+        int c = clauses.size();
+        clauses.push_back(lits);
+        watches[lits[0]].push_back(c);
+        watches[lits[1]].push_back(c);
+        return c;
+    }
+
+    // Undo the assignments above the given decision level
+    void cancelUntil(int target)
+    {
+        if (decisionLevel() <= target)
+        {
+            return;
+        }
+
+        for (int i = (int)trail.size() - 1; i >= trail_lim[target]; --i)
+        {
+            int v = trail[i] >> 1;
+            polarity[v] = assigns[v];
+            assigns[v] = -1;
+            reason[v] = -1;
+            if (heap_index[v] == -1)
+            {
+                heapInsert(v);
+            }
+        }
+
+        trail.resize(trail_lim[target]);
+        trail_lim.resize(target);
+        qhead = trail.size();
+    }
+
+    // Unit propagation, returns the index of a conflicting clause or -1
+    int propagate()
+    {
+        while (qhead < trail.size())
+        {
+            // The clauses watching the literal made false by the assignment
+            int false_lit = trail[qhead++] ^ 1;
+            std::vector<int> &ws = watches[false_lit];
+
+            int i = 0, j = 0;
+            while (i < ws.size())
+            {
+                int c = ws[i++];
+                std::vector<int> &lits = clauses[c];
+
+                if (lits[0] == false_lit)
+                {
+                    std::swap(lits[0], lits[1]);
+                }
+
+                // Already satisfied by the other watched literal
+                if (value(lits[0]) == 1)
+                {
+                    ws[j++] = c;
+                    continue;
+                }
+
+                // Look for a new literal to watch
+                bool moved = false;
+                for (int k = 2; k < lits.size(); ++k)
+                {
+                    if (value(lits[k]) != 0)
+                    {
+                        std::swap(lits[1], lits[k]);
+                        watches[lits[1]].push_back(c);
+                        moved = true;
+                        break;
+                    }
+                }
+
+                if (moved)
+                {
+                    continue;
+                }
+
+                ws[j++] = c;
+
+                if (value(lits[0]) == 0)
+                {
+                    // Conflict, keep the remaining watches
+                    while (i < ws.size())
+                    {
+                        ws[j++] = ws[i++];
+                    }
+                    ws.resize(j);
+                    qhead = trail.size();
+                    return c;
+                }
+
+                assign(lits[0], c);
+            }
+
+            ws.resize(j);
+        }
+
+        return -1;
+    }
+
+    // First UIP conflict analysis, returns the backtrack level
+    // learnt receives the learnt clause with the asserting literal first
+    int analyze(int confl, std::vector<int> &learnt)
+    {
+        learnt.assign(1, -1);
+
+        int pending = 0;
+        int p = -1;
+        int index = (int)trail.size() - 1;
+
+        do
+        {
+            const std::vector<int> &lits = clauses[confl];
+
+            // The implied literal of a reason clause is its first one
+            for (int k = (p == -1 ? 0 : 1); k < lits.size(); ++k)
+            {
+                int v = lits[k] >> 1;
+
+                if (!seen[v] && level[v] > 0)
+                {
+                    seen[v] = 1;
+                    bumpVar(v);
+
+                    if (level[v] >= decisionLevel())
+                    {
+                        pending++;
+                    }
+                    else
+                    {
+                        learnt.push_back(lits[k]);
+                    }
+                }
+            }
+
+            // Next literal of the current level on the trail
+            while (!seen[trail[index] >> 1])
+            {
+                index--;
+            }
+
+            p = trail[index--];
+            confl = reason[p >> 1];
+            seen[p >> 1] = 0;
+            pending--;
+        } while (pending > 0);
+
+        learnt[0] = p ^ 1;
+
+        // Put the literal of the highest remaining level second, it is watched after the backtrack
+        int backtrack_level = 0;
+
+        for (int k = 1; k < learnt.size(); ++k)
+        {
+            seen[learnt[k] >> 1] = 0;
+
+            if (level[learnt[k] >> 1] > backtrack_level)
+            {
+                backtrack_level = level[learnt[k] >> 1];
+                std::swap(learnt[1], learnt[k]);
+            }
+        }
+
+        return backtrack_level;
+    }
+
+    void bumpVar(int v)
+    {
+        activity[v] += var_inc;
+
+        // Rescale all the activities before they overflow
+        if (activity[v] > 1e100)
+        {
+            for (int i = 0; i < activity.size(); ++i)
+            {
+                activity[i] *= 1e-100;
+            }
+            var_inc *= 1e-100;
+        }
+
+        if (heap_index[v] != -1)
+        {
+            heapUp(heap_index[v]);
+        }
+    }
+
+    // Element x of the Luby restart sequence 1 1 2 1 1 2 4 ...
+    static double luby(int x)
+    {
+        int size = 1, seq = 0;
+
+        while (size < x + 1)
+        {
+            seq++;
+            size = 2 * size + 1;
+        }
+
+        while (size - 1 != x)
+        {
+            size = (size - 1) >> 1;
+            seq--;
+            x = x % size;
+        }
+
+        return std::pow(2.0, seq);
+    }
+
+    // Binary max heap of the variables ordered by activity
+    void heapInsert(int v)
+    {
+        heap_index[v] = heap.size();
+        heap.push_back(v);
+        heapUp(heap.size() - 1);
+    }
+
+    int heapPop()
+    {
+        int top = heap[0];
+        heap_index[top] = -1;
+
+        heap[0] = heap.back();
+        heap.pop_back();
+
+        if (!heap.empty())
+        {
+            heap_index[heap[0]] = 0;
+            heapDown(0);
+        }
+
+        return top;
+    }
+
+    void heapUp(int i)
+    {
+        int v = heap[i];
+
+        while (i > 0 && activity[heap[(i - 1) / 2]] < activity[v])
+        {
+            heap[i] = heap[(i - 1) / 2];
+            heap_index[heap[i]] = i;
+            i = (i - 1) / 2;
+        }
+
+        heap[i] = v;
+        heap_index[v] = i;
+    }
+
+    void heapDown(int i)
+    {
+        int v = heap[i];
+
+        while (2 * i + 1 < heap.size())
+        {
+            int child = 2 * i + 1;
+            if (child + 1 < heap.size() && activity[heap[child + 1]] > activity[heap[child]])
+            {
+                child++;
+            }
+            if (activity[heap[child]] <= activity[v])
+            {
+                break;
+            }
+
+            heap[i] = heap[child];
+            heap_index[heap[i]] = i;
+            i = child;
+        }
+
+        heap[i] = v;
+        heap_index[v] = i;
+    }
+};
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef SEARCHTRACE_H
+#define SEARCHTRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Binary trace of the test generation searches
+// Every thread appends fixed size records to its own ring buffer, so recording takes no lock and no formatting;
+// once the ring is full the oldest records are overwritten. The rings are written to a file at the end of the
+// run and turned back into text by the trace decoder. Nothing is recorded below the verbosity of a record kind
+
+// Kinds of records and the verbosity from which they are recorded
+enum TraceKind
+{
+    // Level 1, net = fault net, value = stuck at value, aux = output net of the gate of a branch fault or -1
+    TRACE_FAULT_BEGIN,
+    // Level 1, value = 1 test found, 0 undetectable, -1 aborted, aux = backtracks
+    TRACE_FAULT_END,
+    // Level 2, a primary input assigned by the search and the opposite value tried after a failure
+    TRACE_DECISION,
+    TRACE_BACKTRACK,
+    // Level 2, a primary input returned to X after both values failed
+    TRACE_RESET,
+    // Level 3, the objective of PODEM and the output the error reached
+    TRACE_OBJECTIVE,
+    TRACE_PROPAGATED,
+    // Level 3, an assignment simulated through the circuit, aux = gates evaluated
+    TRACE_IMPLICATION,
+    NUM_TRACE_KINDS
+};
+
+static const int TRACE_LEVELS[NUM_TRACE_KINDS] = {1, 1, 2, 2, 2, 3, 3, 3};
+
+// One trace record, 16 bytes
+// fault numbers the faults traced by the thread, so the records of a fault stay together when the ring wraps
+class TraceRecord
+{
+
+public:
+    uint8_t kind;
+    int8_t value;
+    uint16_t reserved;
+    int32_t net;
+    int32_t aux;
+    uint32_t fault;
+};
+
+// File layout, all values in the byte order of the writing machine
+// magic "ATPGTRC1", uint32 record size, uint32 number of threads, then for every thread
+// uint64 records written, uint32 records kept, and the kept records from the oldest
+static const char TRACE_MAGIC[8] = {'A', 'T', 'P', 'G', 'T', 'R', 'C', '1'};
+
+// Records kept per thread, a power of two
+const uint32_t TRACE_RING_SIZE = 1 << 16;
+
+// Ring buffer of one thread, only its own thread writes to it
+class TraceRing
+{
+
+public:
+    std::vector<TraceRecord> records;
+
+    // Records written so far, the last TRACE_RING_SIZE of them are kept
+    std::atomic<uint64_t> head;
+
+    // Number of the current fault of the thread
+    uint32_t fault;
+
+    TraceRing() : records(TRACE_RING_SIZE), head(0)
+    {
+        fault = 0;
+    }
+
+    void append(int kind, int value, int net, int aux)
+    {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        TraceRecord &r = records[h & (TRACE_RING_SIZE - 1)];
+
+        r.kind = kind;
+        r.value = value;
+        r.reserved = 0;
+        r.net = net;
+        r.aux = aux;
+        r.fault = fault;
+
+        head.store(h + 1, std::memory_order_release);
+    }
+};
+
+class SearchTrace
+{
+
+public:
+    // Verbosity of the run, 0 records nothing
+    static std::atomic<int> &level()
+    {
+        static std::atomic<int> value(0);
+        return value;
+    }
+
+    static bool enabled(int kind)
+    {
+        return TRACE_LEVELS[kind] <= level().load(std::memory_order_relaxed);
+    }
+
+    // Append a record to the ring of the calling thread if its kind is enabled
+    static void record(int kind, int value, int net, int aux = 0)
+    {
+        if (!enabled(kind))
+        {
+            return;
+        }
+
+        TraceRing &ring = local();
+
+        if (kind == TRACE_FAULT_BEGIN)
+        {
+            ring.fault++;
+        }
+
+        ring.append(kind, value, net, aux);
+    }
+
+    // Write the rings of every thread, returns false if the file cannot be written
+    // Call once the worker threads are idle
+    static bool write(const std::string &filename)
+    {
+        std::ofstream fout(filename, std::ios::binary);
+        if (!fout.is_open())
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex());
+        const std::vector<std::unique_ptr<TraceRing>> &list = rings();
+
+        uint32_t record_size = sizeof(TraceRecord), num_threads = list.size();
+        fout.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+        fout.write((const char *)&record_size, sizeof(record_size));
+        fout.write((const char *)&num_threads, sizeof(num_threads));
+
+        for (int t = 0; t < list.size(); ++t)
+        {
+            const TraceRing &ring = *list[t];
+            uint64_t written = ring.head.load(std::memory_order_acquire);
+            uint32_t kept = written < TRACE_RING_SIZE ? written : TRACE_RING_SIZE;
+
+            fout.write((const char *)&written, sizeof(written));
+            fout.write((const char *)&kept, sizeof(kept));
+
+            for (uint64_t i = written - kept; i < written; ++i)
+            {
+                fout.write((const char *)&ring.records[i & (TRACE_RING_SIZE - 1)], sizeof(TraceRecord));
+            }
+        }
+
+        return fout.good();
+    }
+
+private:
+    static std::mutex &mutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+
+    static std::vector<std::unique_ptr<TraceRing>> &rings()
+    {
+        static std::vector<std::unique_ptr<TraceRing>> list;
+        return list;
+    }
+
+    // Ring of the calling thread, allocated on its first record and kept after the thread ends
+    static TraceRing &local()
+    {
+        thread_local TraceRing *ring = nullptr;
+
+        if (ring == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(mutex());
+            rings().emplace_back(new TraceRing());
+            ring = rings().back().get();
+        }
+
+        return *ring;
+    }
+};
+
+#endif
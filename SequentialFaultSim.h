@@ -0,0 +1,260 @@
+#ifndef SEQUENTIALFAULTSIM_H
+#define SEQUENTIALFAULTSIM_H
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "Fault.h"
+#include "CompiledCircuit.h"
+
+// Bit parallel simulation of stuck at faults in a circuit with flip-flops
+// Up to 64 independent sequences are simulated at once, sequence s in bit s of every word.
+// Every sequence starts with all the flip-flops at 0 and the state is carried from one frame to the next.
+// A fault is detected by a sequence when an output differs in one of its frames, the faulty state
+// of the flip-flops is kept between the frames so that latched fault effects are followed
+class SequentialFaultSimulator
+{
+
+public:
+    // Good machine values of every net in every frame of the last chunk
+    std::vector<std::vector<uint64_t>> good;
+
+    // Class constructor, the circuit and the sites have to outlive the simulator
+    SequentialFaultSimulator(const CompiledCircuit &_circuit, const FaultSites &_sites) : circuit(_circuit), sites(_sites)
+    {
+        faulty.assign(circuit.num_nets, 0);
+        changed.assign(circuit.num_nets, 0);
+        is_output.assign(circuit.num_nets, 0);
+        scheduled.assign(circuit.gates.size(), 0);
+        fanout.resize(circuit.num_nets);
+        driver.assign(circuit.num_nets, -1);
+
+        for (int j = 0; j < circuit.gates.size(); ++j)
+        {
+            fanout[circuit.gates[j].in1].push_back(j);
+            if (circuit.gates[j].in2 != circuit.gates[j].in1)
+            {
+                fanout[circuit.gates[j].in2].push_back(j);
+            }
+            driver[circuit.gates[j].out] = j;
+        }
+
+        for (int i = 0; i < circuit.outputs.size(); ++i)
+        {
+            is_output[circuit.outputs[i]] = 1;
+        }
+    }
+
+    // Simulate a chunk of sequences against the faults listed by position in targets
+    // frames and active are packed as by PatternReader::readSequenceChunk,
+    // detected receives one word per fault of the list with the sequences detecting it
+    void simulate(const std::vector<std::vector<uint64_t>> &frames, const std::vector<uint64_t> &active, const std::vector<Fault> &faults, const std::vector<int> &targets, std::vector<uint64_t> &detected)
+    {
+        simulateGood(frames);
+
+        detected.assign(faults.size(), 0);
+
+        for (int i = 0; i < targets.size(); ++i)
+        {
+            detected[targets[i]] = simulateFault(faults[targets[i]], active);
+        }
+    }
+
+private:
+    const CompiledCircuit &circuit;
+    const FaultSites &sites;
+
+    // Gates fed by every net, the gate driving every net and the primary output flags
+    std::vector<std::vector<int>> fanout;
+    std::vector<int> driver;
+    std::vector<char> is_output;
+
+    // Scratch state of the single fault propagation in one frame
+    std::vector<uint64_t> faulty;
+    std::vector<char> changed;
+    std::vector<char> scheduled;
+    std::vector<int> touched;
+    std::priority_queue<int, std::vector<int>, std::greater<int>> queue;
+
+    // Fault being simulated, the forced net or the forced gate input pin
+    int fault_net, fault_gate, fault_pin;
+    uint64_t fault_word;
+
+    void simulateGood(const std::vector<std::vector<uint64_t>> &frames)
+    {
+        good.assign(frames.size(), std::vector<uint64_t>(circuit.num_nets, 0));
+
+        for (int t = 0; t < frames.size(); ++t)
+        {
+            std::vector<uint64_t> &values = good[t];
+
+            for (int i = 0; i < circuit.inputs.size(); ++i)
+            {
+                values[circuit.inputs[i]] = frames[t][i];
+            }
+
+            // The flip-flops hold the data inputs of the previous frame, 0 after reset
+            for (int i = 0; i < circuit.flop_q.size(); ++i)
+            {
+                values[circuit.flop_q[i]] = t > 0 ? good[t - 1][circuit.flop_d[i]] : 0;
+            }
+
+            for (int j = 0; j < circuit.gates.size(); ++j)
+            {
+                const CompiledGate &g = circuit.gates[j];
+                values[g.out] = evaluateWord(g.op, values[g.in1], values[g.in2]);
+            }
+        }
+    }
+
+    // Value of a net in the faulty machine of frame t
+    uint64_t value(int n, int t) const
+    {
+        return changed[n] ? faulty[n] : good[t][n];
+    }
+
+    // Record a faulty value which differs from the good one and schedule the gates it feeds
+    void change(int n, uint64_t v)
+    {
+        if (!changed[n])
+        {
+            changed[n] = 1;
+            touched.push_back(n);
+        }
+        faulty[n] = v;
+
+        for (int k = 0; k < fanout[n].size(); ++k)
+        {
+            schedule(fanout[n][k]);
+        }
+    }
+
+    void schedule(int j)
+    {
+        if (!scheduled[j])
+        {
+            scheduled[j] = 1;
+            queue.push(j);
+        }
+    }
+
+    // Set a net to a value in the faulty machine, applying a stuck at fault on the net
+    void assign(int n, uint64_t v, int t)
+    {
+        if (n == fault_net)
+        {
+            v = fault_word;
+        }
+        if (v != good[t][n])
+        {
+            change(n, v);
+        }
+    }
+
+    // Simulate one fault through all the frames, returns the sequences which observe it at an output
+    uint64_t simulateFault(const Fault &fault, const std::vector<uint64_t> &active)
+    {
+        int site = sites.siteOf(fault);
+
+        if (site == -1)
+        {
+            return 0;
+        }
+
+        fault_net = -1;
+        fault_gate = -1;
+        fault_pin = -1;
+        fault_word = fault.value ? ~0ULL : 0;
+
+        if (site < sites.num_nets)
+        {
+            fault_net = site;
+        }
+        else
+        {
+            fault_gate = sites.branch_gate[site - sites.num_nets];
+            fault_pin = sites.branch_site[2 * fault_gate] == site ? 0 : 1;
+        }
+
+        // Faulty state of the flip-flops, starts from the same reset state as the good machine
+        std::vector<uint64_t> state(circuit.flop_q.size(), 0);
+        uint64_t result = 0;
+
+        for (int t = 0; t < good.size(); ++t)
+        {
+            touched.clear();
+
+            // Sources of the frame, the flip-flop outputs and the fault site
+            for (int i = 0; i < circuit.flop_q.size(); ++i)
+            {
+                assign(circuit.flop_q[i], state[i], t);
+            }
+            if (fault_net != -1)
+            {
+                if (driver[fault_net] != -1)
+                {
+                    schedule(driver[fault_net]);
+                }
+                else
+                {
+                    assign(fault_net, good[t][fault_net], t);
+                }
+            }
+            if (fault_gate != -1)
+            {
+                schedule(fault_gate);
+            }
+
+            while (!queue.empty())
+            {
+                int j = queue.top();
+                queue.pop();
+                scheduled[j] = 0;
+
+                const CompiledGate &g = circuit.gates[j];
+                uint64_t a = value(g.in1, t), b = value(g.in2, t);
+
+                // A gate fed twice by the faulty branch sees the fault on both pins
+                if (j == fault_gate)
+                {
+                    if (fault_pin == 0 || g.in1 == g.in2)
+                    {
+                        a = fault_word;
+                    }
+                    if (fault_pin == 1 || g.in1 == g.in2)
+                    {
+                        b = fault_word;
+                    }
+                }
+
+                assign(g.out, evaluateWord(g.op, a, b), t);
+            }
+
+            // Compare the outputs and latch the faulty data inputs
+            for (int i = 0; i < touched.size(); ++i)
+            {
+                int n = touched[i];
+                if (is_output[n])
+                {
+                    result |= (faulty[n] ^ good[t][n]) & active[t];
+                }
+            }
+
+            for (int i = 0; i < circuit.flop_d.size(); ++i)
+            {
+                state[i] = value(circuit.flop_d[i], t);
+            }
+
+            for (int i = 0; i < touched.size(); ++i)
+            {
+                changed[touched[i]] = 0;
+            }
+        }
+
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,359 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Fault.h"
+#include "CompiledCircuit.h"
+#include "ParallelFaultSim.h"
+#include "SatAtpg.h"
+
+// Fault sites of a compiled circuit, numbered like the sites of a parsed circuit
+inline FaultSites compiledSites(const CompiledCircuit &circuit)
+{
+    FaultSites sites;
+    sites.num_nets = circuit.num_nets;
+    sites.num_sites = circuit.num_nets;
+
+    std::vector<int> fanout(circuit.num_nets, 0);
+    for (int j = 0; j < circuit.gates.size(); ++j)
+    {
+        const CompiledGate &g = circuit.gates[j];
+        fanout[g.in1]++;
+        if (g.op != OP_BUF && g.op != OP_INV)
+        {
+            fanout[g.in2]++;
+        }
+    }
+    for (int i = 0; i < circuit.outputs.size(); ++i)
+    {
+        fanout[circuit.outputs[i]]++;
+    }
+
+    sites.branch_site.assign(2 * circuit.gates.size(), -1);
+
+    for (int j = 0; j < circuit.gates.size(); ++j)
+    {
+        const CompiledGate &g = circuit.gates[j];
+        int pins = (g.op == OP_BUF || g.op == OP_INV) ? 1 : 2;
+
+        for (int k = 0; k < pins; ++k)
+        {
+            int net = k == 0 ? g.in1 : g.in2;
+
+            // Both pins reading the same net share one site
+            if (k == 1 && g.in1 == g.in2)
+            {
+                sites.branch_site[2 * j + 1] = sites.branch_site[2 * j];
+            }
+            else if (fanout[net] > 1)
+            {
+                sites.branch_site[2 * j + k] = sites.num_sites++;
+                sites.branch_net.push_back(net + 1);
+                sites.branch_gate.push_back(j);
+            }
+        }
+    }
+
+    return sites;
+}
+
+// Simulation and test generation of one combinational netlist for use inside other programs
+// A session loads a netlist once and keeps the compiled circuit, its fault sites and the simulators. The calls take
+// and fill buffers of the caller and handle 64 patterns at once, pattern p in bit p of every word. Simulation and
+// fault simulation allocate nothing after the load; test generation builds a SAT instance per fault.
+// The gates are levelized like in part 2 and part 3, so a branch fault names the same gate index in all of them
+class Session
+{
+
+public:
+    Session()
+    {
+    }
+
+    Session(const Session &) = delete;
+    Session &operator=(const Session &) = delete;
+
+    // Load a netlist file, returns false with the reason in error if it cannot be read or is not combinational
+    bool load(const std::string &filename, std::string &error)
+    {
+        CompiledCircuit parsed;
+
+        if (!parseCompiled(filename, parsed, error))
+        {
+            return false;
+        }
+
+        return load(parsed, error);
+    }
+
+    // Load a circuit built in memory, its gates have to be in topological order
+    bool load(const CompiledCircuit &_circuit, std::string &error)
+    {
+        if (!_circuit.flop_q.empty())
+        {
+            error = "sessions only simulate combinational circuits";
+            return false;
+        }
+
+        std::vector<char> defined(_circuit.num_nets, 0);
+        for (int i = 0; i < _circuit.inputs.size(); ++i)
+        {
+            defined[_circuit.inputs[i]] = 1;
+        }
+        for (int j = 0; j < _circuit.gates.size(); ++j)
+        {
+            const CompiledGate &g = _circuit.gates[j];
+            if (!defined[g.in1] || !defined[g.in2])
+            {
+                error = "gate " + std::to_string(j) + " reads a net which is neither an input nor driven by an earlier gate";
+                return false;
+            }
+            defined[g.out] = 1;
+        }
+
+        // The simulators refer to the circuit and the sites, so they are rebuilt after them
+        simulator.reset();
+        generator.reset();
+
+        compiled = _circuit;
+        sites = compiledSites(compiled);
+
+        simulator.reset(new PatternParallelFaultSimulator(compiled, sites));
+        generator.reset(new SatTestGenerator(compiled, sites));
+
+        return true;
+    }
+
+    bool isLoaded() const
+    {
+        return simulator != nullptr;
+    }
+
+    int numInputs() const
+    {
+        return compiled.inputs.size();
+    }
+
+    int numOutputs() const
+    {
+        return compiled.outputs.size();
+    }
+
+    const CompiledCircuit &circuit() const
+    {
+        return compiled;
+    }
+
+    const FaultSites &faultSites() const
+    {
+        return sites;
+    }
+
+    // All the stuck at faults of the nets and, with pins, of the fanout branches
+    std::vector<Fault> allFaults(bool pins) const
+    {
+        return sites.allFaults(pins);
+    }
+
+    // Simulate 64 patterns, inputs holds one word per primary input and outputs receives one word per output
+    void simulate(const uint64_t *inputs, uint64_t *outputs)
+    {
+        simulator->simulateGood(inputs);
+
+        for (int i = 0; i < compiled.outputs.size(); ++i)
+        {
+            outputs[i] = simulator->good[compiled.outputs[i]];
+        }
+    }
+
+    // Fault simulate 64 patterns against a list of faults, mask selects the valid patterns
+    // detected receives one word per fault with the patterns detecting it
+    void faultSimulate(const uint64_t *inputs, uint64_t mask, const Fault *faults, int num_faults, uint64_t *detected)
+    {
+        simulator->simulateGood(inputs);
+
+        for (int f = 0; f < num_faults; ++f)
+        {
+            detected[f] = simulator->detect(faults[f], mask);
+        }
+    }
+
+    // Generate a test for a stuck at fault, giving up after conflict_limit conflicts (0 for no limit)
+    // On success test receives one character 0, 1 or X per primary input, it is left unchanged otherwise
+    SatStatus generateTest(const Fault &fault, char *test, long conflict_limit = 0)
+    {
+        SatStatus status = generator->generate(fault, conflict_limit, scratch);
+
+        if (status == SAT_SATISFIABLE)
+        {
+            std::memcpy(test, scratch.data(), scratch.size());
+        }
+
+        return status;
+    }
+
+    // Parse a netlist file into a compiled circuit with the gates levelized like part 2 and part 3 do
+    static bool parseCompiled(const std::string &filename, CompiledCircuit &circuit, std::string &error)
+    {
+        std::ifstream fin(filename);
+
+        if (!fin.is_open())
+        {
+            error = "unable to open the netlist " + filename;
+            return false;
+        }
+
+        std::vector<CompiledGate> gates;
+        std::vector<int> driver;
+        std::vector<std::vector<int>> readers;
+        int max_id = 0;
+
+        std::string line, type;
+        int line_number = 0;
+
+        while (getline(fin, line))
+        {
+            line_number++;
+            std::stringstream ss(line);
+
+            if (!(ss >> type))
+            {
+                continue;
+            }
+
+            if (type == "INPUT" || type == "OUTPUT")
+            {
+                int num;
+                while (ss >> num && num != -1)
+                {
+                    if (num < 1)
+                    {
+                        error = "invalid net id on line " + std::to_string(line_number) + " of " + filename;
+                        return false;
+                    }
+                    (type == "INPUT" ? circuit.inputs : circuit.outputs).push_back(num - 1);
+                    max_id = std::max(max_id, num);
+                }
+                continue;
+            }
+
+            if (type == "DFF")
+            {
+                error = "sessions only simulate combinational circuits";
+                return false;
+            }
+
+            int pins = type == "INV" || type == "BUF" ? 1 : 2;
+            if (pins == 2 && type != "AND" && type != "OR" && type != "NAND" && type != "NOR")
+            {
+                error = "unknown gate type " + type + " on line " + std::to_string(line_number) + " of " + filename;
+                return false;
+            }
+
+            int ids[3] = {0, 0, 0};
+            for (int k = 0; k <= pins; ++k)
+            {
+                ss >> ids[k];
+            }
+
+            if (ids[0] < 1 || ids[pins - 1] < 1 || ids[pins] < 1)
+            {
+                error = "invalid net id on line " + std::to_string(line_number) + " of " + filename;
+                return false;
+            }
+
+            CompiledGate g;
+            g.op = CompiledCircuit::gateOp(type);
+            g.in1 = ids[0] - 1;
+            g.in2 = ids[pins - 1] - 1;
+            g.out = ids[pins] - 1;
+
+            max_id = std::max(max_id, std::max(ids[0], std::max(ids[pins - 1], ids[pins])));
+            if (max_id > readers.size())
+            {
+                readers.resize(max_id);
+                driver.resize(max_id, -1);
+            }
+
+            // Both pins of a two input gate are readers, even of the same net, like in the parsed netlists
+            readers[g.in1].push_back(gates.size());
+            if (pins == 2)
+            {
+                readers[g.in2].push_back(gates.size());
+            }
+            driver[g.out] = gates.size();
+
+            gates.push_back(g);
+        }
+
+        readers.resize(max_id);
+        driver.resize(max_id, -1);
+
+        // Levelize, the gates driven only by primary inputs first, then every gate once all its drivers are placed
+        std::vector<int> pending(gates.size(), 0);
+        for (int n = 0; n < max_id; ++n)
+        {
+            for (int k = 0; k < readers[n].size(); ++k)
+            {
+                pending[readers[n][k]] += driver[n] != -1;
+            }
+        }
+
+        std::vector<int> order;
+        for (int j = 0; j < gates.size(); ++j)
+        {
+            if (pending[j] == 0)
+            {
+                order.push_back(j);
+            }
+        }
+
+        for (int i = 0; i < order.size(); ++i)
+        {
+            const std::vector<int> &next = readers[gates[order[i]].out];
+
+            for (int k = 0; k < next.size(); ++k)
+            {
+                if (--pending[next[k]] == 0)
+                {
+                    order.push_back(next[k]);
+                }
+            }
+        }
+
+        if (order.size() != gates.size())
+        {
+            error = "the netlist " + filename + " has a combinational loop";
+            return false;
+        }
+
+        circuit.num_nets = max_id;
+        circuit.gates.clear();
+        for (int i = 0; i < order.size(); ++i)
+        {
+            circuit.gates.push_back(gates[order[i]]);
+        }
+
+        return true;
+    }
+
+private:
+    CompiledCircuit compiled;
+    FaultSites sites;
+
+    std::unique_ptr<PatternParallelFaultSimulator> simulator;
+    std::unique_ptr<SatTestGenerator> generator;
+
+    // Test of the last generation, reused between calls
+    std::string scratch;
+};
+
+#endif
@@ -0,0 +1,333 @@
+#ifndef STATICLEARNING_H
+#define STATICLEARNING_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "CompiledCircuit.h"
+
+// Direct implication of line values in the good circuit, forward and backward through every gate
+// Values are -1 for unknown, 0 or 1. Assignments accumulate until reset
+class ImplicationEngine
+{
+
+public:
+    // Value of every net
+    std::vector<signed char> values;
+
+    // Class constructor, the circuit has to outlive the engine
+    ImplicationEngine(const CompiledCircuit &_circuit) : circuit(_circuit)
+    {
+        values.assign(circuit.num_nets, -1);
+        fanout.resize(circuit.num_nets);
+        driver.assign(circuit.num_nets, -1);
+
+        for (int j = 0; j < circuit.gates.size(); ++j)
+        {
+            fanout[circuit.gates[j].in1].push_back(j);
+            if (circuit.gates[j].in2 != circuit.gates[j].in1)
+            {
+                fanout[circuit.gates[j].in2].push_back(j);
+            }
+            driver[circuit.gates[j].out] = j;
+        }
+    }
+
+    // Assign a value to a net and derive all its direct implications, returns false on a conflict
+    bool imply(int n, int v)
+    {
+        if (!assign(n, v))
+        {
+            return false;
+        }
+
+        while (!pending.empty())
+        {
+            int m = pending.back();
+            pending.pop_back();
+
+            if (driver[m] != -1 && !implyGate(driver[m]))
+            {
+                pending.clear();
+                return false;
+            }
+
+            for (int k = 0; k < fanout[m].size(); ++k)
+            {
+                if (!implyGate(fanout[m][k]))
+                {
+                    pending.clear();
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    // Nets assigned since the last reset
+    const std::vector<int> &assigned() const
+    {
+        return trail;
+    }
+
+    // Clear all the assignments
+    void reset()
+    {
+        undo(0);
+    }
+
+    // Clear the assignments made after the first count ones, count is a previous size of assigned()
+    void undo(int count)
+    {
+        for (int i = count; i < trail.size(); ++i)
+        {
+            values[trail[i]] = -1;
+        }
+        trail.resize(count);
+    }
+
+    // Gate driving every net, -1 for the primary inputs
+    const std::vector<int> &drivers() const
+    {
+        return driver;
+    }
+
+    // Gates fed by a net
+    const std::vector<int> &consumers(int n) const
+    {
+        return fanout[n];
+    }
+
+private:
+    const CompiledCircuit &circuit;
+
+    std::vector<std::vector<int>> fanout;
+    std::vector<int> driver;
+    std::vector<int> trail;
+    std::vector<int> pending;
+
+    bool assign(int n, int v)
+    {
+        if (values[n] == v)
+        {
+            return true;
+        }
+        if (values[n] != -1)
+        {
+            return false;
+        }
+
+        values[n] = v;
+        trail.push_back(n);
+        pending.push_back(n);
+
+        return true;
+    }
+
+    // Derive the values implied by the known values around one gate
+    bool implyGate(int j)
+    {
+        const CompiledGate &g = circuit.gates[j];
+        int a = values[g.in1], b = values[g.in2], o = values[g.out];
+
+        if (g.op == OP_BUF || g.op == OP_INV)
+        {
+            int inv = g.op == OP_INV;
+            return (a == -1 || assign(g.out, a ^ inv)) && (o == -1 || assign(g.in1, o ^ inv));
+        }
+
+        // Controlling value and inversion of the gate
+        int c = (g.op == OP_AND || g.op == OP_NAND) ? 0 : 1;
+        int inv = (g.op == OP_NAND || g.op == OP_NOR) ? 1 : 0;
+
+        // Forward, a controlling input or all inputs non controlling
+        if (a == c || b == c)
+        {
+            if (!assign(g.out, c ^ inv))
+            {
+                return false;
+            }
+        }
+        else if (a == !c && b == !c)
+        {
+            if (!assign(g.out, !c ^ inv))
+            {
+                return false;
+            }
+        }
+
+        if (o == -1)
+        {
+            return true;
+        }
+
+        // Backward, the non controlled output needs all inputs non controlling, the controlled
+        // output needs the last undecided input controlling
+        if ((o ^ inv) == !c)
+        {
+            return assign(g.in1, !c) && assign(g.in2, !c);
+        }
+        if (a == !c && !assign(g.in2, c))
+        {
+            return false;
+        }
+        if (b == !c && !assign(g.in1, c))
+        {
+            return false;
+        }
+
+        return true;
+    }
+};
+
+// Indirect implications learned once per circuit in the style of SOCRATES
+// Every fanout stem is set to 0 and to 1 and the direct implications are derived. When x = v implies y = w on a gate
+// output whose non controlled value is w, the contrapositive y = !w => x = !v can not be found by direct implication
+// and is stored. A value which leads to a conflict makes the stem a constant line.
+// The implications are stored by implied literal (2 * net + value), listing the literals implying it
+class ImplicationGraph
+{
+
+public:
+    // Constant value of every net, -1 if the net is not constant
+    std::vector<signed char> constant;
+
+    // Literals implying every literal, sources[first[l]] to sources[first[l + 1] - 1] imply literal l
+    std::vector<int> first;
+    std::vector<int> sources;
+
+    ImplicationGraph()
+    {
+    }
+
+    // Learn the implications of a circuit
+    ImplicationGraph(const CompiledCircuit &circuit)
+    {
+        ImplicationEngine engine(circuit);
+        const std::vector<int> &driver = engine.drivers();
+
+        constant.assign(circuit.num_nets, -1);
+
+        // Pairs of implied and implying literals
+        std::vector<std::pair<int, int>> learned;
+
+        for (int x = 0; x < circuit.num_nets; ++x)
+        {
+            bool stem = engine.consumers(x).size() > 1;
+            for (int i = 0; i < circuit.outputs.size() && !stem; ++i)
+            {
+                stem = circuit.outputs[i] == x && !engine.consumers(x).empty();
+            }
+
+            if (!stem)
+            {
+                continue;
+            }
+
+            for (int v = 0; v <= 1; ++v)
+            {
+                bool consistent = engine.imply(x, v);
+
+                if (!consistent)
+                {
+                    constant[x] = !v;
+                }
+                else
+                {
+                    const std::vector<int> &lines = engine.assigned();
+
+                    for (int i = 0; i < lines.size(); ++i)
+                    {
+                        int y = lines[i];
+                        int w = engine.values[y];
+
+                        if (y != x && driver[y] != -1 && w == nonControlledOutput(circuit.gates[driver[y]].op))
+                        {
+                            learned.push_back(std::make_pair(2 * x + !v, 2 * y + !w));
+                        }
+                    }
+                }
+
+                engine.reset();
+            }
+        }
+
+        std::sort(learned.begin(), learned.end());
+        learned.erase(std::unique(learned.begin(), learned.end()), learned.end());
+
+        first.assign(2 * circuit.num_nets + 1, 0);
+        for (int i = 0; i < learned.size(); ++i)
+        {
+            first[learned[i].first + 1]++;
+            sources.push_back(learned[i].second);
+        }
+        for (int l = 0; l < 2 * circuit.num_nets; ++l)
+        {
+            first[l + 1] += first[l];
+        }
+    }
+
+    int numImplications() const
+    {
+        return sources.size();
+    }
+
+    int numConstants() const
+    {
+        int count = 0;
+        for (int i = 0; i < constant.size(); ++i)
+        {
+            count += constant[i] != -1;
+        }
+        return count;
+    }
+
+    // Value which the current assignment of the nets forces on net n (an index), -1 if none
+    // NetT needs a value member holding -1, 0 or 1
+    template <class NetT>
+    int forcedValue(int n, const std::vector<NetT> &net_list) const
+    {
+        if (constant.empty())
+        {
+            return -1;
+        }
+        if (constant[n] != -1)
+        {
+            return constant[n];
+        }
+
+        for (int u = 0; u <= 1; ++u)
+        {
+            int l = 2 * n + u;
+            for (int k = first[l]; k < first[l + 1]; ++k)
+            {
+                if (net_list[sources[k] >> 1].value == (sources[k] & 1))
+                {
+                    return u;
+                }
+            }
+        }
+
+        return -1;
+    }
+
+    // Output value of a gate which needs all its inputs non controlling, -1 for the single input gates
+    static int nonControlledOutput(int op)
+    {
+        switch (op)
+        {
+        case OP_AND:
+        case OP_NOR:
+            return 1;
+        case OP_NAND:
+        case OP_OR:
+            return 0;
+        default:
+            return -1;
+        }
+    }
+};
+
+#endif
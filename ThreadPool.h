@@ -0,0 +1,122 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// A fixed set of worker threads which execute submitted tasks in FIFO order
+// The pool is created once per process and reused by every job in a batch
+class ThreadPool
+{
+
+public:
+    // Class constructor, starts the given number of worker threads
+    ThreadPool(int _threads)
+    {
+        stopping = false;
+        pending = 0;
+
+        if (_threads < 1)
+        {
+            _threads = 1;
+        }
+
+        for (int i = 0; i < _threads; ++i)
+        {
+            workers.emplace_back([this]()
+                                 { workerLoop(); });
+        }
+    }
+
+    // Class destructor, finishes the queued tasks and joins the workers
+    ~ThreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        task_ready.notify_all();
+
+        for (int i = 0; i < workers.size(); ++i)
+        {
+            workers[i].join();
+        }
+    }
+
+    // Number of worker threads in the pool
+    int size() const
+    {
+        return workers.size();
+    }
+
+    // Queue a task for execution on one of the workers
+    void submit(std::function<void()> task)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            tasks.push(std::move(task));
+            pending++;
+        }
+        task_ready.notify_one();
+    }
+
+    // Block until every submitted task has finished
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        all_done.wait(lock, [this]()
+                      { return pending == 0; });
+    }
+
+private:
+    // Worker threads and the queue of tasks waiting for them
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+
+    // Synchronisation state
+    std::mutex mutex;
+    std::condition_variable task_ready;
+    std::condition_variable all_done;
+    bool stopping;
+    int pending;
+
+    // Fetch and run tasks until the pool is destroyed
+    void workerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                task_ready.wait(lock, [this]()
+                                { return stopping || !tasks.empty(); });
+
+                if (tasks.empty())
+                {
+                    return;
+                }
+
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+
+            task();
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                pending--;
+                if (pending == 0)
+                {
+                    all_done.notify_all();
+                }
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef TRANSITIONFAULTSIM_H
+#define TRANSITIONFAULTSIM_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Fault.h"
+#include "CompiledCircuit.h"
+#include "ParallelFaultSim.h"
+
+// Bit parallel simulation of transition faults with pattern pairs
+// Up to 64 pairs are simulated at once, pair p in bit p of every word. The first vector initializes
+// the circuit, the second one launches the transition and captures the outputs.
+// A slow to rise fault is detected by a pair which holds the line at 0 with the first vector
+// and detects the line stuck at 0 with the second vector, slow to fall likewise with 1
+class TransitionFaultSimulator
+{
+
+public:
+    // Good machine values of every net for the first vector
+    std::vector<uint64_t> initial;
+
+    // Class constructor, the circuit and the sites have to outlive the simulator
+    TransitionFaultSimulator(const CompiledCircuit &circuit, const FaultSites &sites) : launch(circuit, sites)
+    {
+    }
+
+    // Good machine values of every net for the second vector
+    const std::vector<uint64_t> &final() const
+    {
+        return launch.good;
+    }
+
+    // Simulate the good machine of both vectors level by level on the threads of an executor, nullptr for one thread
+    void useExecutor(LevelParallelExecutor *executor)
+    {
+        launch.useExecutor(executor);
+    }
+
+    // Simulate a chunk of pairs, given as one word per primary input for each vector, against the faults
+    // mask selects the valid pairs of the chunk, detected receives one word per fault with the pairs detecting it
+    void simulate(const std::vector<uint64_t> &first, const std::vector<uint64_t> &second, uint64_t mask, const std::vector<Fault> &faults, std::vector<uint64_t> &detected)
+    {
+        launch.simulateGood(first);
+        initial = launch.good;
+        launch.simulateGood(second);
+
+        detected.assign(faults.size(), 0);
+
+        for (int f = 0; f < faults.size(); ++f)
+        {
+            if (faults[f].model != FAULT_TRANSITION)
+            {
+                continue;
+            }
+
+            // The pairs holding the line at the old value, the second vector has to detect the line stuck at it
+            int n = faults[f].net_id - 1;
+            if (n < 0 || n >= initial.size())
+            {
+                continue;
+            }
+
+            uint64_t initialized = faults[f].value ? initial[n] : ~initial[n];
+
+            detected[f] = launch.detect(faults[f], initialized & mask);
+        }
+    }
+
+private:
+    // Simulator of the second vector
+    PatternParallelFaultSimulator launch;
+};
+
+#endif
@@ -0,0 +1,202 @@
+#ifndef UNTESTABLEFAULTS_H
+#define UNTESTABLEFAULTS_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "Fault.h"
+#include "CompiledCircuit.h"
+#include "StaticLearning.h"
+#include "Dominators.h"
+
+// Structural identification of untestable stuck at faults, without any search
+// Every fault has a set of mandatory good circuit values: the activation value of the faulty line and the non
+// controlling value on the side inputs of the gates dominating the fault site which are outside its fanout cone.
+// A fault is proven untestable when
+// - no output is reachable from the fault site
+// - the mandatory values conflict with each other or with the constant lines (constant propagation)
+// - setting some fanout stem to 0 and setting it to 1 both contradict a mandatory value (FIRE)
+// The constant lines are the fanout stems whose value leads to a conflict, all found with direct implication
+class UntestableFaultFinder
+{
+
+public:
+    // Number of faults proven by every criterion in the last call to find
+    int num_unobservable;
+    int num_conflicting;
+    int num_stem;
+
+    // Class constructor, the circuit and the sites have to outlive the finder
+    UntestableFaultFinder(const CompiledCircuit &_circuit, const FaultSites &_sites) : circuit(_circuit), sites(_sites), engine(_circuit), dominators(_circuit)
+    {
+        num_unobservable = 0;
+        num_conflicting = 0;
+        num_stem = 0;
+
+        is_output.assign(circuit.num_nets, 0);
+        for (int i = 0; i < circuit.outputs.size(); ++i)
+        {
+            is_output[circuit.outputs[i]] = 1;
+        }
+
+        for (int n = 0; n < circuit.num_nets; ++n)
+        {
+            if (engine.consumers(n).size() + is_output[n] > 1)
+            {
+                stems.push_back(n);
+            }
+        }
+    }
+
+    // Returns one flag per fault, set for the faults proven untestable
+    std::vector<char> find(const std::vector<Fault> &faults)
+    {
+        std::vector<char> untestable(faults.size(), 0);
+
+        num_unobservable = 0;
+        num_conflicting = 0;
+        num_stem = 0;
+
+        engine.reset();
+
+        // Constant propagation, the stems which can not take one of the values and all the values they imply
+        std::vector<std::pair<int, int>> constants;
+        for (int i = 0; i < stems.size(); ++i)
+        {
+            for (int v = 0; v <= 1; ++v)
+            {
+                if (!engine.imply(stems[i], v))
+                {
+                    constants.push_back(std::make_pair(stems[i], !v));
+                }
+                engine.reset();
+            }
+        }
+
+        for (int i = 0; i < constants.size(); ++i)
+        {
+            if (!engine.imply(constants[i].first, constants[i].second))
+            {
+                // The circuit itself is contradictory, nothing can be concluded
+                engine.reset();
+                return untestable;
+            }
+        }
+
+        int base = engine.assigned().size();
+
+        // Mandatory values of every fault, checked against each other and the constants
+        std::vector<std::vector<std::pair<int, int>>> mandatory(faults.size());
+
+        for (int f = 0; f < faults.size(); ++f)
+        {
+            if (sites.siteOf(faults[f]) == -1)
+            {
+                continue;
+            }
+
+            if (!mandatoryValues(faults[f], mandatory[f]))
+            {
+                untestable[f] = 1;
+                num_unobservable++;
+                continue;
+            }
+
+            bool consistent = true;
+            for (int i = 0; i < mandatory[f].size() && consistent; ++i)
+            {
+                consistent = engine.imply(mandatory[f][i].first, mandatory[f][i].second);
+            }
+            engine.undo(base);
+
+            if (!consistent)
+            {
+                untestable[f] = 1;
+                num_conflicting++;
+            }
+        }
+
+        // Faults requiring every literal (2 * net + value)
+        std::vector<std::vector<int>> requiring(2 * circuit.num_nets);
+        for (int f = 0; f < faults.size(); ++f)
+        {
+            for (int i = 0; !untestable[f] && i < mandatory[f].size(); ++i)
+            {
+                requiring[2 * mandatory[f][i].first + mandatory[f][i].second].push_back(f);
+            }
+        }
+
+        // FIRE, a fault blocked by both values of a stem is untestable, blocked0 records the last stem whose value 0
+        // contradicts a mandatory value of the fault
+        std::vector<int> blocked0(faults.size(), -1);
+
+        for (int i = 0; i < stems.size(); ++i)
+        {
+            int s = stems[i];
+            if (engine.values[s] != -1)
+            {
+                continue;
+            }
+
+            for (int v = 0; v <= 1; ++v)
+            {
+                if (engine.imply(s, v))
+                {
+                    // The faults requiring the opposite of an implied value, the stem itself included
+                    const std::vector<int> &lines = engine.assigned();
+
+                    for (int k = base; k < lines.size(); ++k)
+                    {
+                        int y = lines[k];
+                        const std::vector<int> &list = requiring[2 * y + !engine.values[y]];
+
+                        for (int m = 0; m < list.size(); ++m)
+                        {
+                            int f = list[m];
+                            if (v == 0)
+                            {
+                                blocked0[f] = i;
+                            }
+                            else if (blocked0[f] == i && !untestable[f])
+                            {
+                                untestable[f] = 1;
+                                num_stem++;
+                            }
+                        }
+                    }
+                }
+
+                engine.undo(base);
+            }
+        }
+
+        engine.reset();
+
+        return untestable;
+    }
+
+private:
+    const CompiledCircuit &circuit;
+    const FaultSites &sites;
+
+    ImplicationEngine engine;
+    std::vector<char> is_output;
+    std::vector<int> stems;
+
+    // Dominators of the fault sites, shared with the FAN search
+    SiteDominators dominators;
+
+    // Mandatory good values of a fault as (net index, value) pairs, returns false if the fault reaches no output
+    bool mandatoryValues(const Fault &fault, std::vector<std::pair<int, int>> &values)
+    {
+        int site = sites.siteOf(fault);
+        int fault_gate = site >= sites.num_nets ? sites.branch_gate[site - sites.num_nets] : -1;
+
+        values.assign(1, std::make_pair(fault.net_id - 1, !fault.value));
+
+        return dominators.analyze(fault.net_id - 1, fault_gate, values);
+    }
+};
+
+#endif